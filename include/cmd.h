@@ -9,7 +9,11 @@
 #define CMD_MAX_DATA_SIZE 250
 
 // [MUDANÇA 1] Tamanho do Header sobe para 7 (AA+55+DST+SRC+ID+SIZE)
-#define CMD_HDR_SIZE       7
+// [REVISÃO 3] Header sobe para 8 com o byte de sequência (AA+55+DST+SRC+ID+SEQ+SIZE)
+#define CMD_HDR_SIZE        8
+#define CMD_HDR_ID_OFFSET   4 // Posição do ID dentro do header
+#define CMD_HDR_SEQ_OFFSET  5 // Posição da sequência dentro do header
+#define CMD_HDR_SIZE_OFFSET 6 // Posição do tamanho (LE, 16 bits) dentro do header
 #define CMD_TRAILER_SIZE   2
 #define FRAME_MAX_CMD_SIZE (CMD_HDR_SIZE + CMD_MAX_DATA_SIZE + CMD_TRAILER_SIZE)
 #define CMD_INVALID_ID     255
@@ -20,24 +24,54 @@
 #define CMD_SOF_1_BYTE 0xAA
 #define CMD_SOF_2_BYTE 0x55
 
+// Sequência: a resposta ecoa a sequência do pedido. Um pedido repetido com a mesma
+// sequência (retry) recebe a resposta guardada, sem ser executado de novo.
+// Sequência 0 = pedido sem tag (sempre executado).
+#define CMD_SEQ_NONE 0
+
+/* --- TABELA DE COMANDOS ---
+ * Único lugar para declarar um comando. Cada linha gera:
+ * - o valor em cmd_ids_t (CMD_<NOME>_ID);
+ * - a entrada da tabela de codec em cmd.c: tamanho de payload aceito [min, max],
+ *   encoder (cmd_encode_<enc>, com o membro <membro> de cmd_cmds_t) e decoder
+ *   (cmd_decode_<dec>); cmd_encode/cmd_decode despacham por índice, O(1);
+ * - a entrada da tabela de despacho do Hub (hub_cmd_<hub> em hub.c; none = o escravo
+ *   não trata, responde CMD_ERR_UNKNOWN_CMD).
+ * Os tamanhos só são avaliados onde a tabela é expandida (depois das structs).
+ */
+#define CMD_TABLE(X)                                                                                               \
+    /* NOME            ID    membro           min payload              max payload              encoder           decoder          hub */ \
+    X(VERSION_REQ,      0x01, version_req,     0,                       0,                       version_req,      version_req,     version)     \
+    X(VERSION_RES,      0x02, version_res,     CMD_VERSION_RES_SIZE,    CMD_VERSION_RES_SIZE,    version_res,      version_res,     none)        \
+    X(GET_STATUS_REQ,   0x03, status_req,      0,                       0,                       status_req,       status_req,      get_status)  \
+    X(GET_STATUS_RES,   0x04, status_res,      CMD_GET_STATUS_RES_SIZE, CMD_GET_STATUS_RES_SIZE, status_res,       status_res,      none)        \
+    X(SET_CONFIG_REQ,   0x10, config_req,      CMD_SET_CONFIG_REQ_SIZE, CMD_SET_CONFIG_REQ_SIZE, config_req,       config_req,      set_config)  \
+    X(SET_CONFIG_RES,   0x11, config_res,      CMD_SET_CONFIG_RES_SIZE, CMD_SET_CONFIG_RES_SIZE, config_res,       config_res,      none)        \
+    X(ACTION_RUN_REQ,   0x20, run_req,         0,                       0,                       action_run_req,   action_run_req,  action)      \
+    X(ACTION_PAUSE_REQ, 0x21, pause_req,       0,                       0,                       action_pause_req, action_pause_req, action)     \
+    X(ACTION_ABORT_REQ, 0x22, abort_req,       0,                       0,                       action_abort_req, action_abort_req, action)     \
+    X(ACTION_PURGE_REQ, 0x23, purge_req,       0,                       0,                       action_purge_req, action_purge_req, action)     \
+    X(ACTION_BOLUS_REQ, 0x24, bolus_req,       0,                       0,                       action_bolus_req, action_bolus_req, action)     \
+    X(ACTION_RES,       0x2F, action_res,      CMD_ACTION_RES_SIZE,     CMD_ACTION_RES_SIZE,     action_res,       action_res,      none)        \
+    X(LINK_CONFIG_REQ,  0x40, link_config_req, CMD_LINK_CONFIG_REQ_SIZE, CMD_LINK_CONFIG_REQ_SIZE, link_config_req, link_config_req, link_config) \
+    X(LINK_CONFIG_RES,  0x41, link_config_res, CMD_LINK_CONFIG_RES_SIZE, CMD_LINK_CONFIG_RES_SIZE, link_config_res, link_config_res, none)      \
+    X(LATENCY_REQ,      0x42, latency_req,     CMD_LATENCY_REQ_SIZE,    CMD_LATENCY_REQ_SIZE,    latency_req,      latency_req,     latency)     \
+    X(LATENCY_RES,      0x43, latency_res,     CMD_LATENCY_RES_SIZE,    CMD_LATENCY_RES_SIZE,    latency_res,      latency_res,     none)        \
+    X(TLM_SUB_REQ,      0x44, tlm_sub_req,     CMD_TLM_SUB_REQ_SIZE,    CMD_TLM_SUB_REQ_SIZE,    tlm_sub_req,      tlm_sub_req,     tlm_sub)     \
+    X(TLM_SUB_RES,      0x45, tlm_sub_res,     CMD_TLM_SUB_RES_SIZE,    CMD_TLM_SUB_RES_SIZE,    tlm_sub_res,      tlm_sub_res,     none)        \
+    X(TLM_DATA,         0x46, tlm_data,        CMD_TLM_DATA_HDR_SIZE,   CMD_MAX_DATA_SIZE,       tlm_data,         tlm_data,        none)        \
+    X(OTA_START_REQ,    0x50, ota_start_req,   CMD_OTA_START_REQ_MIN_SIZE, CMD_OTA_START_REQ_SIZE, ota_start_req, ota_start_req,   ota_start)   \
+    X(OTA_CHUNK_REQ,    0x51, ota_chunk_req,   CMD_OTA_CHUNK_HDR_SIZE,  sizeof(cmd_ota_chunk_t), ota_chunk_req,    ota_chunk_req,   ota_chunk)   \
+    X(OTA_END_REQ,      0x52, ota_end_req,     0,                       CMD_OTA_END_REQ_SIZE,    ota_end_req,      ota_end_req,     ota_end)     \
+    X(OTA_STATUS_REQ,   0x53, ota_status_req,  0,                       0,                       ota_status_req,   ota_status_req,  ota_status)  \
+    X(OTA_STATUS_RES,   0x54, ota_status_res,  CMD_OTA_STATUS_RES_SIZE, CMD_OTA_STATUS_RES_SIZE, ota_status_res,   ota_status_res,  none)        \
+    X(OTA_RES,          0x5F, ota_res,         CMD_OTA_RES_SIZE,        CMD_OTA_RES_SIZE,        ota_res,          action_res,      none)
+
 typedef enum cmd_ids_e
 {
-    CMD_VERSION_REQ_ID = 0x01,
-    CMD_VERSION_RES_ID = 0x02,
-    CMD_GET_STATUS_REQ_ID = 0x03,
-    CMD_GET_STATUS_RES_ID = 0x04,
-    CMD_SET_CONFIG_REQ_ID = 0x10,
-    CMD_SET_CONFIG_RES_ID = 0x11,
-    CMD_ACTION_RUN_REQ_ID = 0x20,
-    CMD_ACTION_PAUSE_REQ_ID = 0x21,
-    CMD_ACTION_ABORT_REQ_ID = 0x22,
-    CMD_ACTION_PURGE_REQ_ID = 0x23,
-    CMD_ACTION_BOLUS_REQ_ID = 0x24,
-    CMD_ACTION_RES_ID = 0x2F,
-    CMD_OTA_START_REQ_ID = 0x50,
-    CMD_OTA_CHUNK_REQ_ID = 0x51,
-    CMD_OTA_END_REQ_ID = 0x52,
-    CMD_OTA_RES_ID = 0x5F,
+#define CMD_TABLE_ID(name, id, member, min, max, enc, dec, hub) CMD_##name##_ID = id,
+    CMD_TABLE(CMD_TABLE_ID)
+#undef CMD_TABLE_ID
 } cmd_ids_t;
 
 typedef enum
@@ -47,6 +81,7 @@ typedef enum
     CMD_ERR_PARAM_RANGE,
     CMD_ERR_UNKNOWN_CMD,
     CMD_ERR_CHECKSUM,
+    CMD_ERR_BUSY, // Pedido anterior ainda em execução (OTA_STATUS com o START ou o END no escritor)
 } cmd_status_t;
 
 /* --- ESTRUTURAS DE PACOTE (WIRE FORMAT) --- */
@@ -59,6 +94,7 @@ typedef struct __attribute__((packed)) cmd_hdr_s
     uint8_t dst;
     uint8_t src;
     uint8_t id;
+    uint8_t seq;
     uint16_t size;
 } cmd_hdr_t;
 
@@ -147,6 +183,203 @@ typedef struct __attribute__((packed)) cmd_action_res_s
     uint8_t status;
 } cmd_action_res_t;
 
+/* --- CAMADA DE LINK (SPI) ---
+ * Modo FIXED: toda transação move SPI_PACKET_SIZE (64) bytes (legado).
+ * Modo VARIABLE: cada transação começa com um cmd_link_hdr_t (4 bytes) em cada sentido,
+ * anunciando quantos bytes cada lado quer enviar. O corpo que segue tem
+ * max(len mestre, len escravo) bytes (0 = sem corpo). O modo é negociado com
+ * CMD_LINK_CONFIG_REQ_ID e passa a valer logo após a transação que leva a resposta.
+ *
+ * Handshake (dois GPIOs do escravo para o mestre):
+ * - READY (PB0): slot armado no DMA. Sobe logo antes de armar; o mestre só gera clock
+ *   CMD_LINK_ARM_US depois da borda de subida.
+ * - ATTN (PB1): há resposta ou telemetria esperando no escravo (em algum slot do
+ *   pipeline ou na fila). O mestre faz transações enquanto ATTN estiver alto; sem ATTN
+ *   não há nada para ler e o mestre não precisa fazer polling.
+ */
+#define CMD_LINK_ARM_US 20 // Da subida do READY até o DMA armado (config. de SPI + DMA no driver STM32)
+#define CMD_LINK_MODE_FIXED    0
+#define CMD_LINK_MODE_VARIABLE 1
+
+#define CMD_LINK_MAGIC_MASTER 0xA5
+#define CMD_LINK_MAGIC_SLAVE  0x5A
+#define CMD_LINK_FIXED_SIZE   64
+#define CMD_LINK_MAX_BODY     FRAME_MAX_CMD_SIZE
+
+typedef struct __attribute__((packed)) cmd_link_hdr_s
+{
+    uint8_t magic; // CMD_LINK_MAGIC_MASTER / CMD_LINK_MAGIC_SLAVE
+    uint8_t flags;
+    uint16_t len; // Bytes úteis que o remetente coloca no corpo
+} cmd_link_hdr_t;
+
+typedef struct __attribute__((packed)) cmd_link_config_req_s
+{
+    uint8_t mode;
+} cmd_link_config_req_t;
+
+typedef struct __attribute__((packed)) cmd_link_config_res_s
+{
+    uint8_t status;
+    uint8_t mode;
+    uint16_t max_body;
+} cmd_link_config_res_t;
+
+/* --- DIAGNÓSTICO: latência ponta a ponta (SPI -> decode -> FSM -> motor) ---
+ * 'cmd' é o command_id_t interno (protocol_defs.h): um SET_CONFIG vira 4 comandos.
+ * Tempos em microssegundos; médias por etapa ajudam a achar onde o tempo vai.
+ */
+typedef struct __attribute__((packed)) cmd_latency_req_s
+{
+    uint8_t cmd;
+    uint8_t reset; // != 0: zera as estatísticas do comando depois de ler
+} cmd_latency_req_t;
+
+typedef struct __attribute__((packed)) cmd_latency_res_s
+{
+    uint8_t cmd;
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t avg_us;
+    uint32_t max_us;
+    uint32_t decode_avg_us; // Fim da transação SPI -> comando decodificado
+    uint32_t queue_avg_us;  // Decodificado -> FSM retirou da fila
+    uint32_t fsm_avg_us;    // FSM -> motor atualizado
+} cmd_latency_res_t;
+
+/* --- TELEMETRIA (PUSH) ---
+ * O mestre assina os canais e a decimação com CMD_TLM_SUB_REQ_ID (channels = 0 cancela).
+ * A partir daí o escravo preenche o espaço livre das transações com frames
+ * CMD_TLM_DATA_ID (seq = CMD_SEQ_NONE), sem o mestre gastar pedidos.
+ * Cada registro é: timestamp (u32, ms) + os canais assinados, na ordem dos bits.
+ * 'first_sample' numera as amostras aceitas (após decimação): buraco = perda;
+ * 'dropped' conta registros descartados por fila cheia desde o frame anterior.
+ *
+ * Formatos ('format', escolhido na assinatura):
+ * - RAW: 'count' registros completos, cada um com cmd_tlm_record_size() bytes.
+ * - DELTA: o primeiro registro do frame é completo (keyframe); os seguintes levam,
+ *   para cada campo presente (timestamp e canais, mesma ordem), o varint zigzag da
+ *   diferença para o registro anterior. Cada frame decodifica sozinho: perder um
+ *   frame não corrompe os próximos.
+ */
+#define CMD_TLM_CH_BUBBLE     (1 << 0) // u16, mV
+#define CMD_TLM_CH_OCCLUSION  (1 << 1) // u16, mV (filtrado)
+#define CMD_TLM_CH_VOLUME_POT (1 << 2) // u16, mV
+#define CMD_TLM_CH_STATE      (1 << 3) // u8, pump_state_t
+#define CMD_TLM_CH_INFUSED    (1 << 4) // u32, volume infundido
+#define CMD_TLM_CH_PRESSURE   (1 << 5) // u16, mmHg
+#define CMD_TLM_CH_ALL        0x3F
+
+#define CMD_TLM_FMT_RAW   0
+#define CMD_TLM_FMT_DELTA 1
+
+#define CMD_TLM_DATA_HDR_SIZE 7
+#define CMD_TLM_RECORDS_MAX   (CMD_MAX_DATA_SIZE - CMD_TLM_DATA_HDR_SIZE)
+
+typedef struct __attribute__((packed)) cmd_tlm_sub_req_s
+{
+    uint8_t channels;   // Máscara CMD_TLM_CH_*
+    uint8_t decimation; // 1 = toda amostra do ADC (10 ms), N = uma a cada N
+    uint8_t format;     // CMD_TLM_FMT_*
+} cmd_tlm_sub_req_t;
+
+typedef struct __attribute__((packed)) cmd_tlm_sub_res_s
+{
+    uint8_t status;
+    uint8_t channels;
+    uint8_t decimation;
+    uint8_t format;
+    uint8_t record_size; // Bytes de um registro completo (RAW / keyframe) com os canais aceitos
+} cmd_tlm_sub_res_t;
+
+typedef struct __attribute__((packed)) cmd_tlm_data_s
+{
+    uint8_t channels;
+    uint8_t format;
+    uint8_t count; // Registros em 'records'
+    uint16_t first_sample;
+    uint16_t dropped;
+    uint8_t records[CMD_TLM_RECORDS_MAX];
+    uint8_t records_len; // Bytes usados em 'records' (não vai no fio: sai do tamanho do frame)
+} cmd_tlm_data_t;
+
+/* Registro de telemetria já decodificado (campos não assinados ficam em zero) */
+typedef struct cmd_tlm_record_s
+{
+    uint32_t timestamp;
+    uint16_t bubble_mv;
+    uint16_t occlusion_mv;
+    uint16_t volume_pot_mv;
+    uint8_t state;
+    uint32_t infused;
+    uint16_t pressure;
+} cmd_tlm_record_t;
+
+/* --- OTA ---
+ * START (tamanho do stream e do chunk), CHUNKs com offset e END. Chunk de até
+ * CMD_OTA_CHUNK_DATA_MAX, ou CMD_OTA_CHUNK_SIZE_DEFAULT se o START não diz; fora disso
+ * CMD_ERR_PARAM_RANGE. Todo chunk é cheio e alinhado, menos o último.
+ *
+ * Passo a passo: chunk com sequência recebe OTA_RES. Janela: chunks sem tag, em qualquer
+ * ordem dentro de CMD_OTA_WINDOW_CHUNKS a partir de next_offset; o OTA_STATUS dá o ACK
+ * cumulativo e o mapa 'missing', e o mestre só reenvia o que falta. Repetido é ignorado.
+ *
+ * Escritor: a gravação é em segundo plano. START (apaga o slot) e END só são respondidos
+ * quando ele termina; até lá o OTA_STATUS responde CMD_ERR_BUSY.
+ *
+ * Retomada (imagem crua): o escravo guarda um cursor que sobrevive a reset. Se total_size e
+ * image_crc do OTA_STATUS batem com a imagem do mestre, ele continua de next_offset (o chunk
+ * do meio vai inteiro); senão START.
+ *
+ * Comprimida / delta: image_size e flags no START. O stream é utl_lz e/ou um patch utl_delta
+ * sobre o slot0, com versão e CRC da base conferidos antes de gravar. Sem retomada.
+ *
+ * END: CRC-16 do stream e SHA-256 da imagem final; se não batem, CMD_ERR_CHECKSUM e sem swap.
+ */
+#define CMD_OTA_CHUNK_DATA_MAX     (CMD_MAX_DATA_SIZE - 5) // Payload máximo menos offset + len
+#define CMD_OTA_CHUNK_SIZE_DEFAULT 48 // Cabe num slot FIXED de 64 bytes
+#define CMD_OTA_WINDOW_CHUNKS      32 // Bits de cmd_ota_status_res_t.missing
+
+typedef struct __attribute__((packed))
+{
+    uint32_t total_size; // Bytes que os chunks levam (a imagem, ou o stream comprimido)
+    uint16_t chunk_size; // 0 = CMD_OTA_CHUNK_SIZE_DEFAULT (não vai no fio)
+    uint32_t image_size; // Imagem descomprimida; 0 = chunks com a imagem crua (não vai no fio)
+    uint8_t flags;       // CMD_OTA_FLAG_*, só com image_size; CMD_OTA_FLAG_LZ sozinho não vai no fio
+} cmd_ota_start_t;
+
+#define CMD_OTA_FLAG_LZ    0x01 // Chunks levam um stream utl_lz
+#define CMD_OTA_FLAG_DELTA 0x02 // Stream (descomprimido) é um patch utl_delta sobre o slot0
+
+typedef struct __attribute__((packed))
+{
+    uint32_t offset;
+    uint8_t len;
+    uint8_t data[CMD_OTA_CHUNK_DATA_MAX];
+} cmd_ota_chunk_t;
+
+#define CMD_OTA_SHA256_SIZE 32
+
+typedef struct __attribute__((packed))
+{
+    uint16_t image_crc;                  // CRC-16 dos total_size bytes dos chunks
+    uint8_t sha256[CMD_OTA_SHA256_SIZE]; // Da imagem gravada; tudo zero = END sem payload (não vai no fio)
+} cmd_ota_end_t;
+
+typedef struct
+{
+} cmd_ota_status_req_t;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t status;       // CMD_OK, ou CMD_ERR_INVALID_STATE (sem OTA em curso / erro de flash)
+    uint32_t next_offset; // Bytes já entregues à gravação, em ordem
+    uint32_t missing;     // Chunks da janela ainda não recebidos (bit 0 = chunk de next_offset)
+    uint32_t total_size;  // Imagem em curso (a do START, ou a retomada depois de um reset)
+    uint16_t chunk_size;
+    uint16_t image_crc;   // CRC-16 dos next_offset primeiros bytes, conferido pelo mestre ao retomar
+} cmd_ota_status_res_t;
+
 typedef enum cmd_sizes_e
 {
     CMD_VERSION_REQ_SIZE = 0,
@@ -157,7 +390,21 @@ typedef enum cmd_sizes_e
     CMD_SET_CONFIG_RES_SIZE = sizeof(cmd_set_config_res_t),
     CMD_ACTION_REQ_SIZE = 0,
     CMD_ACTION_RES_SIZE = sizeof(cmd_action_res_t),
+    CMD_OTA_START_REQ_SIZE = sizeof(cmd_ota_start_t),
+    CMD_OTA_START_REQ_MIN_SIZE = sizeof(uint32_t), // Só total_size
+    CMD_OTA_START_REQ_CHUNK_SIZE = sizeof(uint32_t) + sizeof(uint16_t), // total_size + chunk_size
+    CMD_OTA_START_REQ_IMAGE_SIZE = CMD_OTA_START_REQ_CHUNK_SIZE + sizeof(uint32_t), // + image_size (só LZ)
+    CMD_OTA_CHUNK_HDR_SIZE = sizeof(cmd_ota_chunk_t) - sizeof(((cmd_ota_chunk_t*) 0)->data),
+    CMD_OTA_END_REQ_SIZE = sizeof(cmd_ota_end_t), // Ou 0: sem conferência
     CMD_OTA_RES_SIZE = sizeof(cmd_action_res_t),
+    CMD_OTA_STATUS_REQ_SIZE = 0,
+    CMD_OTA_STATUS_RES_SIZE = sizeof(cmd_ota_status_res_t),
+    CMD_LINK_CONFIG_REQ_SIZE = sizeof(cmd_link_config_req_t),
+    CMD_LINK_CONFIG_RES_SIZE = sizeof(cmd_link_config_res_t),
+    CMD_LATENCY_REQ_SIZE = sizeof(cmd_latency_req_t),
+    CMD_LATENCY_RES_SIZE = sizeof(cmd_latency_res_t),
+    CMD_TLM_SUB_REQ_SIZE = sizeof(cmd_tlm_sub_req_t),
+    CMD_TLM_SUB_RES_SIZE = sizeof(cmd_tlm_sub_res_t),
 } cmd_sizes_t;
 
 typedef union cmd_cmds_u
@@ -175,25 +422,136 @@ typedef union cmd_cmds_u
     cmd_action_bolus_req_t bolus_req;
     cmd_action_res_t action_res;
     cmd_action_res_t ota_res;
+    cmd_link_config_req_t link_config_req;
+    cmd_link_config_res_t link_config_res;
+    cmd_latency_req_t latency_req;
+    cmd_latency_res_t latency_res;
+    cmd_tlm_sub_req_t tlm_sub_req;
+    cmd_tlm_sub_res_t tlm_sub_res;
+    cmd_tlm_data_t tlm_data;
+    cmd_ota_start_t ota_start_req;
+    cmd_ota_chunk_t ota_chunk_req;
+    cmd_ota_end_t ota_end_req;
+    cmd_ota_status_req_t ota_status_req;
+    cmd_ota_status_res_t ota_status_res;
 } cmd_cmds_t;
 
 #define CMD_NUM_CMDS 0x60
 
-bool cmd_decode(uint8_t* buffer, size_t size, uint8_t* src, uint8_t* dst, cmd_ids_t* id, cmd_cmds_t* decoded_cmd);
-bool cmd_encode(uint8_t* buffer, size_t* size, uint8_t* src, uint8_t* dst, cmd_ids_t* id, cmd_cmds_t* encoded_cmd);
+/* --- VISÃO DE FRAME (decode sem cópia) ---
+ * cmd_view valida ID, tamanho (pela CMD_TABLE) e CRC e devolve o header já lido e um
+ * ponteiro para o payload dentro do próprio buffer: nada é copiado. A visão vale enquanto
+ * o buffer valer (no Hub, durante o callback do frame_scanner).
+ * Campos do payload saem pelos acessores cmd_view_xxx, lidos direto do fio, ou por
+ * cmd_view_decode para quem quer a struct (mesmo decoder da tabela).
+ */
+typedef struct
+{
+    uint8_t* frame;        // SOF1 do frame
+    uint8_t* payload;      // frame + CMD_HDR_SIZE
+    uint16_t payload_size; // Já conferido contra a faixa da tabela
+    uint16_t crc;          // CRC do frame (chave do cache de replay)
+    uint8_t dst;
+    uint8_t src;
+    uint8_t seq;
+    cmd_ids_t id;
+} cmd_view_t;
+
+bool cmd_view(uint8_t* buffer, size_t size, cmd_view_t* view);
+
+/* Copia o payload da visão para a struct do comando (decoder da CMD_TABLE) */
+bool cmd_view_decode(const cmd_view_t* view, cmd_cmds_t* decoded_cmd);
+
+/* Acessores OTA: leem o payload no lugar */
+uint32_t cmd_view_ota_start_size(const cmd_view_t* view);
+
+/* Tamanho de chunk pedido no START (0 = não veio: CMD_OTA_CHUNK_SIZE_DEFAULT) */
+uint16_t cmd_view_ota_start_chunk(const cmd_view_t* view);
+
+/* Tamanho da imagem descomprimida (0 = não veio: imagem crua) */
+uint32_t cmd_view_ota_start_image(const cmd_view_t* view);
+
+/* CMD_OTA_FLAG_* (0 = imagem crua; START de 10 bytes = CMD_OTA_FLAG_LZ) */
+uint8_t cmd_view_ota_start_flags(const cmd_view_t* view);
+
+/* END: ponteiro para o SHA-256 dentro do frame e o CRC do stream, ou NULL se veio sem payload */
+const uint8_t* cmd_view_ota_end_digest(const cmd_view_t* view, uint16_t* image_crc);
+
+/* Chunk: ponteiro para os dados dentro do frame, ou NULL se 'len' não bate com o payload */
+uint8_t* cmd_view_ota_chunk(const cmd_view_t* view, uint32_t* offset, uint8_t* len);
+
+/* cmd_view + cmd_view_decode, para quem quer tudo copiado (ferramentas do host) */
+bool cmd_decode(uint8_t* buffer, size_t size, uint8_t* src, uint8_t* dst, uint8_t* seq, cmd_ids_t* id,
+                cmd_cmds_t* decoded_cmd);
+bool cmd_encode(uint8_t* buffer, size_t* size, uint8_t* src, uint8_t* dst, uint8_t* seq, cmd_ids_t* id,
+                cmd_cmds_t* encoded_cmd);
+
+/* --- TEMPLATES DE RESPOSTA FIXA ---
+ * Prefixo do frame (SOF, DST, SRC, ID) escrito uma vez, com o CRC parcial guardado:
+ * emitir copia o prefixo e só passa no CRC o que muda (SEQ, SIZE e payload).
+ * O Hub usa nos ACKs (ACTION_RES/OTA_RES), a resposta de cada chunk OTA.
+ */
+typedef struct
+{
+    uint8_t prefix[CMD_HDR_SEQ_OFFSET]; // AA 55 DST SRC ID
+    uint16_t prefix_crc;
+    uint16_t payload_size;
+} cmd_tmpl_t;
+
+void cmd_tmpl_init(cmd_tmpl_t* tmpl, uint8_t dst, uint8_t src, cmd_ids_t id, uint16_t payload_size);
+
+/* Escreve o frame em buffer (payload com tmpl->payload_size bytes). Retorna o tamanho do frame. */
+size_t cmd_tmpl_emit(const cmd_tmpl_t* tmpl, uint8_t seq, const uint8_t* payload, uint8_t* buffer);
 
 // ... (Mantenha os protótipos de encoders/decoders específicos) ...
-bool cmd_encode_version_req(uint8_t dst, uint8_t src, cmd_version_req_t* cmd, uint8_t* buffer, size_t* size);
-bool cmd_encode_version_res(uint8_t dst, uint8_t src, cmd_version_res_t* cmd, uint8_t* buffer, size_t* size);
-bool cmd_encode_status_req(uint8_t dst, uint8_t src, cmd_get_status_req_t* cmd, uint8_t* buffer, size_t* size);
-bool cmd_encode_status_res(uint8_t dst, uint8_t src, cmd_get_status_res_t* cmd, uint8_t* buffer, size_t* size);
-bool cmd_encode_config_req(uint8_t dst, uint8_t src, cmd_set_config_req_t* cmd, uint8_t* buffer, size_t* size);
-bool cmd_encode_config_res(uint8_t dst, uint8_t src, cmd_set_config_res_t* cmd, uint8_t* buffer, size_t* size);
-bool cmd_encode_action_run_req(uint8_t dst, uint8_t src, cmd_action_run_req_t* cmd, uint8_t* buffer, size_t* size);
-bool cmd_encode_action_pause_req(uint8_t dst, uint8_t src, cmd_action_pause_req_t* cmd, uint8_t* buffer, size_t* size);
-bool cmd_encode_action_abort_req(uint8_t dst, uint8_t src, cmd_action_abort_req_t* cmd, uint8_t* buffer, size_t* size);
-bool cmd_encode_action_res(uint8_t dst, uint8_t src, cmd_action_res_t* cmd, uint8_t* buffer, size_t* size);
-bool cmd_encode_ota_res(uint8_t dst, uint8_t src, cmd_action_res_t* cmd, uint8_t* buffer, size_t* size);
+bool cmd_encode_version_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_version_req_t* cmd, uint8_t* buffer,
+                            size_t* size);
+bool cmd_encode_version_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_version_res_t* cmd, uint8_t* buffer,
+                            size_t* size);
+bool cmd_encode_status_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_get_status_req_t* cmd, uint8_t* buffer,
+                           size_t* size);
+bool cmd_encode_status_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_get_status_res_t* cmd, uint8_t* buffer,
+                           size_t* size);
+bool cmd_encode_config_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_set_config_req_t* cmd, uint8_t* buffer,
+                           size_t* size);
+bool cmd_encode_config_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_set_config_res_t* cmd, uint8_t* buffer,
+                           size_t* size);
+bool cmd_encode_action_run_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_run_req_t* cmd, uint8_t* buffer,
+                               size_t* size);
+bool cmd_encode_action_pause_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_pause_req_t* cmd,
+                                 uint8_t* buffer, size_t* size);
+bool cmd_encode_action_abort_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_abort_req_t* cmd,
+                                 uint8_t* buffer, size_t* size);
+bool cmd_encode_action_purge_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_purge_req_t* cmd,
+                                 uint8_t* buffer, size_t* size);
+bool cmd_encode_action_bolus_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_bolus_req_t* cmd,
+                                 uint8_t* buffer, size_t* size);
+bool cmd_encode_action_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_res_t* cmd, uint8_t* buffer,
+                           size_t* size);
+bool cmd_encode_ota_start_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_ota_start_t* cmd, uint8_t* buffer,
+                              size_t* size);
+bool cmd_encode_ota_chunk_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_ota_chunk_t* cmd, uint8_t* buffer,
+                              size_t* size);
+bool cmd_encode_ota_end_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_ota_end_t* cmd, uint8_t* buffer,
+                            size_t* size);
+bool cmd_encode_ota_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_res_t* cmd, uint8_t* buffer, size_t* size);
+bool cmd_encode_ota_status_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_ota_status_req_t* cmd, uint8_t* buffer,
+                               size_t* size);
+bool cmd_encode_ota_status_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_ota_status_res_t* cmd, uint8_t* buffer,
+                               size_t* size);
+bool cmd_encode_link_config_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_link_config_req_t* cmd, uint8_t* buffer,
+                                size_t* size);
+bool cmd_encode_link_config_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_link_config_res_t* cmd, uint8_t* buffer,
+                                size_t* size);
+bool cmd_encode_latency_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_latency_req_t* cmd, uint8_t* buffer,
+                            size_t* size);
+bool cmd_encode_latency_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_latency_res_t* cmd, uint8_t* buffer,
+                            size_t* size);
+bool cmd_encode_tlm_sub_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_tlm_sub_req_t* cmd, uint8_t* buffer,
+                            size_t* size);
+bool cmd_encode_tlm_sub_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_tlm_sub_res_t* cmd, uint8_t* buffer,
+                            size_t* size);
+bool cmd_encode_tlm_data(uint8_t dst, uint8_t src, uint8_t seq, cmd_tlm_data_t* cmd, uint8_t* buffer, size_t* size);
 
 bool cmd_decode_version_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
 bool cmd_decode_version_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
@@ -207,25 +565,26 @@ bool cmd_decode_action_abort_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
 bool cmd_decode_action_purge_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
 bool cmd_decode_action_bolus_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
 bool cmd_decode_action_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
-
-uint16_t crc16_ccitt(const uint8_t* data, size_t length);
-bool cmd_decode_ota_generic(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
-
-// ... (Structs OTA) ...
-typedef struct __attribute__((packed))
-{
-    uint32_t total_size;
-} cmd_ota_start_t;
-
-typedef struct __attribute__((packed))
-{
-    uint32_t offset;
-    uint8_t len;
-    uint8_t data[48];
-} cmd_ota_chunk_t;
-
-typedef struct
-{
-} cmd_ota_end_t;
+bool cmd_decode_link_config_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_link_config_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_latency_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_latency_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_tlm_sub_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_tlm_sub_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_tlm_data(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_ota_start_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_ota_chunk_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_ota_end_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_ota_status_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+bool cmd_decode_ota_status_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+
+/* Registros de telemetria: tamanho, escrita e leitura conforme a máscara de canais */
+size_t cmd_tlm_record_size(uint8_t channels);
+size_t cmd_tlm_put_record(uint8_t channels, const cmd_tlm_record_t* rec, uint8_t* buffer);
+size_t cmd_tlm_get_record(uint8_t channels, cmd_tlm_record_t* rec, uint8_t* buffer);
+
+/* Empacota registros em 'data' (channels/format já preenchidos) sem passar de max_len bytes.
+ * Retorna quantos registros de 'recs' couberam (count/records_len atualizados). */
+size_t cmd_tlm_pack(cmd_tlm_data_t* data, const cmd_tlm_record_t* recs, size_t n, size_t max_len);
 
 #endif
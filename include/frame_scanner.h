@@ -0,0 +1,51 @@
+#ifndef FRAME_SCANNER_H
+#define FRAME_SCANNER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "cmd.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Scanner de frames orientado a blocos.
+ *
+ * Recebe o buffer inteiro de uma transação (DMA) em vez de byte a byte:
+ * - procura o SOF (AA 55) uma palavra por vez, pulando o padding de zeros;
+ * - copia header e payload+CRC com memcpy, em spans;
+ * - mantém o frame parcial entre chamadas (frame cortado entre transações).
+ *
+ * Não valida CRC: o frame completo é entregue ao callback, que decide (cmd_view).
+ * Não depende do Zephyr, compila também no host (test/frame_scan_bench.cpp).
+ */
+
+/* Entrega um frame completo (SOF até CRC). O buffer só vale durante a chamada. */
+typedef void (*frame_scanner_cb_t)(uint8_t* frame, size_t len, void* ctx);
+
+typedef struct frame_scanner_s
+{
+    frame_scanner_cb_t on_frame;
+    void* ctx;
+    uint16_t index;    // Bytes já montados em buffer (0 = caçando SOF)
+    uint16_t expected; // Tamanho total do frame (0 = header ainda incompleto)
+    bool sof1_pending; // Bloco anterior terminou em SOF1
+    uint8_t buffer[FRAME_MAX_CMD_SIZE];
+} frame_scanner_t;
+
+void frame_scanner_init(frame_scanner_t* scanner, frame_scanner_cb_t on_frame, void* ctx);
+
+/* Descarta qualquer frame parcial e volta a caçar SOF */
+void frame_scanner_reset(frame_scanner_t* scanner);
+
+/* Consome um bloco inteiro. Retorna o número de frames entregues ao callback. */
+size_t frame_scanner_feed(frame_scanner_t* scanner, const uint8_t* data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,16 +4,47 @@
 #include <zephyr/kernel.h>
 #include <stdint.h>
 #include "protocol_defs.h"
+#include "sensor_data.h"
 
 #define HUB_THREAD_STACK_SIZE 4096
 #define HUB_THREAD_PRIORITY   1
 
+/* Thread que só roda o transporte (arma o DMA do SPI): precisa preemptar o parser */
+#define HUB_LINK_THREAD_STACK_SIZE 1024
+#define HUB_LINK_THREAD_PRIORITY   0
+
+/* Profundidade do pipeline de slots do transporte (2 = ping-pong) */
+#define HUB_SLOTS 2
+
+/* Bytes reservados para respostas codificadas aguardando espaço numa transação */
+#define HUB_RES_FIFO_SIZE 1024
+
+/* Cache de replay: últimas respostas guardadas para retries com a mesma sequência */
+#define HUB_REPLAY_ENTRIES   8
+#define HUB_REPLAY_FRAME_MAX 40 // Cabe a resposta de latência (39 bytes)
+
+/* Fila de registros de telemetria assinados pelo mestre (cheia = descarta o mais antigo) */
+#define HUB_TLM_FIFO_RECORDS 48
+/* Registros retirados da fila por vez para montar frames */
+#define HUB_TLM_BATCH_MAX 32
+
 int hub_init(void);
 
+/* Publica o status (escritor único: Logic Engine). Status idêntico ao anterior é ignorado. */
 void hub_set_status(const pump_status_t* status);
 
-void hub_thread_entry(void* p1, void* p2, void* p3);
+/* Cópia consistente do último status publicado, sem lock. Retorna a geração
+ * (muda a cada publicação): geração igual = nada mudou desde a última leitura. */
+uint32_t hub_get_status(pump_status_t* out);
+
+/* Amostra do ADC já processada pela Logic Engine. Se há assinatura de telemetria,
+ * vira um registro na fila e segue no espaço livre das próximas transações. */
+void hub_telemetry_sample(const sensor_packet_t* sensor, const pump_status_t* status);
 
-int hub_get_command(pump_cmd_t* cmd);
+/* Outra thread deixou algo para o Hub mandar (OTA: resultado do escritor): sobe ATTN e
+ * acorda o transporte de stream parado esperando RX. */
+void hub_wake(void);
+
+void hub_thread_entry(void* p1, void* p2, void* p3);
 
 #endif
@@ -0,0 +1,72 @@
+#ifndef HUB_TRANSPORT_H
+#define HUB_TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "cmd.h"
+
+/*
+ * Transporte do Hub: move blocos de bytes entre o mestre e o escravo.
+ *
+ * O Hub (parser, process_valid_packet, fila de respostas, telemetria) só enxerga slots:
+ * a thread de link pega um slot livre, chama exchange() e entrega o slot preenchido
+ * para a thread do Hub. O que acontece dentro de exchange() é do backend:
+ *
+ * - SPI (hub_spi.c): uma transação com DMA, clock do mestre; modos FIXED/VARIABLE.
+ * - UART (hub_uart.c): API async na usart1; envia tx e espera bytes ou um kick.
+ * - PIPE (hub_pipe.c): socket Unix no host (native_sim); mesmo fluxo da UART.
+ *
+ * Backend escolhido no Kconfig (HUB_TRANSPORT_*). Nos backends de stream o bloco
+ * recebido é só "o que chegou": o frame_scanner já remonta frames cortados.
+ */
+
+/* Slot do pipeline: o transporte envia tx[0..tx_len) e devolve em rx o que chegou */
+typedef struct
+{
+    uint8_t rx[CMD_LINK_MAX_BODY];
+    uint8_t tx[CMD_LINK_MAX_BODY];
+    size_t rx_len;
+    size_t tx_len;
+    uint8_t mode;       // Modo de link com que o slot foi preparado (só o SPI usa)
+    bool pending;       // Leva respostas/telemetria: conta para o pino de atenção
+    uint32_t rx_cycles; // k_cycle_get_32() no fim da troca
+} hub_slot_t;
+
+typedef struct
+{
+    const char* name;
+
+    /* Mestre gera o clock (SPI): o escravo só fala quando o mestre lê, e no modo
+     * FIXED toda transação tem CMD_LINK_FIXED_SIZE bytes. Stream (UART/pipe): false,
+     * o slot leva só os bytes empacotados. */
+    bool master_clocked;
+
+    int (*init)(void);
+
+    /* Uma troca completa. Retorna < 0 em erro físico (a thread de link repete o slot), ou
+     * HUB_EXCHANGE_TX_LOST se o mestre não chegou a ler tx (rx vazio): as respostas do
+     * slot voltam para a fila do Hub em vez de se perderem. */
+    int (*exchange)(hub_slot_t* slot);
+
+    /* Hub tem algo para enviar (resposta ou telemetria): um backend de stream bloqueado
+     * esperando RX devolve o slot vazio. NULL no SPI (o mestre é quem puxa). */
+    void (*kick)(void);
+
+    /* Liga/desliga o sinal de atenção ao mestre (há resposta ou telemetria esperando).
+     * NULL nos backends de stream, que já empurram os bytes sozinhos. */
+    void (*attention)(bool active);
+
+    /* Chegou um frame válido: o backend zera seus contadores de erro (pode ser NULL) */
+    void (*frame_ok)(void);
+} hub_transport_t;
+
+#define HUB_EXCHANGE_TX_LOST 1
+
+/* Backend compilado (um só, pela escolha no Kconfig) */
+extern const hub_transport_t hub_transport;
+
+/* Backend viu lixo no lugar do header de link: o Hub volta ao modo FIXED */
+void hub_link_desync(void);
+
+#endif
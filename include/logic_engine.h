@@ -2,6 +2,7 @@
 #define LOGIC_ENGINE_H
 
 #include <zephyr/kernel.h>
+#include <stdbool.h>
 #include "protocol_defs.h"
 
 /* * Interface Pública:
@@ -11,4 +12,7 @@ extern struct k_msgq cmd_queue;
 
 void logic_thread_entry(void* p1, void* p2, void* p3);
 
+/* Estatísticas de latência do comando 'id'. reset = true zera depois de ler. */
+bool logic_get_latency(command_id_t id, pump_latency_t* out, bool reset);
+
 #endif
@@ -3,10 +3,57 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+
+/* Pedido aceito e com o escritor: a resposta sai por ota_take_result */
+#define OTA_PENDING 1
+
+/* Progresso do OTA em curso (OTA_STATUS) */
+typedef struct
+{
+    uint32_t next_offset; // Bytes entregues ao escritor em ordem (depois de retomar, pode cair no meio de um chunk)
+    uint32_t missing;     // Bit i = chunk (next_offset / chunk_size + i) ainda não recebido
+    uint32_t total_size;
+    uint16_t chunk_size;
+    uint16_t image_crc;   // CRC-16 dos next_offset primeiros bytes da imagem
+} ota_status_t;
+
+/* Retoma o OTA interrompido por um reset, se houver cursor persistido (chamar no boot) */
+void ota_init(void);
+
+/* Começa uma imagem nova: o escritor apaga o slot e o resultado sai por ota_take_result
+ * (OTA_PENDING). total_size = bytes que os chunks levam; chunk_size 0 = CMD_OTA_CHUNK_SIZE_DEFAULT;
+ * image_size != 0 = imagem de image_size bytes, vinda como 'flags' diz (CMD_OTA_FLAG_*):
+ * stream utl_lz, patch utl_delta sobre o slot0, ou os dois (image_size e flags andam juntos).
+ * -EINVAL se a imagem não cabe no slot, o chunk passa de CMD_OTA_CHUNK_DATA_MAX ou as
+ * flags não valem; -EBUSY se o escritor ainda está com o START ou o END anterior. */
+int ota_start(uint32_t total_size, uint16_t chunk_size, uint32_t image_size, uint8_t flags);
+
+/* Recebe o chunk que começa em 'offset', conferido contra a posição já entregue ao escritor
+ * (fora de ordem, dentro da janela, fica guardado até os anteriores chegarem). Não toca no
+ * flash: o chunk vai para a fila da thread de gravação.
+ * 0 = aceito ou repetido; -EINVAL = offset/tamanho inválido;
+ * -EPERM = sem OTA em curso; -ENOSPC = além da janela; outro < 0 = erro de flash anterior. */
+int ota_write_chunk(uint32_t offset, const uint8_t* data, size_t len);
+
+/* Progresso para o OTA_STATUS. 0 = OTA em curso e sem erro; -EBUSY = escritor apagando o slot ou
+ * fechando a imagem. */
+int ota_get_status(ota_status_t* st);
+
+/* Pede ao escritor que feche a imagem, confira e agende o swap, sem esperar a gravação:
+ * OTA_PENDING = resultado em ota_take_result. O resto da janela vai para a fila conforme o
+ * escritor abre lugar (a cada ota_take_result), e só então o FINISH.
+ * sha256/image_crc: SHA-256 da imagem e CRC-16 do stream vindos do END (NULL = END sem
+ * digest, agenda sem conferir). -EILSEQ se um dos dois não bate (o swap não é agendado);
+ * -EAGAIN se ainda falta receber algum chunk; -EINPROGRESS se o END anterior está pendente. */
+int ota_finish(const uint8_t* sha256, uint16_t image_crc);
+
+/* Resultado do pedido OTA_PENDING, uma vez, quando o escritor acaba (thread do Hub, a cada
+ * volta: com o END pendente, é aqui que o resto da janela anda). O escritor chama hub_wake;
+ * ota_result_ready diz, de qualquer thread, se há resultado ou lugar novo na fila. */
+bool ota_take_result(int* ret);
+bool ota_result_ready(void);
 
-void ota_start(uint32_t total_size);
-int ota_write_chunk(uint8_t* data, size_t len);
-void ota_finish(void);
 void ota_check_and_reboot(void);
 
 #endif
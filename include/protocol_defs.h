@@ -38,8 +38,22 @@ typedef struct
 {
     command_id_t id;
     float param;
+    uint32_t t_rx;      // k_cycle_get_32() no fim da transação SPI que trouxe o comando
+    uint32_t t_decoded; // k_cycle_get_32() quando o hub decodificou e entregou à Logic Engine
 } pump_cmd_t;
 
+/* Latência ponta a ponta por tipo de comando (SPI -> decode -> FSM -> motor) */
+typedef struct
+{
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t avg_us;
+    uint32_t max_us;
+    uint32_t decode_avg_us;
+    uint32_t queue_avg_us;
+    uint32_t fsm_avg_us;
+} pump_latency_t;
+
 typedef struct
 {
     pump_state_t current_state;
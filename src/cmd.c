@@ -1,15 +1,116 @@
+#include <string.h>
 #include "cmd.h"
 #include "utl_io.h"
 #include "utl_crc16.h"
+#include "utl_varint.h"
 
-// [HELPER] Função para escrever o SOF automaticamente
-static void write_sof(uint8_t** pbuf)
+// As structs de payload (packed) são a imagem do fio em little endian: encode/decode
+// copiam a struct inteira (utl_io_*_packed) em vez de um get/put por campo.
+_Static_assert(UTL_IO_LITTLE_ENDIAN, "cmd.c: payloads packed assumem CPU little endian");
+
+// --- ESCRITOR DE FRAME (uma passada) ---
+// Cada pedaço (header, payload) vai para o buffer de saída e logo em seguida para o CRC
+// corrente, ainda no cache: o trailer só grava o CRC acumulado, sem reler o frame. O buffer pode ser o destino final
+// (slot de DMA ou fila de respostas), não há cópia intermediária.
+typedef struct
+{
+    uint8_t* start;
+    uint8_t* p;
+    uint16_t crc;
+} cmd_writer_t;
+
+static inline void cmd_w_put8(cmd_writer_t* w, uint8_t value)
+{
+    *w->p++ = value;
+    w->crc = utl_crc16_byte(w->crc, value);
+}
+
+static inline void cmd_w_put16(cmd_writer_t* w, uint16_t value)
+{
+    cmd_w_put8(w, (uint8_t) value);
+    cmd_w_put8(w, (uint8_t) (value >> 8));
+}
+
+// Blocos (dados de OTA, registros de telemetria) passam pelo motor em fatias do CRC
+static inline void cmd_w_bytes(cmd_writer_t* w, const uint8_t* data, size_t len)
+{
+    memcpy(w->p, data, len);
+    w->crc = utl_crc16_update(w->crc, data, len);
+    w->p += len;
+}
+
+// Payload packed inteiro (struct = imagem do fio): uma cópia e o CRC em fatias
+static inline void cmd_w_packed(cmd_writer_t* w, const void* payload, size_t len)
 {
-    utl_io_put8_tl_ap(CMD_SOF_1_BYTE, *pbuf);
-    utl_io_put8_tl_ap(CMD_SOF_2_BYTE, *pbuf);
+    uint8_t* start = w->p;
+    w->p = utl_io_put_packed_tl(payload, len, w->p);
+    w->crc = utl_crc16_update(w->crc, start, len);
 }
 
-bool cmd_decode(uint8_t* buffer, size_t size, uint8_t* src, uint8_t* dst, cmd_ids_t* id, cmd_cmds_t* decoded_cmd)
+// [HELPER] Header completo (SOF + DST + SRC + ID + SEQ + SIZE): 8 bytes, uma volta do CRC em fatias
+static inline void cmd_w_begin(cmd_writer_t* w, uint8_t* buffer, uint8_t dst, uint8_t src, uint8_t seq, cmd_ids_t id,
+                               uint16_t size)
+{
+    buffer[0] = CMD_SOF_1_BYTE;
+    buffer[1] = CMD_SOF_2_BYTE;
+    buffer[2] = dst;
+    buffer[3] = src;
+    buffer[CMD_HDR_ID_OFFSET] = (uint8_t) id;
+    buffer[CMD_HDR_SEQ_OFFSET] = seq;
+    utl_io_put16_tl(size, buffer + CMD_HDR_SIZE_OFFSET);
+
+    w->start = buffer;
+    w->p = buffer + CMD_HDR_SIZE;
+    w->crc = utl_crc16_update(utl_crc16_init(), buffer, CMD_HDR_SIZE);
+}
+
+// [HELPER] Fecha o frame com o CRC (sobre SOF + Header + Payload) já acumulado
+static inline bool cmd_w_end(cmd_writer_t* w, size_t* size)
+{
+    uint16_t crc = utl_crc16_final(w->crc);
+    *w->p++ = (uint8_t) crc;
+    *w->p++ = (uint8_t) (crc >> 8);
+    *size = (size_t) (w->p - w->start);
+    return true;
+}
+
+// --- TABELA DE COMANDOS (gerada de CMD_TABLE em cmd.h) ---
+typedef bool (*cmd_encoder_t)(uint8_t dst, uint8_t src, uint8_t seq, cmd_cmds_t* cmd, uint8_t* buffer,
+                              size_t* size);
+typedef bool (*cmd_decoder_t)(cmd_cmds_t* cmd, uint8_t* buffer, size_t size);
+
+typedef struct
+{
+    uint8_t min_size; // Faixa de tamanho de payload aceita no decode
+    uint8_t max_size;
+    cmd_encoder_t encode;
+    cmd_decoder_t decode;
+} cmd_desc_t;
+
+// Adaptador: encoder tipado -> assinatura única da tabela (o compilador reduz a um salto)
+#define CMD_TABLE_ENCODER(name, id, member, min, max, enc, dec, hub)                                            \
+    static bool cmd_table_encode_##name(uint8_t dst, uint8_t src, uint8_t seq, cmd_cmds_t* cmd, uint8_t* buffer, \
+                                        size_t* size)                                                          \
+    {                                                                                                          \
+        return cmd_encode_##enc(dst, src, seq, &cmd->member, buffer, size);                                    \
+    }
+CMD_TABLE(CMD_TABLE_ENCODER)
+#undef CMD_TABLE_ENCODER
+
+// Indexada pelo ID do frame; IDs fora de CMD_TABLE ficam zerados (encode/decode NULL)
+static const cmd_desc_t cmd_table[CMD_NUM_CMDS] = {
+#define CMD_TABLE_DESC(name, id, member, min, max, enc, dec, hub)                                               \
+    [CMD_##name##_ID] = {                                                                                       \
+        .min_size = (min),                                                                                      \
+        .max_size = (max),                                                                                      \
+        .encode = cmd_table_encode_##name,                                                                      \
+        .decode = cmd_decode_##dec,                                                                             \
+    },
+    CMD_TABLE(CMD_TABLE_DESC)
+#undef CMD_TABLE_DESC
+};
+
+bool cmd_view(uint8_t* buffer, size_t size, cmd_view_t* view)
 {
     if(size < CMD_HDR_SIZE + CMD_TRAILER_SIZE)
         return false;
@@ -23,13 +124,19 @@ bool cmd_decode(uint8_t* buffer, size_t size, uint8_t* src, uint8_t* dst, cmd_id
     utl_io_get8_fl_ap(pbuf); // Pula SOF2
 
     // Agora lê o resto normalmente
-    *dst = utl_io_get8_fl_ap(pbuf);
-    *src = utl_io_get8_fl_ap(pbuf);
+    view->dst = utl_io_get8_fl_ap(pbuf);
+    view->src = utl_io_get8_fl_ap(pbuf);
     uint8_t raw_id = utl_io_get8_fl_ap(pbuf);
-    *id = (cmd_ids_t) raw_id;
+    view->id = (cmd_ids_t) raw_id;
+    view->seq = utl_io_get8_fl_ap(pbuf);
     uint16_t payload_size = utl_io_get16_fl_ap(pbuf);
 
-    if(*id >= CMD_NUM_CMDS)
+    if(raw_id >= CMD_NUM_CMDS)
+        return false;
+
+    // ID desconhecido ou tamanho fora da faixa: descarta antes de gastar o CRC
+    const cmd_desc_t* desc = &cmd_table[raw_id];
+    if(desc->decode == NULL || payload_size < desc->min_size || payload_size > desc->max_size)
         return false;
 
     size_t real_packet_len = payload_size + CMD_HDR_SIZE + CMD_TRAILER_SIZE;
@@ -38,252 +145,314 @@ bool cmd_decode(uint8_t* buffer, size_t size, uint8_t* src, uint8_t* dst, cmd_id
 
     // O CRC agora é calculado sobre TODO o pacote (incluindo SOF)
     uint16_t crc = utl_io_get16_fl(buffer + real_packet_len - 2);
-    uint16_t crc_calc = utl_crc16_data(buffer, real_packet_len - 2, 0xFFFF);
+    uint16_t crc_calc = utl_crc16_final(utl_crc16_update(utl_crc16_init(), buffer, real_packet_len - 2));
 
     if(crc != crc_calc)
         return false;
 
-    // ... (Switch e Tabela de Decoders permanecem iguais ao seu original) ...
-    // Vou resumir aqui, mas MANTENHA o conteúdo do seu switch e tabela originais
-    switch(*id)
-    {
-    case CMD_VERSION_REQ_ID:
-    case CMD_VERSION_RES_ID:
-    case CMD_GET_STATUS_REQ_ID:
-    case CMD_GET_STATUS_RES_ID:
-    case CMD_SET_CONFIG_REQ_ID:
-    case CMD_SET_CONFIG_RES_ID:
-    case CMD_ACTION_RUN_REQ_ID:
-    case CMD_ACTION_PAUSE_REQ_ID:
-    case CMD_ACTION_ABORT_REQ_ID:
-    case CMD_ACTION_PURGE_REQ_ID:
-    case CMD_ACTION_BOLUS_REQ_ID:
-    case CMD_ACTION_RES_ID:
-    case CMD_OTA_START_REQ_ID:
-    case CMD_OTA_CHUNK_REQ_ID:
-    case CMD_OTA_END_REQ_ID:
-        break;
-    default:
+    // pbuf agora aponta para o INÍCIO DO PAYLOAD
+    view->frame = buffer;
+    view->payload = pbuf;
+    view->payload_size = payload_size;
+    view->crc = crc;
+    return true;
+}
+
+bool cmd_view_decode(const cmd_view_t* view, cmd_cmds_t* decoded_cmd)
+{
+    return cmd_table[view->id].decode(decoded_cmd, view->payload, view->payload_size);
+}
+
+uint32_t cmd_view_ota_start_size(const cmd_view_t* view)
+{
+    return utl_io_get32_fl(view->payload);
+}
+
+uint16_t cmd_view_ota_start_chunk(const cmd_view_t* view)
+{
+    if(view->payload_size < CMD_OTA_START_REQ_CHUNK_SIZE)
+        return 0;
+    return utl_io_get16_fl(view->payload + CMD_OTA_START_REQ_MIN_SIZE);
+}
+
+uint32_t cmd_view_ota_start_image(const cmd_view_t* view)
+{
+    if(view->payload_size < CMD_OTA_START_REQ_IMAGE_SIZE)
+        return 0;
+    return utl_io_get32_fl(view->payload + CMD_OTA_START_REQ_CHUNK_SIZE);
+}
+
+uint8_t cmd_view_ota_start_flags(const cmd_view_t* view)
+{
+    if(view->payload_size < CMD_OTA_START_REQ_IMAGE_SIZE)
+        return 0;
+    if(view->payload_size < CMD_OTA_START_REQ_SIZE)
+        return CMD_OTA_FLAG_LZ;
+    return view->payload[CMD_OTA_START_REQ_IMAGE_SIZE];
+}
+
+const uint8_t* cmd_view_ota_end_digest(const cmd_view_t* view, uint16_t* image_crc)
+{
+    if(view->payload_size != CMD_OTA_END_REQ_SIZE)
+        return NULL;
+    *image_crc = utl_io_get16_fl(view->payload);
+    return view->payload + sizeof(uint16_t);
+}
+
+uint8_t* cmd_view_ota_chunk(const cmd_view_t* view, uint32_t* offset, uint8_t* len)
+{
+    // Estrutura Chunk: [Offset (4)] + [Len (1)] + [Data...]
+    uint8_t* pbuf = view->payload;
+    *offset = utl_io_get32_fl_ap(pbuf);
+    *len = utl_io_get8_fl_ap(pbuf);
+
+    if(CMD_OTA_CHUNK_HDR_SIZE + *len != view->payload_size)
+        return NULL;
+    return pbuf;
+}
+
+bool cmd_decode(uint8_t* buffer, size_t size, uint8_t* src, uint8_t* dst, uint8_t* seq, cmd_ids_t* id,
+                cmd_cmds_t* decoded_cmd)
+{
+    cmd_view_t view;
+
+    if(!cmd_view(buffer, size, &view))
         return false;
-    }
 
-    bool (*decoders[])(cmd_cmds_t* cmd, uint8_t* buffer, size_t size) = {
-        [CMD_VERSION_REQ_ID] = cmd_decode_version_req,
-        [CMD_VERSION_RES_ID] = cmd_decode_version_res,
-        [CMD_GET_STATUS_REQ_ID] = cmd_decode_status_req,
-        [CMD_GET_STATUS_RES_ID] = cmd_decode_status_res,
-        [CMD_SET_CONFIG_REQ_ID] = cmd_decode_config_req,
-        [CMD_SET_CONFIG_RES_ID] = cmd_decode_config_res,
-        [CMD_ACTION_RES_ID] = cmd_decode_action_res,
-        [CMD_ACTION_RUN_REQ_ID] = cmd_decode_action_run_req,
-        [CMD_ACTION_PAUSE_REQ_ID] = cmd_decode_action_pause_req,
-        [CMD_ACTION_ABORT_REQ_ID] = cmd_decode_action_abort_req,
-        [CMD_ACTION_PURGE_REQ_ID] = cmd_decode_action_purge_req,
-        [CMD_ACTION_BOLUS_REQ_ID] = cmd_decode_action_bolus_req,
-        [CMD_OTA_START_REQ_ID] = cmd_decode_ota_generic,
-        [CMD_OTA_CHUNK_REQ_ID] = cmd_decode_ota_generic,
-        [CMD_OTA_END_REQ_ID] = cmd_decode_ota_generic,
-    };
-
-    if(decoders[(uint8_t) *id] == NULL)
+    *src = view.src;
+    *dst = view.dst;
+    *seq = view.seq;
+    *id = view.id;
+    return cmd_view_decode(&view, decoded_cmd);
+}
+
+bool cmd_encode(uint8_t* buffer, size_t* size, uint8_t* src, uint8_t* dst, uint8_t* seq, cmd_ids_t* id,
+                cmd_cmds_t* encoded_cmd)
+{
+    if((unsigned) *id >= CMD_NUM_CMDS || cmd_table[*id].encode == NULL)
         return false;
 
-    // Passamos pbuf, que agora aponta para o INÍCIO DO PAYLOAD
-    return decoders[(uint8_t) *id](decoded_cmd, pbuf, payload_size);
+    return cmd_table[*id].encode(*dst, *src, *seq, encoded_cmd, buffer, size);
 }
 
-// ... (Mantenha a função cmd_encode igual, ela apenas chama os específicos) ...
-bool cmd_encode(uint8_t* buffer, size_t* size, uint8_t* src, uint8_t* dst, cmd_ids_t* id, cmd_cmds_t* encoded_cmd)
+void cmd_tmpl_init(cmd_tmpl_t* tmpl, uint8_t dst, uint8_t src, cmd_ids_t id, uint16_t payload_size)
 {
-    // ... (Copie o switch do seu arquivo original) ...
-    // Vou colocar o exemplo de um case para você ver:
-    bool status = false;
-    switch(*id)
-    {
-    case CMD_VERSION_REQ_ID:
-        status = cmd_encode_version_req(*dst, *src, &encoded_cmd->version_req, buffer, size);
-        break;
-    // ... repita para todos os casos ...
-    // CERTIFIQUE-SE DE COPIAR TODOS OS CASES DO SEU ARQUIVO ORIGINAL
-    case CMD_GET_STATUS_REQ_ID:
-        status = cmd_encode_status_req(*dst, *src, &encoded_cmd->status_req, buffer, size);
-        break;
-    case CMD_SET_CONFIG_REQ_ID:
-        status = cmd_encode_config_req(*dst, *src, &encoded_cmd->config_req, buffer, size);
-        break;
-    case CMD_ACTION_RUN_REQ_ID:
-        status = cmd_encode_action_run_req(*dst, *src, &encoded_cmd->run_req, buffer, size);
-        break;
-    case CMD_ACTION_PAUSE_REQ_ID:
-        status = cmd_encode_action_pause_req(*dst, *src, &encoded_cmd->pause_req, buffer, size);
-        break;
-    case CMD_ACTION_ABORT_REQ_ID:
-        status = cmd_encode_action_abort_req(*dst, *src, &encoded_cmd->abort_req, buffer, size);
-        break;
-    case CMD_VERSION_RES_ID:
-        status = cmd_encode_version_res(*dst, *src, &encoded_cmd->version_res, buffer, size);
-        break;
-    case CMD_GET_STATUS_RES_ID:
-        status = cmd_encode_status_res(*dst, *src, &encoded_cmd->status_res, buffer, size);
-        break;
-    case CMD_SET_CONFIG_RES_ID:
-        status = cmd_encode_config_res(*dst, *src, &encoded_cmd->config_res, buffer, size);
-        break;
-    case CMD_ACTION_RES_ID:
-        status = cmd_encode_action_res(*dst, *src, &encoded_cmd->action_res, buffer, size);
-        break;
-    case CMD_OTA_RES_ID:
-        status = cmd_encode_ota_res(*dst, *src, &encoded_cmd->action_res, buffer, size);
-        break;
-    default:
-        status = false;
-        break;
-    }
-    return status;
+    cmd_writer_t w = {.start = tmpl->prefix, .p = tmpl->prefix, .crc = utl_crc16_init()};
+
+    cmd_w_put8(&w, CMD_SOF_1_BYTE);
+    cmd_w_put8(&w, CMD_SOF_2_BYTE);
+    cmd_w_put8(&w, dst);
+    cmd_w_put8(&w, src);
+    cmd_w_put8(&w, id);
+    tmpl->prefix_crc = w.crc;
+    tmpl->payload_size = payload_size;
+}
+
+size_t cmd_tmpl_emit(const cmd_tmpl_t* tmpl, uint8_t seq, const uint8_t* payload, uint8_t* buffer)
+{
+    cmd_writer_t w = {.start = buffer, .p = buffer + sizeof(tmpl->prefix), .crc = tmpl->prefix_crc};
+    size_t size;
+
+    memcpy(buffer, tmpl->prefix, sizeof(tmpl->prefix));
+    cmd_w_put8(&w, seq);
+    cmd_w_put16(&w, tmpl->payload_size);
+    cmd_w_bytes(&w, payload, tmpl->payload_size);
+    cmd_w_end(&w, &size);
+    return size;
 }
 
 // [MUDANÇA CRÍTICA ENCODE] Função genérica de header com SOF
-static bool cmd_encode_header_only(uint8_t dst, uint8_t src, cmd_ids_t id, uint8_t* buffer, size_t* size)
+static bool cmd_encode_header_only(uint8_t dst, uint8_t src, uint8_t seq, cmd_ids_t id, uint8_t* buffer,
+                                   size_t* size)
 {
-    uint8_t* pbuf = buffer;
+    cmd_writer_t w;
 
-    // 1. Escreve SOF
-    write_sof(&pbuf);
+    cmd_w_begin(&w, buffer, dst, src, seq, id, 0); // Payload Size 0
+    return cmd_w_end(&w, size);
+}
 
-    // 2. Escreve Resto do Header
-    utl_io_put8_tl_ap(dst, pbuf);
-    utl_io_put8_tl_ap(src, pbuf);
-    utl_io_put8_tl_ap(id, pbuf);
-    utl_io_put16_tl_ap(0, pbuf); // Payload Size 0
+// [HELPER] Header + payload packed (structs de cmd.h na ordem do fio, little endian)
+static bool cmd_encode_packed(uint8_t dst, uint8_t src, uint8_t seq, cmd_ids_t id, const void* payload,
+                              uint16_t payload_size, uint8_t* buffer, size_t* size)
+{
+    cmd_writer_t w;
 
-    // 3. Calcula CRC (SOF + Header)
-    size_t len_so_far = pbuf - buffer;
-    utl_io_put16_tl_ap(utl_crc16_data(buffer, len_so_far, 0xFFFF), pbuf);
+    cmd_w_begin(&w, buffer, dst, src, seq, id, payload_size);
+    cmd_w_packed(&w, payload, payload_size);
+    return cmd_w_end(&w, size);
+}
 
-    *size = (pbuf - buffer);
+// OTA_END: digest zerado = END sem payload (sem conferência)
+static bool cmd_ota_end_no_digest(const cmd_ota_end_t* cmd)
+{
+    for(size_t i = 0; i < sizeof(cmd->sha256); i++)
+    {
+        if(cmd->sha256[i] != 0)
+            return false;
+    }
     return true;
 }
 
 // ... Encoders Simples (Chamam cmd_encode_header_only) ...
-// (Mantenha as funções wrapper como run_req, pause_req, etc. iguais ao seu código original)
-bool cmd_encode_version_req(uint8_t dst, uint8_t src, cmd_version_req_t* cmd, uint8_t* buffer, size_t* size)
+bool cmd_encode_version_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_version_req_t* cmd, uint8_t* buffer,
+                            size_t* size)
 {
-    return cmd_encode_header_only(dst, src, CMD_VERSION_REQ_ID, buffer, size);
+    return cmd_encode_header_only(dst, src, seq, CMD_VERSION_REQ_ID, buffer, size);
 }
-bool cmd_encode_status_req(uint8_t dst, uint8_t src, cmd_get_status_req_t* cmd, uint8_t* buffer, size_t* size)
+bool cmd_encode_status_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_get_status_req_t* cmd, uint8_t* buffer,
+                           size_t* size)
 {
-    return cmd_encode_header_only(dst, src, CMD_GET_STATUS_REQ_ID, buffer, size);
+    return cmd_encode_header_only(dst, src, seq, CMD_GET_STATUS_REQ_ID, buffer, size);
 }
-bool cmd_encode_action_run_req(uint8_t dst, uint8_t src, cmd_action_run_req_t* cmd, uint8_t* buffer, size_t* size)
+bool cmd_encode_action_run_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_run_req_t* cmd, uint8_t* buffer,
+                               size_t* size)
 {
-    return cmd_encode_header_only(dst, src, CMD_ACTION_RUN_REQ_ID, buffer, size);
+    return cmd_encode_header_only(dst, src, seq, CMD_ACTION_RUN_REQ_ID, buffer, size);
 }
-bool cmd_encode_action_pause_req(uint8_t dst, uint8_t src, cmd_action_pause_req_t* cmd, uint8_t* buffer, size_t* size)
+bool cmd_encode_action_pause_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_pause_req_t* cmd,
+                                 uint8_t* buffer, size_t* size)
 {
-    return cmd_encode_header_only(dst, src, CMD_ACTION_PAUSE_REQ_ID, buffer, size);
+    return cmd_encode_header_only(dst, src, seq, CMD_ACTION_PAUSE_REQ_ID, buffer, size);
 }
-bool cmd_encode_action_abort_req(uint8_t dst, uint8_t src, cmd_action_abort_req_t* cmd, uint8_t* buffer, size_t* size)
+bool cmd_encode_action_abort_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_abort_req_t* cmd,
+                                 uint8_t* buffer, size_t* size)
 {
-    return cmd_encode_header_only(dst, src, CMD_ACTION_ABORT_REQ_ID, buffer, size);
+    return cmd_encode_header_only(dst, src, seq, CMD_ACTION_ABORT_REQ_ID, buffer, size);
+}
+bool cmd_encode_action_purge_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_purge_req_t* cmd,
+                                 uint8_t* buffer, size_t* size)
+{
+    return cmd_encode_header_only(dst, src, seq, CMD_ACTION_PURGE_REQ_ID, buffer, size);
+}
+bool cmd_encode_action_bolus_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_bolus_req_t* cmd,
+                                 uint8_t* buffer, size_t* size)
+{
+    return cmd_encode_header_only(dst, src, seq, CMD_ACTION_BOLUS_REQ_ID, buffer, size);
+}
+bool cmd_encode_ota_end_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_ota_end_t* cmd, uint8_t* buffer,
+                            size_t* size)
+{
+    if(cmd_ota_end_no_digest(cmd))
+        return cmd_encode_header_only(dst, src, seq, CMD_OTA_END_REQ_ID, buffer, size);
+    return cmd_encode_packed(dst, src, seq, CMD_OTA_END_REQ_ID, cmd, CMD_OTA_END_REQ_SIZE, buffer, size);
+}
+bool cmd_encode_ota_status_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_ota_status_req_t* cmd, uint8_t* buffer,
+                               size_t* size)
+{
+    return cmd_encode_header_only(dst, src, seq, CMD_OTA_STATUS_REQ_ID, buffer, size);
 }
 
-// [MUDANÇA CRÍTICA ENCODE] Payloads Complexos precisam de write_sof() manual
-bool cmd_encode_config_req(uint8_t dst, uint8_t src, cmd_set_config_req_t* cmd, uint8_t* buffer, size_t* size)
+// [MUDANÇA CRÍTICA ENCODE] Payloads Complexos
+bool cmd_encode_config_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_set_config_req_t* cmd, uint8_t* buffer,
+                           size_t* size)
 {
-    uint8_t* pbuf = buffer;
+    return cmd_encode_packed(dst, src, seq, CMD_SET_CONFIG_REQ_ID, cmd, CMD_SET_CONFIG_REQ_SIZE, buffer, size);
+}
 
-    write_sof(&pbuf); // <--- AQUI
+bool cmd_encode_version_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_version_res_t* cmd, uint8_t* buffer,
+                            size_t* size)
+{
+    return cmd_encode_packed(dst, src, seq, CMD_VERSION_RES_ID, cmd, CMD_VERSION_RES_SIZE, buffer, size);
+}
 
-    utl_io_put8_tl_ap(dst, pbuf);
-    utl_io_put8_tl_ap(src, pbuf);
-    utl_io_put8_tl_ap(CMD_SET_CONFIG_REQ_ID, pbuf);
-    utl_io_put16_tl_ap(CMD_SET_CONFIG_REQ_SIZE, pbuf);
+bool cmd_encode_status_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_get_status_res_t* cmd, uint8_t* buffer,
+                           size_t* size)
+{
+    return cmd_encode_packed(dst, src, seq, CMD_GET_STATUS_RES_ID, cmd, CMD_GET_STATUS_RES_SIZE, buffer, size);
+}
 
-    utl_io_put32_tl_ap(cmd->config.volume, pbuf);
-    utl_io_put32_tl_ap(cmd->config.flow_rate, pbuf);
-    utl_io_put8_tl_ap(cmd->config.diameter, pbuf);
-    utl_io_put8_tl_ap(cmd->config.mode, pbuf);
+bool cmd_encode_config_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_set_config_res_t* cmd, uint8_t* buffer,
+                           size_t* size)
+{
+    return cmd_encode_packed(dst, src, seq, CMD_SET_CONFIG_RES_ID, cmd, CMD_SET_CONFIG_RES_SIZE, buffer, size);
+}
 
-    utl_io_put16_tl_ap(utl_crc16_data(buffer, (pbuf - buffer), 0xFFFF), pbuf);
-    *size = (pbuf - buffer);
-    return true;
+bool cmd_encode_action_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_res_t* cmd, uint8_t* buffer,
+                           size_t* size)
+{
+    return cmd_encode_packed(dst, src, seq, CMD_ACTION_RES_ID, cmd, CMD_ACTION_RES_SIZE, buffer, size);
 }
 
-bool cmd_encode_version_res(uint8_t dst, uint8_t src, cmd_version_res_t* cmd, uint8_t* buffer, size_t* size)
+bool cmd_encode_ota_start_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_ota_start_t* cmd, uint8_t* buffer,
+                              size_t* size)
 {
-    uint8_t* pbuf = buffer;
-    write_sof(&pbuf); // <--- AQUI
-    utl_io_put8_tl_ap(dst, pbuf);
-    utl_io_put8_tl_ap(src, pbuf);
-    utl_io_put8_tl_ap(CMD_VERSION_RES_ID, pbuf);
-    utl_io_put16_tl_ap(CMD_VERSION_RES_SIZE, pbuf);
-    utl_io_put8_tl_ap(cmd->major, pbuf);
-    utl_io_put8_tl_ap(cmd->minor, pbuf);
-    utl_io_put8_tl_ap(cmd->patch, pbuf);
-    utl_io_put16_tl_ap(utl_crc16_data(buffer, (pbuf - buffer), 0xFFFF), pbuf);
-    *size = (pbuf - buffer);
-    return true;
+    // Sem chunk_size sai o START antigo, só com o tamanho da imagem; image_size só na
+    // comprimida ou delta, e flags só quando não é a comprimida simples
+    size_t payload_size = CMD_OTA_START_REQ_MIN_SIZE;
+    if(cmd->image_size != 0)
+        payload_size = (cmd->flags == CMD_OTA_FLAG_LZ) ? CMD_OTA_START_REQ_IMAGE_SIZE : CMD_OTA_START_REQ_SIZE;
+    else if(cmd->chunk_size != 0)
+        payload_size = CMD_OTA_START_REQ_CHUNK_SIZE;
+    return cmd_encode_packed(dst, src, seq, CMD_OTA_START_REQ_ID, cmd, payload_size, buffer, size);
 }
 
-bool cmd_encode_status_res(uint8_t dst, uint8_t src, cmd_get_status_res_t* cmd, uint8_t* buffer, size_t* size)
+bool cmd_encode_ota_chunk_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_ota_chunk_t* cmd, uint8_t* buffer,
+                              size_t* size)
 {
-    uint8_t* pbuf = buffer;
-    write_sof(&pbuf); // <--- AQUI
-    utl_io_put8_tl_ap(dst, pbuf);
-    utl_io_put8_tl_ap(src, pbuf);
-    utl_io_put8_tl_ap(CMD_GET_STATUS_RES_ID, pbuf);
-    utl_io_put16_tl_ap(CMD_GET_STATUS_RES_SIZE, pbuf);
-    utl_io_put8_tl_ap(cmd->status_data.current_state, pbuf);
-    utl_io_put32_tl_ap(cmd->status_data.volume, pbuf);
-    utl_io_put32_tl_ap(cmd->status_data.flow_rate_set, pbuf);
-    utl_io_put32_tl_ap(cmd->status_data.pressure, pbuf);
-    utl_io_put8_tl_ap(cmd->status_data.alarm_active, pbuf);
-    utl_io_put16_tl_ap(utl_crc16_data(buffer, (pbuf - buffer), 0xFFFF), pbuf);
-    *size = (pbuf - buffer);
-    return true;
+    if(cmd->len > sizeof(cmd->data))
+        return false;
+    // offset + len + dados são contíguos na struct
+    return cmd_encode_packed(dst, src, seq, CMD_OTA_CHUNK_REQ_ID, cmd, CMD_OTA_CHUNK_HDR_SIZE + cmd->len, buffer,
+                             size);
 }
 
-bool cmd_encode_config_res(uint8_t dst, uint8_t src, cmd_set_config_res_t* cmd, uint8_t* buffer, size_t* size)
+bool cmd_encode_ota_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_action_res_t* cmd, uint8_t* buffer, size_t* size)
 {
-    uint8_t* pbuf = buffer;
-    write_sof(&pbuf); // <--- AQUI
-    utl_io_put8_tl_ap(dst, pbuf);
-    utl_io_put8_tl_ap(src, pbuf);
-    utl_io_put8_tl_ap(CMD_SET_CONFIG_RES_ID, pbuf);
-    utl_io_put16_tl_ap(CMD_SET_CONFIG_RES_SIZE, pbuf);
-    utl_io_put8_tl_ap(cmd->status, pbuf);
-    utl_io_put16_tl_ap(utl_crc16_data(buffer, (pbuf - buffer), 0xFFFF), pbuf);
-    *size = (pbuf - buffer);
-    return true;
+    return cmd_encode_packed(dst, src, seq, CMD_OTA_RES_ID, cmd, CMD_OTA_RES_SIZE, buffer, size);
 }
 
-bool cmd_encode_action_res(uint8_t dst, uint8_t src, cmd_action_res_t* cmd, uint8_t* buffer, size_t* size)
+bool cmd_encode_ota_status_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_ota_status_res_t* cmd, uint8_t* buffer,
+                               size_t* size)
 {
-    uint8_t* pbuf = buffer;
-    write_sof(&pbuf); // <--- AQUI
-    utl_io_put8_tl_ap(dst, pbuf);
-    utl_io_put8_tl_ap(src, pbuf);
-    utl_io_put8_tl_ap(CMD_ACTION_RES_ID, pbuf);
-    utl_io_put16_tl_ap(CMD_ACTION_RES_SIZE, pbuf);
-    utl_io_put8_tl_ap(cmd->cmd_req_id, pbuf);
-    utl_io_put8_tl_ap(cmd->status, pbuf);
-    utl_io_put16_tl_ap(utl_crc16_data(buffer, (pbuf - buffer), 0xFFFF), pbuf);
-    *size = (pbuf - buffer);
-    return true;
+    return cmd_encode_packed(dst, src, seq, CMD_OTA_STATUS_RES_ID, cmd, CMD_OTA_STATUS_RES_SIZE, buffer, size);
 }
 
-bool cmd_encode_ota_res(uint8_t dst, uint8_t src, cmd_action_res_t* cmd, uint8_t* buffer, size_t* size)
+bool cmd_encode_link_config_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_link_config_req_t* cmd, uint8_t* buffer,
+                                size_t* size)
 {
-    uint8_t* pbuf = buffer;
-    write_sof(&pbuf); // <--- AQUI
-    utl_io_put8_tl_ap(dst, pbuf);
-    utl_io_put8_tl_ap(src, pbuf);
-    utl_io_put8_tl_ap(CMD_OTA_RES_ID, pbuf);
-    utl_io_put16_tl_ap(CMD_OTA_RES_SIZE, pbuf);
-    utl_io_put8_tl_ap(cmd->cmd_req_id, pbuf);
-    utl_io_put8_tl_ap(cmd->status, pbuf);
-    utl_io_put16_tl_ap(utl_crc16_data(buffer, (pbuf - buffer), 0xFFFF), pbuf);
-    *size = (pbuf - buffer);
+    return cmd_encode_packed(dst, src, seq, CMD_LINK_CONFIG_REQ_ID, cmd, CMD_LINK_CONFIG_REQ_SIZE, buffer, size);
+}
+
+bool cmd_encode_link_config_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_link_config_res_t* cmd, uint8_t* buffer,
+                                size_t* size)
+{
+    return cmd_encode_packed(dst, src, seq, CMD_LINK_CONFIG_RES_ID, cmd, CMD_LINK_CONFIG_RES_SIZE, buffer, size);
+}
+bool cmd_encode_latency_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_latency_req_t* cmd, uint8_t* buffer,
+                            size_t* size)
+{
+    return cmd_encode_packed(dst, src, seq, CMD_LATENCY_REQ_ID, cmd, CMD_LATENCY_REQ_SIZE, buffer, size);
+}
+bool cmd_encode_latency_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_latency_res_t* cmd, uint8_t* buffer,
+                            size_t* size)
+{
+    return cmd_encode_packed(dst, src, seq, CMD_LATENCY_RES_ID, cmd, CMD_LATENCY_RES_SIZE, buffer, size);
+}
+bool cmd_encode_tlm_sub_req(uint8_t dst, uint8_t src, uint8_t seq, cmd_tlm_sub_req_t* cmd, uint8_t* buffer,
+                            size_t* size)
+{
+    return cmd_encode_packed(dst, src, seq, CMD_TLM_SUB_REQ_ID, cmd, CMD_TLM_SUB_REQ_SIZE, buffer, size);
+}
+bool cmd_encode_tlm_sub_res(uint8_t dst, uint8_t src, uint8_t seq, cmd_tlm_sub_res_t* cmd, uint8_t* buffer,
+                            size_t* size)
+{
+    return cmd_encode_packed(dst, src, seq, CMD_TLM_SUB_RES_ID, cmd, CMD_TLM_SUB_RES_SIZE, buffer, size);
+}
+bool cmd_encode_tlm_data(uint8_t dst, uint8_t src, uint8_t seq, cmd_tlm_data_t* cmd, uint8_t* buffer, size_t* size)
+{
+    if(cmd->records_len > CMD_TLM_RECORDS_MAX)
+        return false;
+    // Header (7 bytes) + registros são contíguos na struct; records_len fica de fora
+    return cmd_encode_packed(dst, src, seq, CMD_TLM_DATA_ID, cmd, CMD_TLM_DATA_HDR_SIZE + cmd->records_len, buffer,
+                             size);
+}
+
+// [HELPER] Payload de tamanho fixo direto para a struct packed
+static bool cmd_decode_packed(void* payload, size_t payload_size, const uint8_t* buffer, size_t size)
+{
+    if(size != payload_size)
+        return false;
+    utl_io_get_packed_fl(payload, buffer, payload_size);
     return true;
 }
 
@@ -322,57 +491,225 @@ bool cmd_decode_action_bolus_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
 
 bool cmd_decode_config_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
 {
-    uint8_t* pbuf = buffer;
-    if(size != CMD_SET_CONFIG_REQ_SIZE)
-        return false;
-    cmd->config_req.config.volume = utl_io_get32_fl_ap(pbuf);
-    cmd->config_req.config.flow_rate = utl_io_get32_fl_ap(pbuf);
-    cmd->config_req.config.diameter = utl_io_get8_fl_ap(pbuf);
-    cmd->config_req.config.mode = utl_io_get8_fl_ap(pbuf);
-    return true;
+    return cmd_decode_packed(&cmd->config_req, CMD_SET_CONFIG_REQ_SIZE, buffer, size);
 }
 
 // ... (Mantenha os decoders de resposta: version_res, status_res, etc. iguais ao seu original)
 bool cmd_decode_version_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
 {
-    uint8_t* pbuf = buffer;
-    if(size != CMD_VERSION_RES_SIZE)
-        return false;
-    cmd->version_res.major = utl_io_get8_fl_ap(pbuf);
-    cmd->version_res.minor = utl_io_get8_fl_ap(pbuf);
-    cmd->version_res.patch = utl_io_get8_fl_ap(pbuf);
-    return true;
+    return cmd_decode_packed(&cmd->version_res, CMD_VERSION_RES_SIZE, buffer, size);
 }
 bool cmd_decode_status_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
 {
-    uint8_t* pbuf = buffer;
-    if(size != CMD_GET_STATUS_RES_SIZE)
-        return false;
-    cmd->status_res.status_data.current_state = utl_io_get8_fl_ap(pbuf);
-    cmd->status_res.status_data.volume = utl_io_get32_fl_ap(pbuf);
-    cmd->status_res.status_data.flow_rate_set = utl_io_get32_fl_ap(pbuf);
-    cmd->status_res.status_data.pressure = utl_io_get32_fl_ap(pbuf);
-    cmd->status_res.status_data.alarm_active = utl_io_get8_fl_ap(pbuf);
-    return true;
+    return cmd_decode_packed(&cmd->status_res, CMD_GET_STATUS_RES_SIZE, buffer, size);
 }
 bool cmd_decode_config_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
 {
-    uint8_t* pbuf = buffer;
-    if(size != CMD_SET_CONFIG_RES_SIZE)
-        return false;
-    cmd->config_res.status = (cmd_status_t) utl_io_get8_fl_ap(pbuf);
-    return true;
+    return cmd_decode_packed(&cmd->config_res, CMD_SET_CONFIG_RES_SIZE, buffer, size);
 }
 bool cmd_decode_action_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
 {
-    uint8_t* pbuf = buffer;
-    if(size != CMD_ACTION_RES_SIZE)
+    return cmd_decode_packed(&cmd->action_res, CMD_ACTION_RES_SIZE, buffer, size);
+}
+bool cmd_decode_ota_start_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    cmd->ota_start_req.chunk_size = 0;
+    cmd->ota_start_req.image_size = 0;
+    cmd->ota_start_req.flags = 0;
+    if(size == CMD_OTA_START_REQ_MIN_SIZE)
+        return cmd_decode_packed(&cmd->ota_start_req, CMD_OTA_START_REQ_MIN_SIZE, buffer, size);
+    // Campos em zero vão sempre na forma mais curta (igual ao encoder)
+    if(size == CMD_OTA_START_REQ_CHUNK_SIZE)
+        return cmd_decode_packed(&cmd->ota_start_req, CMD_OTA_START_REQ_CHUNK_SIZE, buffer, size) &&
+               cmd->ota_start_req.chunk_size != 0;
+    if(size == CMD_OTA_START_REQ_IMAGE_SIZE)
+    {
+        cmd->ota_start_req.flags = CMD_OTA_FLAG_LZ;
+        return cmd_decode_packed(&cmd->ota_start_req, CMD_OTA_START_REQ_IMAGE_SIZE, buffer, size) &&
+               cmd->ota_start_req.image_size != 0;
+    }
+    return cmd_decode_packed(&cmd->ota_start_req, CMD_OTA_START_REQ_SIZE, buffer, size) &&
+           cmd->ota_start_req.image_size != 0 && cmd->ota_start_req.flags != 0 &&
+           cmd->ota_start_req.flags != CMD_OTA_FLAG_LZ;
+}
+bool cmd_decode_ota_chunk_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    if(size < CMD_OTA_CHUNK_HDR_SIZE)
+        return false;
+    const uint8_t* pbuf = utl_io_get_packed_fl(&cmd->ota_chunk_req, buffer, CMD_OTA_CHUNK_HDR_SIZE);
+    if(cmd->ota_chunk_req.len > sizeof(cmd->ota_chunk_req.data) ||
+       (size_t) CMD_OTA_CHUNK_HDR_SIZE + cmd->ota_chunk_req.len != size)
         return false;
-    cmd->action_res.cmd_req_id = (cmd_ids_t) utl_io_get8_fl_ap(pbuf);
-    cmd->action_res.status = (cmd_status_t) utl_io_get8_fl_ap(pbuf);
+    memcpy(cmd->ota_chunk_req.data, pbuf, cmd->ota_chunk_req.len);
     return true;
 }
-bool cmd_decode_ota_generic(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+bool cmd_decode_ota_end_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    if(size == 0)
+    {
+        memset(&cmd->ota_end_req, 0, sizeof(cmd->ota_end_req));
+        return true;
+    }
+    // Digest zerado vai sempre como END sem payload (igual ao encoder)
+    return cmd_decode_packed(&cmd->ota_end_req, CMD_OTA_END_REQ_SIZE, buffer, size) &&
+           !cmd_ota_end_no_digest(&cmd->ota_end_req);
+}
+bool cmd_decode_ota_status_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    return size == CMD_OTA_STATUS_REQ_SIZE;
+}
+bool cmd_decode_ota_status_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    return cmd_decode_packed(&cmd->ota_status_res, CMD_OTA_STATUS_RES_SIZE, buffer, size);
+}
+bool cmd_decode_link_config_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    return cmd_decode_packed(&cmd->link_config_req, CMD_LINK_CONFIG_REQ_SIZE, buffer, size);
+}
+bool cmd_decode_link_config_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    return cmd_decode_packed(&cmd->link_config_res, CMD_LINK_CONFIG_RES_SIZE, buffer, size);
+}
+bool cmd_decode_latency_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    return cmd_decode_packed(&cmd->latency_req, CMD_LATENCY_REQ_SIZE, buffer, size);
+}
+bool cmd_decode_latency_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
 {
+    return cmd_decode_packed(&cmd->latency_res, CMD_LATENCY_RES_SIZE, buffer, size);
+}
+bool cmd_decode_tlm_sub_req(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    return cmd_decode_packed(&cmd->tlm_sub_req, CMD_TLM_SUB_REQ_SIZE, buffer, size);
+}
+bool cmd_decode_tlm_sub_res(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    return cmd_decode_packed(&cmd->tlm_sub_res, CMD_TLM_SUB_RES_SIZE, buffer, size);
+}
+bool cmd_decode_tlm_data(cmd_cmds_t* cmd, uint8_t* buffer, size_t size)
+{
+    if(size < CMD_TLM_DATA_HDR_SIZE)
+        return false;
+    const uint8_t* pbuf = utl_io_get_packed_fl(&cmd->tlm_data, buffer, CMD_TLM_DATA_HDR_SIZE);
+
+    // DELTA tem tamanho variável: os registros são validados por quem decodifica
+    size_t records_len = size - CMD_TLM_DATA_HDR_SIZE;
+    if(cmd->tlm_data.format == CMD_TLM_FMT_RAW &&
+       records_len != cmd->tlm_data.count * cmd_tlm_record_size(cmd->tlm_data.channels))
+        return false;
+    if(cmd->tlm_data.format > CMD_TLM_FMT_DELTA)
+        return false;
+    memcpy(cmd->tlm_data.records, pbuf, records_len);
+    cmd->tlm_data.records_len = (uint8_t) records_len;
     return true;
 }
+
+// --- REGISTROS DE TELEMETRIA ---
+size_t cmd_tlm_record_size(uint8_t channels)
+{
+    size_t size = sizeof(uint32_t); // timestamp
+    if(channels & CMD_TLM_CH_BUBBLE)
+        size += sizeof(uint16_t);
+    if(channels & CMD_TLM_CH_OCCLUSION)
+        size += sizeof(uint16_t);
+    if(channels & CMD_TLM_CH_VOLUME_POT)
+        size += sizeof(uint16_t);
+    if(channels & CMD_TLM_CH_STATE)
+        size += sizeof(uint8_t);
+    if(channels & CMD_TLM_CH_INFUSED)
+        size += sizeof(uint32_t);
+    if(channels & CMD_TLM_CH_PRESSURE)
+        size += sizeof(uint16_t);
+    return size;
+}
+
+size_t cmd_tlm_put_record(uint8_t channels, const cmd_tlm_record_t* rec, uint8_t* buffer)
+{
+    uint8_t* pbuf = buffer;
+    utl_io_put32_tl_ap(rec->timestamp, pbuf);
+    if(channels & CMD_TLM_CH_BUBBLE)
+        utl_io_put16_tl_ap(rec->bubble_mv, pbuf);
+    if(channels & CMD_TLM_CH_OCCLUSION)
+        utl_io_put16_tl_ap(rec->occlusion_mv, pbuf);
+    if(channels & CMD_TLM_CH_VOLUME_POT)
+        utl_io_put16_tl_ap(rec->volume_pot_mv, pbuf);
+    if(channels & CMD_TLM_CH_STATE)
+        utl_io_put8_tl_ap(rec->state, pbuf);
+    if(channels & CMD_TLM_CH_INFUSED)
+        utl_io_put32_tl_ap(rec->infused, pbuf);
+    if(channels & CMD_TLM_CH_PRESSURE)
+        utl_io_put16_tl_ap(rec->pressure, pbuf);
+    return (size_t) (pbuf - buffer);
+}
+
+size_t cmd_tlm_get_record(uint8_t channels, cmd_tlm_record_t* rec, uint8_t* buffer)
+{
+    uint8_t* pbuf = buffer;
+    memset(rec, 0, sizeof(*rec));
+    rec->timestamp = utl_io_get32_fl_ap(pbuf);
+    if(channels & CMD_TLM_CH_BUBBLE)
+        rec->bubble_mv = utl_io_get16_fl_ap(pbuf);
+    if(channels & CMD_TLM_CH_OCCLUSION)
+        rec->occlusion_mv = utl_io_get16_fl_ap(pbuf);
+    if(channels & CMD_TLM_CH_VOLUME_POT)
+        rec->volume_pot_mv = utl_io_get16_fl_ap(pbuf);
+    if(channels & CMD_TLM_CH_STATE)
+        rec->state = utl_io_get8_fl_ap(pbuf);
+    if(channels & CMD_TLM_CH_INFUSED)
+        rec->infused = utl_io_get32_fl_ap(pbuf);
+    if(channels & CMD_TLM_CH_PRESSURE)
+        rec->pressure = utl_io_get16_fl_ap(pbuf);
+    return (size_t) (pbuf - buffer);
+}
+
+// Delta de um registro para o anterior: varint zigzag por campo presente
+static size_t tlm_put_delta(uint8_t channels, const cmd_tlm_record_t* prev, const cmd_tlm_record_t* rec,
+                            uint8_t* buffer)
+{
+    uint8_t* pbuf = buffer;
+    utl_varint_put_ap(utl_varint_zigzag((int32_t) (rec->timestamp - prev->timestamp)), pbuf);
+    if(channels & CMD_TLM_CH_BUBBLE)
+        utl_varint_put_ap(utl_varint_zigzag(rec->bubble_mv - prev->bubble_mv), pbuf);
+    if(channels & CMD_TLM_CH_OCCLUSION)
+        utl_varint_put_ap(utl_varint_zigzag(rec->occlusion_mv - prev->occlusion_mv), pbuf);
+    if(channels & CMD_TLM_CH_VOLUME_POT)
+        utl_varint_put_ap(utl_varint_zigzag(rec->volume_pot_mv - prev->volume_pot_mv), pbuf);
+    if(channels & CMD_TLM_CH_STATE)
+        utl_varint_put_ap(utl_varint_zigzag(rec->state - prev->state), pbuf);
+    if(channels & CMD_TLM_CH_INFUSED)
+        utl_varint_put_ap(utl_varint_zigzag((int32_t) (rec->infused - prev->infused)), pbuf);
+    if(channels & CMD_TLM_CH_PRESSURE)
+        utl_varint_put_ap(utl_varint_zigzag(rec->pressure - prev->pressure), pbuf);
+    return (size_t) (pbuf - buffer);
+}
+
+size_t cmd_tlm_pack(cmd_tlm_data_t* data, const cmd_tlm_record_t* recs, size_t n, size_t max_len)
+{
+    // Pior caso de um registro: 7 campos de varint de 32 bits
+    uint8_t tmp[7 * UTL_VARINT_MAX_SIZE];
+    size_t used = 0;
+    size_t count = 0;
+
+    if(max_len > CMD_TLM_RECORDS_MAX)
+        max_len = CMD_TLM_RECORDS_MAX;
+
+    while(count < n && count < UINT8_MAX)
+    {
+        size_t len;
+        if(data->format == CMD_TLM_FMT_DELTA && count > 0)
+            len = tlm_put_delta(data->channels, &recs[count - 1], &recs[count], tmp);
+        else
+            len = cmd_tlm_put_record(data->channels, &recs[count], tmp);
+
+        if(used + len > max_len)
+            break;
+
+        memcpy(&data->records[used], tmp, len);
+        used += len;
+        count++;
+    }
+
+    data->count = (uint8_t) count;
+    data->records_len = (uint8_t) used;
+    return count;
+}
@@ -0,0 +1,132 @@
+#include <string.h>
+#include "frame_scanner.h"
+#include "utl_io.h"
+
+// Palavras com todos os bytes iguais a 0x01 / 0x80 / SOF1, no tamanho nativo (4 no M4, 8 no host)
+#define SCAN_ONES    ((size_t)-1 / 0xFF)
+#define SCAN_HIGHS   (SCAN_ONES * 0x80)
+#define SCAN_PATTERN (SCAN_ONES * CMD_SOF_1_BYTE)
+
+// Algum byte da palavra é zero? (truque clássico de SWAR, sem falso negativo)
+#define SCAN_HAS_ZERO(w) (((w) - SCAN_ONES) & ~(w) & SCAN_HIGHS)
+
+// Procura o próximo SOF1 a partir de 'pos'. Retorna 'len' se não houver.
+static size_t find_sof1(const uint8_t* data, size_t pos, size_t len)
+{
+    // Palavra a palavra: o padding de zeros custa uma comparação a cada 4/8 bytes.
+    // memcpy vira um load simples (M4 aceita acesso desalinhado).
+    while(pos + sizeof(size_t) <= len)
+    {
+        size_t word;
+        memcpy(&word, &data[pos], sizeof(word));
+        if(SCAN_HAS_ZERO(word ^ SCAN_PATTERN))
+            break;
+        pos += sizeof(size_t);
+    }
+
+    // Localiza o byte exato dentro da palavra (ou termina a cauda do bloco)
+    while(pos < len && data[pos] != CMD_SOF_1_BYTE)
+        pos++;
+
+    return pos;
+}
+
+static void start_frame(frame_scanner_t* scanner)
+{
+    // SOF fica no buffer: o CRC cobre o frame inteiro
+    scanner->buffer[0] = CMD_SOF_1_BYTE;
+    scanner->buffer[1] = CMD_SOF_2_BYTE;
+    scanner->index = 2;
+    scanner->expected = 0;
+}
+
+void frame_scanner_init(frame_scanner_t* scanner, frame_scanner_cb_t on_frame, void* ctx)
+{
+    scanner->on_frame = on_frame;
+    scanner->ctx = ctx;
+    frame_scanner_reset(scanner);
+}
+
+void frame_scanner_reset(frame_scanner_t* scanner)
+{
+    scanner->index = 0;
+    scanner->expected = 0;
+    scanner->sof1_pending = false;
+}
+
+size_t frame_scanner_feed(frame_scanner_t* scanner, const uint8_t* data, size_t len)
+{
+    size_t pos = 0;
+    size_t frames = 0;
+
+    while(pos < len)
+    {
+        // --- CAÇANDO SOF ---
+        if(scanner->index == 0)
+        {
+            // SOF cortado entre dois blocos (AA | 55)
+            if(scanner->sof1_pending)
+            {
+                scanner->sof1_pending = false;
+                if(data[pos] == CMD_SOF_2_BYTE)
+                {
+                    start_frame(scanner);
+                    pos++;
+                    continue;
+                }
+            }
+
+            pos = find_sof1(data, pos, len);
+            if(pos >= len)
+                break;
+
+            if(pos + 1 >= len)
+            {
+                scanner->sof1_pending = true;
+                break;
+            }
+
+            // AA seguido de outra coisa: o AA era lixo (AA AA 55 cai no próximo find)
+            if(data[pos + 1] != CMD_SOF_2_BYTE)
+            {
+                pos++;
+                continue;
+            }
+
+            start_frame(scanner);
+            pos += 2;
+            continue;
+        }
+
+        // --- MONTAGEM: header e depois payload+CRC, um span por vez ---
+        size_t target = scanner->expected ? scanner->expected : CMD_HDR_SIZE;
+        size_t n = target - scanner->index;
+        if(n > len - pos)
+            n = len - pos;
+
+        memcpy(&scanner->buffer[scanner->index], &data[pos], n);
+        scanner->index += n;
+        pos += n;
+
+        if(scanner->index < target)
+            break; // Resto chega no próximo bloco
+
+        if(scanner->expected == 0)
+        {
+            uint16_t size = utl_io_get16_fl(&scanner->buffer[CMD_HDR_SIZE_OFFSET]);
+            if(size > CMD_MAX_DATA_SIZE)
+            {
+                frame_scanner_reset(scanner); // Tamanho inválido: volta a caçar
+                continue;
+            }
+            scanner->expected = CMD_HDR_SIZE + size + CMD_TRAILER_SIZE;
+            continue;
+        }
+
+        scanner->on_frame(scanner->buffer, scanner->index, scanner->ctx);
+        frames++;
+        frame_scanner_reset(scanner);
+    }
+
+    return frames;
+}
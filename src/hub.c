@@ -1,379 +1,977 @@
-#include <zephyr/drivers/spi.h>
-#include <zephyr/drivers/gpio.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/app_version.h>
-#include <zephyr/sys/reboot.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/sys/ring_buffer.h>
+#include <zephyr/sys/barrier.h>
 #include <string.h>
-#include <soc.h>
-#include <stm32_ll_spi.h>
+#include <errno.h>
 #include "hub.h"
+#include "hub_transport.h"
 #include "cmd.h"
 #include "ota_handler.h"
 #include "utl_io.h"
 #include "sensor_data.h"
+#include "frame_scanner.h"
+#include "logic_engine.h"
 
 LOG_MODULE_REGISTER(hub, LOG_LEVEL_INF);
 
 K_THREAD_DEFINE(hub_thread_data, HUB_THREAD_STACK_SIZE, hub_thread_entry, NULL, NULL, NULL, HUB_THREAD_PRIORITY, 0, 0);
 
-static const struct device* spi_dev = DEVICE_DT_GET(DT_NODELABEL(spi1));
-static const struct gpio_dt_spec ready_pin = GPIO_DT_SPEC_GET(DT_ALIAS(spi_ready), gpios);
+// --- FILA DE RESPOSTAS ---
+// Frames de resposta já codificados, um atrás do outro. Ao devolver um slot, o Hub
+// empacota nele quantos frames inteiros couberem; o resto espera a próxima transação.
+RING_BUF_DECLARE(hub_res_fifo, HUB_RES_FIFO_SIZE);
+
+// Respostas de um slot que o mestre não leu (HUB_EXCHANGE_TX_LOST): saem antes da fila,
+// na ordem em que já estavam. Só a thread do Hub mexe.
+static uint8_t hub_res_carry[CMD_LINK_MAX_BODY];
+static size_t hub_res_carry_len;
+
+// LED de atividade: aceso no boot, troca a cada comando entregue à Logic Engine
+static const struct gpio_dt_spec hub_led = GPIO_DT_SPEC_GET(DT_ALIAS(led0), gpios);
+static bool hub_led_ready;
+
+// ACKs para o mestre pré-codificados (prefixo + CRC parcial), montados no hub_init
+static cmd_tmpl_t ack_tmpl_action;
+static cmd_tmpl_t ack_tmpl_ota;
+
+// --- PIPELINE DE SLOTS (PING-PONG / N SLOTS) ---
+// A thread de link mantém sempre um slot no transporte (no SPI, armado no DMA). Ao terminar uma troca,
+// ela entrega o slot para a thread do Hub e arma imediatamente o próximo slot livre.
+// Assim o parse e a resposta do slot N acontecem enquanto a transação N+1 ocorre.
+// Consequência: no SPI, a resposta a um pedido sai HUB_SLOTS transações depois dele.
+//
+// Cada slot carrega o modo de link com que será armado. O Hub decide o modo ao
+// devolver o slot, então a troca FIXED <-> VARIABLE acontece exatamente depois
+// do slot que leva a resposta do CMD_LINK_CONFIG_REQ_ID (ver hub_transport.h).
+static hub_slot_t hub_slots[HUB_SLOTS];
+
+K_MSGQ_DEFINE(slot_free_q, sizeof(uint8_t), HUB_SLOTS, 1); // Slots prontos para o transporte (Hub -> Link)
+K_MSGQ_DEFINE(slot_done_q, sizeof(uint8_t), HUB_SLOTS, 1); // Slots recebidos (Link -> Hub)
+static K_SEM_DEFINE(link_start, 0, 1);
+
+// --- ATENÇÃO (ATTN) ---
+// Alto enquanto houver algo para o mestre ler: slot com frames na fila/armado, respostas
+// na hub_res_fifo ou telemetria na fila/lote. Recalculado (sob attn_lock) depois de toda
+// mudança desse estado, por qualquer thread: a última chamada sempre deixa o pino certo.
+static atomic_t tx_pending_slots = ATOMIC_INIT(0);
+static struct k_spinlock attn_lock;
+static bool attn_active;
+
+static void hub_link_thread_entry(void* p1, void* p2, void* p3);
+K_THREAD_DEFINE(hub_link_thread_data, HUB_LINK_THREAD_STACK_SIZE, hub_link_thread_entry, NULL, NULL, NULL,
+                HUB_LINK_THREAD_PRIORITY, 0, 0);
+
+// --- PARSER (SCANNER EM BLOCOS) ---
+static frame_scanner_t hub_scanner;
+static uint32_t hub_rx_cycles; // Carimbo do slot sendo parseado (vai para pump_cmd_t.t_rx)
+static void hub_on_frame(uint8_t* frame, size_t len, void* ctx);
+
+// --- MODO DE LINK ---
+static uint8_t link_mode = CMD_LINK_MODE_FIXED;         // Modo dos próximos slots devolvidos
+static int16_t link_mode_pending = -1;                  // Troca aceita, aplicada após a resposta
+static atomic_t link_desync = ATOMIC_INIT(0);           // Link viu header inválido: volta ao FIXED
+
+// --- PUBLICAÇÃO DO STATUS (LATCH SEQLOCK, SEM LOCK) ---
+// Escritor único (Logic Engine); leitores (hub) nunca bloqueiam nem esperam o escritor.
+// Duas cópias: o escritor incrementa status_seq e atualiza a cópia que o leitor NÃO está
+// usando (status_buf[0] com seq ímpar, status_buf[1] com seq par). O leitor copia
+// status_buf[seq & 1] e só repete se seq mudou durante a cópia. Como o hub tem prioridade
+// maior que a Logic Engine, preemptar o escritor no meio da escrita não trava o leitor.
+// Geração = seq / 2: muda uma vez por publicação.
+static pump_status_t status_buf[2];
+static atomic_t status_seq = ATOMIC_INIT(0);
+static pump_status_t status_last; // Só o escritor usa: evita publicar status idêntico
+
+// Telemetria assinada (ver hub_telemetry_sample)
+RING_BUF_DECLARE(hub_tlm_fifo, HUB_TLM_FIFO_RECORDS * sizeof(cmd_tlm_record_t));
+static struct k_spinlock tlm_lock;
+static uint8_t tlm_channels; // 0 = sem assinatura
+static uint8_t tlm_decimation;
+static uint8_t tlm_format;
+static uint8_t tlm_decim_count;
+static uint16_t tlm_sample;           // Número da próxima amostra aceita
+static uint16_t tlm_fifo_first;       // Número da amostra mais antiga na fila
+static atomic_t tlm_dropped;          // Descartados desde o último frame enviado
+
+// Registros já retirados da fila, aguardando espaço numa transação (só a thread do hub usa)
+static cmd_tlm_record_t tlm_batch[HUB_TLM_BATCH_MAX];
+static size_t tlm_batch_len;
+static uint16_t tlm_batch_first;
+
+// Payload de status já convertido e a geração de onde veio
+static cmd_status_payload_t status_payload;
+static atomic_val_t status_payload_gen = -1;
+
+int hub_init(void)
+{
+    hub_led_ready = device_is_ready(hub_led.port) && gpio_pin_configure_dt(&hub_led, GPIO_OUTPUT_ACTIVE) == 0;
 
-K_MSGQ_DEFINE(hub_cmd_q, sizeof(pump_cmd_t), 10, 4);
+    if(hub_transport.init() != 0)
+        return -1;
 
-// --- DEFINIÇÕES DE FRAMING (SOF) ---
-#define SOF_BYTE_1 0xAA
-#define SOF_BYTE_2 0x55
+    ring_buf_reset(&hub_res_fifo);
+    cmd_tmpl_init(&ack_tmpl_action, ADDR_MASTER, ADDR_SLAVE, CMD_ACTION_RES_ID, CMD_ACTION_RES_SIZE);
+    cmd_tmpl_init(&ack_tmpl_ota, ADDR_MASTER, ADDR_SLAVE, CMD_OTA_RES_ID, CMD_OTA_RES_SIZE);
+    memset(hub_slots, 0, sizeof(hub_slots));
+    frame_scanner_init(&hub_scanner, hub_on_frame, NULL);
+    ota_init(); // OTA interrompido por reset volta antes do primeiro OTA_STATUS
 
-#define SPI_PACKET_SIZE 64                     // Tamanho do chunk físico lido do SPI
-static uint8_t rx_raw_buffer[SPI_PACKET_SIZE]; // Buffer DMA
-static uint8_t tx_buffer[SPI_PACKET_SIZE];     // Buffer de resposta
+    // Todos os slots começam livres; a thread de link só arma depois daqui
+    for(uint8_t i = 0; i < HUB_SLOTS; i++)
+    {
+        k_msgq_put(&slot_free_q, &i, K_NO_WAIT);
+    }
+    k_sem_give(&link_start);
+    return 0;
+}
 
-// --- VARIÁVEIS DO PARSER (MÁQUINA DE ESTADOS) ---
-typedef enum
+void hub_set_status(const pump_status_t* status)
 {
-    STATE_WAIT_SOF1,
-    STATE_WAIT_SOF2,
-    STATE_READ_HEADER,
-    STATE_READ_PAYLOAD,
-    STATE_READ_CRC
-} parser_state_t;
+    // A Logic Engine chama a cada volta do loop: só publica se algo mudou
+    if(atomic_get(&status_seq) != 0 && memcmp(&status_last, status, sizeof(status_last)) == 0)
+        return;
+    status_last = *status;
+
+    atomic_inc(&status_seq); // Ímpar: leitores vão para status_buf[1]
+    barrier_dmem_fence_full();
+    status_buf[0] = *status;
+    barrier_dmem_fence_full();
+    atomic_inc(&status_seq); // Par: leitores vão para status_buf[0]
+    barrier_dmem_fence_full();
+    status_buf[1] = *status;
+}
 
-static parser_state_t p_state = STATE_WAIT_SOF1;
-static uint8_t p_buffer[CMD_MAX_DATA_SIZE + 16]; // Buffer de montagem
-static uint16_t p_index = 0;
-static uint16_t p_expected_len = 0;
+uint32_t hub_get_status(pump_status_t* out)
+{
+    atomic_val_t seq;
+    do
+    {
+        seq = atomic_get(&status_seq);
+        barrier_dmem_fence_full();
+        *out = status_buf[seq & 1];
+        barrier_dmem_fence_full();
+    } while(atomic_get(&status_seq) != seq);
 
-static int spi_consecutive_errors = 0;
+    return (uint32_t) seq >> 1;
+}
 
-static const struct spi_config spi_cfg = 
+static void fill_status_payload(cmd_status_payload_t* payload)
 {
-    // Modo 0: CPOL=0, CPHA=0
-    .operation = SPI_WORD_SET(8) | SPI_TRANSFER_MSB | SPI_OP_MODE_SLAVE,
-    .frequency = 1000000,
-    .slave = 0,
-};
+    // Status não mudou desde a última resposta: reaproveita o payload convertido
+    if((atomic_val_t) (atomic_get(&status_seq) >> 1) != status_payload_gen)
+    {
+        pump_status_t status;
+        uint32_t gen = hub_get_status(&status);
+
+        status_payload.current_state = (uint8_t) status.current_state;
+        status_payload.volume = (uint32_t) status.infused_volume;
+        status_payload.flow_rate_set = status.configured_flow_rate;
+        status_payload.pressure = status.pressure_mmhg;
+        status_payload.alarm_active = (status.current_state >= STATE_ALARM_BUBBLE);
+        status_payload_gen = (atomic_val_t) gen;
+    }
+    *payload = status_payload;
+}
 
-static pump_status_t status_cache;
+static void hub_update_attention(void)
+{
+    if(hub_transport.attention == NULL)
+        return;
 
-// --- RESET DE HARDWARE (Auto-Cura) ---
-static void reset_spi_peripheral(void)
+    k_spinlock_key_t key = k_spin_lock(&attn_lock);
+    bool active = atomic_get(&tx_pending_slots) > 0 || !ring_buf_is_empty(&hub_res_fifo) ||
+                  hub_res_carry_len > 0 || tlm_batch_len > 0 || !ring_buf_is_empty(&hub_tlm_fifo) ||
+                  ota_result_ready();
+    if(active != attn_active)
+    {
+        attn_active = active;
+        hub_transport.attention(active);
+    }
+    k_spin_unlock(&attn_lock, key);
+}
+
+void hub_wake(void)
 {
-    SPI_TypeDef* spi_regs = (SPI_TypeDef*) DT_REG_ADDR(DT_NODELABEL(spi1));
+    // SPI: avisa o mestre. Stream parado esperando RX: acorda para sair já.
+    hub_update_attention();
+    if(hub_transport.kick != NULL)
+        hub_transport.kick();
+}
 
-    // Sequência de Reset Seguro
-    spi_regs->CR1 &= ~SPI_CR1_SPE; // Desabilita
-    k_busy_wait(100);
+// --- TELEMETRIA ---
+// Produtor: Logic Engine (hub_telemetry_sample). Consumidor: hub_pack_telemetry.
+// A fila guarda registros decodificados (cmd_tlm_record_t) sempre contíguos: o mais
+// antigo é a amostra tlm_fifo_first. A serialização (RAW ou DELTA) só acontece na
+// hora de montar o frame, fora do spinlock.
+void hub_telemetry_sample(const sensor_packet_t* sensor, const pump_status_t* status)
+{
+    cmd_tlm_record_t rec = {
+        .timestamp = (uint32_t) sensor->timestamp,
+        .bubble_mv = (uint16_t) CLAMP(sensor->bolha_mv, 0, UINT16_MAX),
+        .occlusion_mv = (uint16_t) CLAMP(sensor->oclusao_mv, 0, UINT16_MAX),
+        .volume_pot_mv = (uint16_t) CLAMP(sensor->volume_pot_mv, 0, UINT16_MAX),
+        .state = (uint8_t) status->current_state,
+        .infused = (uint32_t) status->infused_volume,
+        .pressure = (uint16_t) MIN(status->pressure_mmhg, UINT16_MAX),
+    };
+
+    k_spinlock_key_t key = k_spin_lock(&tlm_lock);
+
+    if(tlm_channels == 0 || ++tlm_decim_count < tlm_decimation)
+    {
+        k_spin_unlock(&tlm_lock, key);
+        return;
+    }
+    tlm_decim_count = 0;
 
-    // Limpa Flags
-    volatile uint32_t temp;
-    temp = spi_regs->DR;
-    temp = spi_regs->SR;
-    (void) temp;
+    // Fila cheia: abre espaço descartando o registro mais antigo (dado novo vale mais)
+    if(ring_buf_space_get(&hub_tlm_fifo) < sizeof(rec))
+    {
+        ring_buf_get(&hub_tlm_fifo, NULL, sizeof(rec));
+        tlm_fifo_first++;
+        atomic_inc(&tlm_dropped);
+    }
+    if(ring_buf_is_empty(&hub_tlm_fifo))
+        tlm_fifo_first = tlm_sample;
+    ring_buf_put(&hub_tlm_fifo, (uint8_t*) &rec, sizeof(rec));
+    tlm_sample++;
 
-    spi_regs->CR1 |= SPI_CR1_SPE; // Habilita
-    LOG_WRN(">>> SPI HARDWARE RESET <<<");
+    k_spin_unlock(&tlm_lock, key);
+    hub_wake();
 }
 
-int hub_init(void)
+static void hub_tlm_subscribe(const cmd_tlm_sub_req_t* req, cmd_tlm_sub_res_t* res)
 {
-    if(!device_is_ready(spi_dev))
-        return -1;
+    res->status = CMD_OK;
+    if(req->channels > CMD_TLM_CH_ALL || req->format > CMD_TLM_FMT_DELTA ||
+       (req->channels != 0 && req->decimation == 0))
+    {
+        res->status = CMD_ERR_PARAM_RANGE;
+    }
+    else
+    {
+        k_spinlock_key_t key = k_spin_lock(&tlm_lock);
+        ring_buf_reset(&hub_tlm_fifo);
+        tlm_channels = req->channels;
+        tlm_decimation = req->decimation;
+        tlm_format = req->format;
+        tlm_decim_count = 0;
+        tlm_sample = 0;
+        tlm_fifo_first = 0;
+        k_spin_unlock(&tlm_lock, key);
+
+        atomic_clear(&tlm_dropped);
+        tlm_batch_len = 0;
+
+        LOG_INF("Telemetria: canais 0x%02X, decimacao %d, formato %s", tlm_channels, tlm_decimation,
+                tlm_format == CMD_TLM_FMT_DELTA ? "DELTA" : "RAW");
+    }
+    res->channels = tlm_channels;
+    res->decimation = tlm_decimation;
+    res->format = tlm_format;
+    res->record_size = tlm_channels ? (uint8_t) cmd_tlm_record_size(tlm_channels) : 0;
+}
+
+// Completa tlm_batch com a fila, desde que continue contíguo (o produtor pode ter
+// descartado registros; nesse caso o lote atual sai primeiro).
+static void hub_tlm_refill(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&tlm_lock);
 
-    memset(tx_buffer, 0, sizeof(tx_buffer));
-    memset(rx_raw_buffer, 0, sizeof(rx_raw_buffer));
-    memset(&status_cache, 0, sizeof(status_cache));
+    if(tlm_batch_len == 0)
+        tlm_batch_first = tlm_fifo_first;
 
-    if(device_is_ready(ready_pin.port))
+    if((uint16_t) (tlm_batch_first + tlm_batch_len) == tlm_fifo_first)
     {
-        gpio_pin_configure_dt(&ready_pin, GPIO_OUTPUT_INACTIVE);
+        size_t take = MIN(ring_buf_size_get(&hub_tlm_fifo) / sizeof(cmd_tlm_record_t),
+                          HUB_TLM_BATCH_MAX - tlm_batch_len);
+        ring_buf_get(&hub_tlm_fifo, (uint8_t*) &tlm_batch[tlm_batch_len], take * sizeof(cmd_tlm_record_t));
+        tlm_batch_len += take;
+        tlm_fifo_first += take;
     }
-    return 0;
+
+    k_spin_unlock(&tlm_lock, key);
 }
 
-static void fill_status_payload(cmd_status_payload_t* payload)
+// Completa o espaço livre do slot com frames de telemetria (seq = CMD_SEQ_NONE)
+static size_t hub_pack_telemetry(hub_slot_t* slot, size_t used, size_t capacity)
 {
-    payload->current_state = (uint8_t) status_cache.current_state;
-    payload->volume = (uint32_t) status_cache.infused_volume;
-    payload->flow_rate_set = status_cache.configured_flow_rate;
-    payload->pressure = status_cache.pressure_mmhg;
-    payload->alarm_active = (status_cache.current_state >= STATE_ALARM_BUBBLE);
+    static cmd_tlm_data_t tlm;
+    const size_t overhead = CMD_HDR_SIZE + CMD_TLM_DATA_HDR_SIZE + CMD_TRAILER_SIZE;
+
+    if(tlm_channels == 0)
+        return used;
+
+    while(capacity - used > overhead)
+    {
+        hub_tlm_refill();
+        if(tlm_batch_len == 0)
+            break;
+
+        tlm.channels = tlm_channels;
+        tlm.format = tlm_format;
+        size_t sent = cmd_tlm_pack(&tlm, tlm_batch, tlm_batch_len, capacity - used - overhead);
+        if(sent == 0)
+            break; // Nem o keyframe cabe no que sobrou
+
+        tlm.first_sample = tlm_batch_first;
+        tlm.dropped = (uint16_t) MIN(atomic_clear(&tlm_dropped), UINT16_MAX);
+
+        size_t len = 0;
+        if(!cmd_encode_tlm_data(ADDR_MASTER, ADDR_SLAVE, CMD_SEQ_NONE, &tlm, &slot->tx[used], &len))
+            break;
+        used += len;
+
+        // O que não coube fica no lote para a próxima transação
+        tlm_batch_len -= sent;
+        tlm_batch_first += sent;
+        memmove(tlm_batch, &tlm_batch[sent], tlm_batch_len * sizeof(cmd_tlm_record_t));
+    }
+    return used;
 }
 
-void hub_set_status(const pump_status_t* status)
+// Entrega direta à Logic Engine, sem relay pelo main: o comando já sai carimbado
+// com o fim da troca no transporte (t_rx) e o instante do decode (t_decoded).
+static void hub_post_command(pump_cmd_t* cmd)
 {
-    status_cache = *status;
+    cmd->t_rx = hub_rx_cycles;
+    cmd->t_decoded = k_cycle_get_32();
+    if(hub_led_ready)
+        gpio_pin_toggle_dt(&hub_led);
+    if(k_msgq_put(&cmd_queue, cmd, K_NO_WAIT) != 0)
+    {
+        LOG_WRN("Fila da Logic Engine cheia: comando %d descartado", cmd->id);
+    }
 }
-int hub_get_command(pump_cmd_t* cmd)
+
+// --- CACHE DE REPLAY (Retries idempotentes) ---
+// Guarda as últimas respostas por (src, seq, id, crc do pedido). Um retry do mesmo pedido
+// recebe a resposta original sem re-executar o comando (ex.: chunk OTA gravado duas vezes).
+typedef struct
 {
-    return k_msgq_get(&hub_cmd_q, cmd, K_NO_WAIT);
+    bool valid;
+    uint8_t src;
+    uint8_t seq;
+    uint8_t id;
+    uint16_t req_crc;
+    uint8_t len;
+    uint8_t frame[HUB_REPLAY_FRAME_MAX];
+} hub_replay_entry_t;
+
+static hub_replay_entry_t replay_cache[HUB_REPLAY_ENTRIES];
+static uint8_t replay_next = 0;
+
+static hub_replay_entry_t* replay_lookup(uint8_t src, uint8_t seq, uint8_t id, uint16_t req_crc)
+{
+    for(int i = 0; i < HUB_REPLAY_ENTRIES; i++)
+    {
+        hub_replay_entry_t* e = &replay_cache[i];
+        if(e->valid && e->src == src && e->seq == seq && e->id == id && e->req_crc == req_crc)
+            return e;
+    }
+    return NULL;
 }
 
-// --- PROCESSADOR DE PACOTE VÁLIDO ---
-static void process_valid_packet(uint8_t* buffer, size_t len)
+static void replay_store(uint8_t src, uint8_t seq, uint8_t id, uint16_t req_crc, const uint8_t* frame, size_t len)
 {
-    // Zera erros pois tivemos sucesso
-    if(spi_consecutive_errors > 0)
+    if(len > HUB_REPLAY_FRAME_MAX)
+        return;
+
+    hub_replay_entry_t* e = &replay_cache[replay_next];
+    replay_next = (replay_next + 1) % HUB_REPLAY_ENTRIES;
+
+    e->valid = true;
+    e->src = src;
+    e->seq = seq;
+    e->id = id;
+    e->req_crc = req_crc;
+    e->len = (uint8_t) len;
+    memcpy(e->frame, frame, len);
+}
+
+// Enfileira a resposta; ela sai na próxima troca com espaço livre
+static bool hub_queue_reply(const uint8_t* frame, size_t len)
+{
+    if(ring_buf_space_get(&hub_res_fifo) < len)
     {
-        LOG_INF("SPI Recuperado! Erros zerados.");
-        spi_consecutive_errors = 0;
+        LOG_WRN("Fila de respostas cheia. Resposta 0x%02X descartada.", frame[CMD_HDR_ID_OFFSET]);
+        return false;
     }
+    ring_buf_put(&hub_res_fifo, frame, len);
+    return true;
+}
 
-    uint8_t src, dst;
-    cmd_ids_t req_id, res_id;
-    cmd_cmds_t req_data, res_data;
-    size_t tx_len = 0;
+// --- HANDLERS DE COMANDO ---
+// Um por linha de CMD_TABLE (coluna hub). Recebem a visão do pedido, que aponta para o
+// frame no buffer do scanner: só copia para cmd_cmds_t quem precisa da struct (comandos de
+// controle); o OTA lê o payload no lugar. Preenchem 'res' e devolvem o ID da resposta,
+// CMD_INVALID_ID (payload inválido) ou HUB_NO_REPLY (atendido, mas sem resposta).
+typedef cmd_ids_t (*hub_handler_t)(const cmd_view_t* req, cmd_cmds_t* res);
 
-    memset(&res_data, 0, sizeof(res_data));
+#define HUB_NO_REPLY ((cmd_ids_t) (CMD_INVALID_ID - 1))
 
-    // O 'buffer' aqui começa no byte 0 (que agora é SOF1 0xAA) graças à lógica do parser.
-    bool decode_success = cmd_decode(buffer, len, &src, &dst, &req_id, &req_data);
+static cmd_ids_t hub_cmd_get_status(const cmd_view_t* req, cmd_cmds_t* res)
+{
+    fill_status_payload(&res->status_res.status_data);
+    return CMD_GET_STATUS_RES_ID;
+}
+
+static cmd_ids_t hub_cmd_version(const cmd_view_t* req, cmd_cmds_t* res)
+{
+    res->version_res.major = APP_VERSION_MAJOR;
+    res->version_res.minor = APP_VERSION_MINOR;
+    res->version_res.patch = APP_PATCHLEVEL;
+    return CMD_VERSION_RES_ID;
+}
+
+static cmd_ids_t hub_cmd_set_config(const cmd_view_t* req, cmd_cmds_t* res)
+{
+    pump_cmd_t internal_cmd = {.id = CMD_NONE, .param = 0.0f};
+    cmd_cmds_t req_data;
+    if(!cmd_view_decode(req, &req_data))
+        return CMD_INVALID_ID;
+
+    internal_cmd.id = CMD_SET_RATE;
+    internal_cmd.param = (float) req_data.config_req.config.flow_rate;
+    hub_post_command(&internal_cmd);
+    internal_cmd.id = CMD_SET_VOLUME;
+    internal_cmd.param = (float) req_data.config_req.config.volume;
+    hub_post_command(&internal_cmd);
+    internal_cmd.id = CMD_SET_DIAMETER;
+    internal_cmd.param = (float) req_data.config_req.config.diameter;
+    hub_post_command(&internal_cmd);
+    internal_cmd.id = CMD_SET_MODE;
+    internal_cmd.param = (float) req_data.config_req.config.mode;
+    hub_post_command(&internal_cmd);
+
+    res->config_res.status = CMD_OK;
+    return CMD_SET_CONFIG_RES_ID;
+}
+
+static cmd_ids_t hub_cmd_link_config(const cmd_view_t* req, cmd_cmds_t* res)
+{
+    cmd_cmds_t req_data;
+    if(!cmd_view_decode(req, &req_data))
+        return CMD_INVALID_ID;
 
-    if(!decode_success)
+    res->link_config_res.max_body = CMD_LINK_MAX_BODY;
+    if(req_data.link_config_req.mode <= CMD_LINK_MODE_VARIABLE)
     {
-        LOG_WRN("Erro logico no cmd_decode (Estrutura invalida)");
-        return;
+        link_mode_pending = req_data.link_config_req.mode;
+        res->link_config_res.status = CMD_OK;
+        res->link_config_res.mode = req_data.link_config_req.mode;
+    }
+    else
+    {
+        res->link_config_res.status = CMD_ERR_PARAM_RANGE;
+        res->link_config_res.mode = link_mode;
+    }
+    return CMD_LINK_CONFIG_RES_ID;
+}
+
+static cmd_ids_t hub_cmd_tlm_sub(const cmd_view_t* req, cmd_cmds_t* res)
+{
+    cmd_cmds_t req_data;
+    if(!cmd_view_decode(req, &req_data))
+        return CMD_INVALID_ID;
+
+    hub_tlm_subscribe(&req_data.tlm_sub_req, &res->tlm_sub_res);
+    return CMD_TLM_SUB_RES_ID;
+}
+
+static cmd_ids_t hub_cmd_latency(const cmd_view_t* req, cmd_cmds_t* res)
+{
+    pump_latency_t lat;
+    cmd_cmds_t req_data;
+    if(!cmd_view_decode(req, &req_data))
+        return CMD_INVALID_ID;
+
+    res->latency_res.cmd = req_data.latency_req.cmd;
+    if(logic_get_latency((command_id_t) req_data.latency_req.cmd, &lat, req_data.latency_req.reset != 0))
+    {
+        res->latency_res.count = lat.count;
+        res->latency_res.min_us = lat.min_us;
+        res->latency_res.avg_us = lat.avg_us;
+        res->latency_res.max_us = lat.max_us;
+        res->latency_res.decode_avg_us = lat.decode_avg_us;
+        res->latency_res.queue_avg_us = lat.queue_avg_us;
+        res->latency_res.fsm_avg_us = lat.fsm_avg_us;
     }
+    return CMD_LATENCY_RES_ID;
+}
 
+// Ações sem payload: mapeamento direto para o comando da Logic Engine
+static cmd_ids_t hub_cmd_action(const cmd_view_t* req, cmd_cmds_t* res)
+{
     pump_cmd_t internal_cmd = {.id = CMD_NONE, .param = 0.0f};
 
-    switch(req_id)
+    switch(req->id)
     {
-    case CMD_GET_STATUS_REQ_ID:
-        res_id = CMD_GET_STATUS_RES_ID;
-        fill_status_payload(&res_data.status_res.status_data);
+    case CMD_ACTION_RUN_REQ_ID:
+        internal_cmd.id = CMD_START;
         break;
-
-    case CMD_VERSION_REQ_ID:
-        res_id = CMD_VERSION_RES_ID;
-        res_data.version_res.major = APP_VERSION_MAJOR;
-        res_data.version_res.minor = APP_VERSION_MINOR;
-        res_data.version_res.patch = APP_PATCHLEVEL;
+    case CMD_ACTION_PAUSE_REQ_ID:
+        internal_cmd.id = CMD_PAUSE;
         break;
-
-    case CMD_SET_CONFIG_REQ_ID:
-        internal_cmd.id = CMD_SET_RATE;
-        internal_cmd.param = (float) req_data.config_req.config.flow_rate;
-        k_msgq_put(&hub_cmd_q, &internal_cmd, K_NO_WAIT);
-        internal_cmd.id = CMD_SET_VOLUME;
-        internal_cmd.param = (float) req_data.config_req.config.volume;
-        k_msgq_put(&hub_cmd_q, &internal_cmd, K_NO_WAIT);
-        internal_cmd.id = CMD_SET_DIAMETER;
-        internal_cmd.param = (float) req_data.config_req.config.diameter;
-        k_msgq_put(&hub_cmd_q, &internal_cmd, K_NO_WAIT);
-        internal_cmd.id = CMD_SET_MODE;
-        internal_cmd.param = (float) req_data.config_req.config.mode;
-        k_msgq_put(&hub_cmd_q, &internal_cmd, K_NO_WAIT);
-
-        res_id = CMD_SET_CONFIG_RES_ID;
-        res_data.config_res.status = CMD_OK;
+    case CMD_ACTION_ABORT_REQ_ID:
+        internal_cmd.id = CMD_STOP;
+        break;
+    case CMD_ACTION_BOLUS_REQ_ID:
+        internal_cmd.id = CMD_SET_BOLUS;
+        break;
+    case CMD_ACTION_PURGE_REQ_ID:
+        internal_cmd.id = CMD_SET_PURGE;
         break;
+    default:
+        break;
+    }
+    if(internal_cmd.id != CMD_NONE)
+        hub_post_command(&internal_cmd);
 
-    // --- LÓGICA OTA RESTAURADA E CORRIGIDA PARA HEADER V2 ---
-    case CMD_OTA_START_REQ_ID: {
-        // Payload começa no byte 7 (Header Size)
-        // Estrutura: [Size (4 bytes)]
-        uint32_t size = utl_io_get32_fl(&buffer[CMD_HDR_SIZE]);
+    res->action_res.cmd_req_id = req->id;
+    res->action_res.status = CMD_OK;
+    return CMD_ACTION_RES_ID;
+}
 
-        LOG_INF("Comando OTA START Recebido. Tamanho: %d", size);
-        ota_start(size);
+// --- OTA (payload lido no lugar pelos acessores cmd_view_ota_*) ---
+// START e END ficam com o escritor (OTA_PENDING): guarda só o cabeçalho do pedido (o
+// payload aponta para o buffer do scanner) e o OTA_RES sai em hub_ota_result.
+static cmd_view_t ota_deferred;
+static bool ota_deferred_active;
 
-        res_id = CMD_OTA_RES_ID;
-        res_data.action_res.cmd_req_id = req_id;
-        res_data.action_res.status = CMD_OK;
-        break;
+static bool hub_ota_deferred_match(const cmd_view_t* req)
+{
+    return ota_deferred_active && ota_deferred.src == req->src && ota_deferred.seq == req->seq &&
+           ota_deferred.id == req->id && ota_deferred.crc == req->crc;
+}
+
+static cmd_ids_t hub_ota_defer(const cmd_view_t* req)
+{
+    ota_deferred = *req;
+    ota_deferred.frame = NULL;
+    ota_deferred.payload = NULL;
+    ota_deferred_active = true;
+    return HUB_NO_REPLY;
+}
+
+static uint8_t hub_ota_res_status(int ret)
+{
+    if(ret == -EILSEQ)
+        return CMD_ERR_CHECKSUM;
+    return (ret == 0) ? CMD_OK : CMD_ERR_INVALID_STATE;
+}
+
+static cmd_ids_t hub_cmd_ota_start(const cmd_view_t* req, cmd_cmds_t* res)
+{
+    uint32_t size = cmd_view_ota_start_size(req);
+    uint16_t chunk_size = cmd_view_ota_start_chunk(req);
+    uint32_t image_size = cmd_view_ota_start_image(req);
+    uint8_t flags = cmd_view_ota_start_flags(req);
+
+    LOG_INF("Comando OTA START Recebido. Tamanho: %d", size);
+    int ret = ota_start(size, chunk_size, image_size, flags);
+    if(ret == OTA_PENDING)
+        return hub_ota_defer(req);
+
+    res->ota_res.cmd_req_id = req->id;
+    res->ota_res.status = (ret == -EINVAL) ? CMD_ERR_PARAM_RANGE : hub_ota_res_status(ret);
+    return CMD_OTA_RES_ID;
+}
+
+// Chunk sem tag é do modo janela: não tem ACK, o mestre acompanha pelo OTA_STATUS
+static cmd_ids_t hub_cmd_ota_chunk(const cmd_view_t* req, cmd_cmds_t* res)
+{
+    uint32_t offset;
+    uint8_t chunk_len;
+    int ret = -EINVAL;
+
+    // Os dados vão do buffer do scanner direto para o flash (ou para a janela), sem
+    // passar por cmd_ota_chunk_t
+    uint8_t* data_ptr = cmd_view_ota_chunk(req, &offset, &chunk_len);
+    if(data_ptr != NULL)
+        ret = ota_write_chunk(offset, data_ptr, chunk_len);
+
+    if(req->seq == CMD_SEQ_NONE)
+    {
+        if(ret < 0)
+            LOG_DBG("Chunk %u descartado: %d", offset, ret);
+        return HUB_NO_REPLY;
     }
 
-    case CMD_OTA_CHUNK_REQ_ID: {
-        // Payload começa no byte 7
-        // Estrutura Chunk: [Offset (4)] + [Len (1)] + [Data...]
-        uint8_t* payload_ptr = &buffer[CMD_HDR_SIZE];
+    res->ota_res.cmd_req_id = req->id;
+    if(ret == -EINVAL)
+        res->ota_res.status = CMD_ERR_PARAM_RANGE;
+    else
+        res->ota_res.status = (ret == 0) ? CMD_OK : CMD_ERR_INVALID_STATE;
+    return CMD_OTA_RES_ID;
+}
 
-        // Offset está nos primeiros 4 bytes (indices 0-3 do payload)
-        // uint32_t offset = utl_io_get32_fl(payload_ptr); // Não usamos aqui, mas existe
+static cmd_ids_t hub_cmd_ota_status(const cmd_view_t* req, cmd_cmds_t* res)
+{
+    ota_status_t st;
+    int ret = ota_get_status(&st);
+
+    if(ret == -EBUSY)
+        res->ota_status_res.status = CMD_ERR_BUSY;
+    else
+        res->ota_status_res.status = (ret == 0) ? CMD_OK : CMD_ERR_INVALID_STATE;
+    res->ota_status_res.next_offset = st.next_offset;
+    res->ota_status_res.missing = st.missing;
+    res->ota_status_res.total_size = st.total_size;
+    res->ota_status_res.chunk_size = st.chunk_size;
+    res->ota_status_res.image_crc = st.image_crc;
+    return CMD_OTA_STATUS_RES_ID;
+}
 
-        // Len está no byte 4 do payload
-        uint8_t chunk_len = payload_ptr[4];
+// END com digest: a imagem só é agendada se CRC e SHA-256 batem (CMD_ERR_CHECKSUM senão).
+// A resposta espera o escritor; um END novo enquanto isso (outra seq) passa a ser o respondido.
+static cmd_ids_t hub_cmd_ota_end(const cmd_view_t* req, cmd_cmds_t* res)
+{
+    uint16_t image_crc = 0;
+    const uint8_t* sha256 = cmd_view_ota_end_digest(req, &image_crc);
 
-        // Data começa no byte 5 do payload
-        uint8_t* data_ptr = &payload_ptr[5];
+    LOG_INF("Comando OTA END Recebido.");
 
-        if(ota_write_chunk(data_ptr, chunk_len) == 0)
-        {
-            res_data.action_res.status = CMD_OK;
-        }
-        else
-        {
-            res_data.action_res.status = CMD_ERR_INVALID_STATE;
-        }
-        res_id = CMD_OTA_RES_ID;
-        res_data.action_res.cmd_req_id = req_id;
-        break;
+    res->ota_res.cmd_req_id = req->id;
+    if(sha256 == NULL && req->payload_size != 0)
+    {
+        res->ota_res.status = CMD_ERR_PARAM_RANGE;
+        return CMD_OTA_RES_ID;
     }
 
-    case CMD_OTA_END_REQ_ID: {
-        LOG_INF("Comando OTA END Recebido.");
-        ota_finish();
-        res_id = CMD_OTA_RES_ID;
-        res_data.action_res.cmd_req_id = req_id;
-        res_data.action_res.status = CMD_OK;
-        break;
+    int ret = ota_finish(sha256, image_crc);
+    if(ret == OTA_PENDING || ret == -EINPROGRESS)
+        return hub_ota_defer(req);
+    res->ota_res.status = hub_ota_res_status(ret);
+    return CMD_OTA_RES_ID;
+}
+
+// Tabela de despacho, da mesma CMD_TABLE do codec: um comando novo é uma linha lá
+// mais o seu hub_cmd_xxx aqui. 'none' = sem handler (respostas e telemetria).
+#define hub_cmd_none NULL
+static const hub_handler_t hub_handlers[CMD_NUM_CMDS] = {
+#define CMD_TABLE_HUB(name, id, member, min, max, enc, dec, hub) [CMD_##name##_ID] = hub_cmd_##hub,
+    CMD_TABLE(CMD_TABLE_HUB)
+#undef CMD_TABLE_HUB
+};
+#undef hub_cmd_none
+
+// A resposta ecoa a sequência do pedido e volta para quem pediu. ACK para o mestre sai do
+// template: prefixo copiado, CRC só sobre SEQ, SIZE e os 2 bytes de payload.
+static bool hub_encode_reply(const cmd_view_t* req, cmd_ids_t res_id, cmd_cmds_t* res, uint8_t* out, size_t* len)
+{
+    if(req->src == ADDR_MASTER && req->dst == ADDR_SLAVE && (res_id == CMD_ACTION_RES_ID || res_id == CMD_OTA_RES_ID))
+    {
+        uint8_t ack[CMD_ACTION_RES_SIZE] = {res->action_res.cmd_req_id, res->action_res.status};
+        *len = cmd_tmpl_emit(res_id == CMD_OTA_RES_ID ? &ack_tmpl_ota : &ack_tmpl_action, req->seq, ack, out);
+        return true;
     }
-        // ----------------------------------------------------
 
-    default:
-        res_id = CMD_ACTION_RES_ID;
-        res_data.action_res.status = CMD_OK;
-        res_data.action_res.cmd_req_id = req_id;
+    uint8_t dst = req->src, src = req->dst, seq = req->seq;
+    return cmd_encode(out, len, &src, &dst, &seq, &res_id, res);
+}
 
-        if(req_id >= CMD_ACTION_RUN_REQ_ID && req_id <= CMD_ACTION_BOLUS_REQ_ID)
-        {
-            switch(req_id)
-            {
-            case CMD_ACTION_RUN_REQ_ID:
-                internal_cmd.id = CMD_START;
-                break;
-            case CMD_ACTION_PAUSE_REQ_ID:
-                internal_cmd.id = CMD_PAUSE;
-                break;
-            case CMD_ACTION_ABORT_REQ_ID:
-                internal_cmd.id = CMD_STOP;
-                break;
-            case CMD_ACTION_BOLUS_REQ_ID:
-                internal_cmd.id = CMD_SET_BOLUS;
-                break;
-            case CMD_ACTION_PURGE_REQ_ID:
-                internal_cmd.id = CMD_SET_PURGE;
-                break;
-            default:
-                internal_cmd.id = CMD_NONE;
-                break;
-            }
-            if(internal_cmd.id != CMD_NONE)
-            {
-                internal_cmd.param = 0.0f;
-                k_msgq_put(&hub_cmd_q, &internal_cmd, K_NO_WAIT);
-            }
-        }
-        break;
+// A resposta é codificada direto na fila de respostas, de onde hub_pack_replies a leva ao
+// slot. Perto da volta do anel (área contígua menor que um frame máximo) ela vai para o
+// buffer local e é copiada. Pedido com sequência fica no cache de replay.
+static void hub_emit_reply(const cmd_view_t* req, cmd_ids_t res_id, cmd_cmds_t* res)
+{
+    uint8_t res_frame[FRAME_MAX_CMD_SIZE];
+    size_t tx_len = 0;
+    uint8_t* out;
+    bool in_place = (ring_buf_put_claim(&hub_res_fifo, &out, FRAME_MAX_CMD_SIZE) == FRAME_MAX_CMD_SIZE);
+    if(!in_place)
+    {
+        ring_buf_put_finish(&hub_res_fifo, 0);
+        out = res_frame;
     }
 
-    // Prepara a resposta para a PRÓXIMA transação SPI
-    cmd_encode(tx_buffer, &tx_len, &dst, &src, &res_id, &res_data);
+    if(!hub_encode_reply(req, res_id, res, out, &tx_len))
+    {
+        if(in_place)
+            ring_buf_put_finish(&hub_res_fifo, 0);
+        return;
+    }
+
+    if(req->seq != CMD_SEQ_NONE)
+        replay_store(req->src, req->seq, req->id, req->crc, out, tx_len);
+
+    if(in_place)
+        ring_buf_put_finish(&hub_res_fifo, tx_len);
+    else
+        hub_queue_reply(res_frame, tx_len);
 }
 
-// --- MÁQUINA DE ESTADOS (FEEDER) ---
-void protocol_feed_byte(uint8_t byte)
+// --- PROCESSADOR DE PACOTE VÁLIDO ---
+static void process_valid_packet(uint8_t* buffer, size_t len)
 {
-    switch(p_state)
+    if(hub_transport.frame_ok != NULL)
+        hub_transport.frame_ok();
+
+    cmd_view_t req;
+    cmd_ids_t res_id;
+    cmd_cmds_t res_data;
+
+    // O 'buffer' aqui começa no byte 0 (que agora é SOF1 0xAA) graças à lógica do parser.
+    // A visão aponta para dentro dele: nenhum campo é copiado até o handler pedir.
+    if(!cmd_view(buffer, len, &req))
     {
-    case STATE_WAIT_SOF1:
-        if(byte == SOF_BYTE_1)
-            p_state = STATE_WAIT_SOF2;
-        break;
+        LOG_WRN("Erro logico no cmd_view (Estrutura invalida)");
+        return;
+    }
 
-    case STATE_WAIT_SOF2:
-        if(byte == SOF_BYTE_2)
-        {
-            p_state = STATE_READ_HEADER;
-            p_index = 0;
-            // Salva o SOF no buffer para validação do CRC depois
-            p_buffer[p_index++] = SOF_BYTE_1;
-            p_buffer[p_index++] = SOF_BYTE_2;
-        }
-        else if(byte == SOF_BYTE_1)
+    // Retry de um pedido já executado: devolve a mesma resposta, sem efeito colateral
+    if(req.seq != CMD_SEQ_NONE)
+    {
+        hub_replay_entry_t* cached = replay_lookup(req.src, req.seq, req.id, req.crc);
+        if(cached != NULL)
         {
-            p_state = STATE_WAIT_SOF2; // Sequência AA AA...
+            LOG_DBG("Retry seq %d (0x%02X): resposta do cache", req.seq, req.id);
+            hub_queue_reply(cached->frame, cached->len);
+            return;
         }
-        else
+        // Retry de um pedido ainda com o escritor do OTA: a resposta sai quando ele acabar
+        if(hub_ota_deferred_match(&req))
+            return;
+    }
+
+    memset(&res_data, 0, sizeof(res_data));
+
+    // Despacho O(1) pela tabela: cada handler preenche a resposta e devolve o ID dela
+    hub_handler_t handler = hub_handlers[req.id];
+    if(handler != NULL)
+    {
+        res_id = handler(&req, &res_data);
+        if(res_id == HUB_NO_REPLY)
+            return;
+        if(res_id == CMD_INVALID_ID)
         {
-            p_state = STATE_WAIT_SOF1; // Lixo
+            LOG_WRN("Payload invalido no comando 0x%02X", req.id);
+            return;
         }
-        break;
+    }
+    else
+    {
+        // Comando válido no protocolo mas não tratado pelo escravo (ex.: uma resposta)
+        res_id = CMD_ACTION_RES_ID;
+        res_data.action_res.cmd_req_id = req.id;
+        res_data.action_res.status = CMD_ERR_UNKNOWN_CMD;
+    }
+
+    hub_emit_reply(&req, res_id, &res_data);
+}
 
-    case STATE_READ_HEADER:
-        p_buffer[p_index++] = byte;
-        // Header(7 bytes) = SOF1+SOF2 + 5 bytes restantes
-        if(p_index >= CMD_HDR_SIZE)
+// Resultado do escritor do OTA: vira o OTA_RES adiado do START ou do END (se o mestre ainda espera)
+static void hub_ota_result(void)
+{
+    int ret;
+    if(!ota_take_result(&ret) || !ota_deferred_active)
+        return;
+
+    cmd_cmds_t res;
+    memset(&res, 0, sizeof(res));
+    res.ota_res.cmd_req_id = ota_deferred.id;
+    res.ota_res.status = hub_ota_res_status(ret);
+    ota_deferred_active = false;
+    hub_emit_reply(&ota_deferred, CMD_OTA_RES_ID, &res);
+}
+
+// --- CALLBACK DO SCANNER ---
+static void hub_on_frame(uint8_t* frame, size_t len, void* ctx)
+{
+    (void) ctx;
+    process_valid_packet(frame, len);
+}
+
+// --- THREAD DE LINK (Só roda o transporte e entrega slots) ---
+void hub_link_desync(void)
+{
+    atomic_set(&link_desync, 1);
+}
+
+static void hub_link_thread_entry(void* p1, void* p2, void* p3)
+{
+    uint8_t idx;
+
+    k_sem_take(&link_start, K_FOREVER);
+    LOG_INF("Hub Link %s (%d slots) Iniciado.", hub_transport.name, HUB_SLOTS);
+
+    while(1)
+    {
+        k_msgq_get(&slot_free_q, &idx, K_FOREVER);
+        hub_slot_t* slot = &hub_slots[idx];
+
+        int ret;
+        while((ret = hub_transport.exchange(slot)) < 0)
         {
-            // Extrai o tamanho esperado do payload
-            // O campo size está nos últimos 2 bytes do header (indices 5 e 6)
-            p_expected_len = utl_io_get16_fl(&p_buffer[5]);
-
-            if(p_expected_len > CMD_MAX_DATA_SIZE)
-            {
-                p_state = STATE_WAIT_SOF1; // Tamanho inválido
-            }
-            else
-            {
-                p_state = STATE_READ_PAYLOAD;
-            }
+            // Erro físico: o backend já tratou (reset/espera); repete o mesmo slot
         }
-        break;
 
-    case STATE_READ_PAYLOAD:
-        // Lê bytes de Payload + CRC
-        if(p_expected_len > 0 || p_index < (CMD_HDR_SIZE + CMD_TRAILER_SIZE))
+        slot->rx_cycles = k_cycle_get_32();
+        // TX_LOST: continua pendente, o Hub devolve as respostas para a fila
+        if(slot->pending && ret != HUB_EXCHANGE_TX_LOST)
         {
-            p_buffer[p_index++] = byte;
+            // O mestre já leu o que havia neste slot
+            slot->pending = false;
+            atomic_dec(&tx_pending_slots);
+            hub_update_attention();
         }
+        k_msgq_put(&slot_done_q, &idx, K_FOREVER);
+    }
+}
+
+// Slot que voltou sem o mestre ter lido: as respostas vão para hub_res_carry (a
+// telemetria não, a próxima sai mais nova)
+static void hub_requeue_slot(hub_slot_t* slot)
+{
+    size_t off = 0;
 
-        // Verifica se completou o frame (Header + Payload + CRC)
-        if(p_index >= (CMD_HDR_SIZE + p_expected_len + CMD_TRAILER_SIZE))
+    while(off + CMD_HDR_SIZE <= slot->tx_len && slot->tx[off] == CMD_SOF_1_BYTE)
+    {
+        const uint8_t* frame = &slot->tx[off];
+        size_t frame_len = CMD_HDR_SIZE + utl_io_get16_fl(&frame[CMD_HDR_SIZE_OFFSET]) + CMD_TRAILER_SIZE;
+
+        off += frame_len;
+        if(frame[CMD_HDR_ID_OFFSET] == CMD_TLM_DATA_ID)
+            continue;
+        if(hub_res_carry_len + frame_len > sizeof(hub_res_carry))
         {
-            process_valid_packet(p_buffer, p_index);
-            p_state = STATE_WAIT_SOF1; // Volta a caçar
+            LOG_WRN("Resposta 0x%02X perdida na troca de modo de link", frame[CMD_HDR_ID_OFFSET]);
+            continue;
         }
-        break;
-
-    default:
-        p_state = STATE_WAIT_SOF1;
-        break;
+        memcpy(&hub_res_carry[hub_res_carry_len], frame, frame_len);
+        hub_res_carry_len += frame_len;
     }
+
+    slot->pending = false;
+    atomic_dec(&tx_pending_slots);
 }
 
-void hub_thread_entry(void* p1, void* p2, void* p3)
+// Empacota frames inteiros de hub_res_carry e depois da fila de respostas no slot;
+// retorna quantos bytes usou
+static size_t hub_pack_replies(hub_slot_t* slot, size_t capacity, bool* link_config_sent)
 {
-    LOG_INF("Hub Parser (Stream Mode) Iniciado.");
+    uint8_t hdr[CMD_HDR_SIZE];
+    size_t used = 0;
+    size_t carry_off = 0;
 
-    while(1)
+    while(carry_off < hub_res_carry_len)
     {
-        struct spi_buf rx_buf = {.buf = rx_raw_buffer, .len = SPI_PACKET_SIZE};
-        struct spi_buf_set rx_set = {.buffers = &rx_buf, .count = 1};
+        const uint8_t* frame = &hub_res_carry[carry_off];
+        size_t frame_len = CMD_HDR_SIZE + utl_io_get16_fl(&frame[CMD_HDR_SIZE_OFFSET]) + CMD_TRAILER_SIZE;
 
-        struct spi_buf tx_buf_s = {.buf = tx_buffer, .len = SPI_PACKET_SIZE};
-        struct spi_buf_set tx_set = {.buffers = &tx_buf_s, .count = 1};
+        if(frame_len <= capacity && used + frame_len > capacity)
+            break;
+        if(frame_len <= capacity)
+        {
+            memcpy(&slot->tx[used], frame, frame_len);
+            used += frame_len;
+            if(frame[CMD_HDR_ID_OFFSET] == CMD_LINK_CONFIG_RES_ID)
+                *link_config_sent = true;
+        }
+        carry_off += frame_len; // Maior que a transação: descartado, como na fila
+    }
+    hub_res_carry_len -= carry_off;
+    memmove(hub_res_carry, &hub_res_carry[carry_off], hub_res_carry_len);
+    if(hub_res_carry_len > 0)
+        return used; // A fila espera o carry acabar, para não passar na frente
 
-        gpio_pin_set_dt(&ready_pin, 1);
-        int ret = spi_transceive(spi_dev, &spi_cfg, &tx_set, &rx_set);
-        gpio_pin_set_dt(&ready_pin, 0);
+    while(ring_buf_peek(&hub_res_fifo, hdr, CMD_HDR_SIZE) == CMD_HDR_SIZE)
+    {
+        size_t frame_len = CMD_HDR_SIZE + utl_io_get16_fl(&hdr[CMD_HDR_SIZE_OFFSET]) + CMD_TRAILER_SIZE;
 
-        // --- TRATAMENTO DE ERRO FÍSICO ---
-        if(ret < 0)
+        if(frame_len > capacity)
         {
-            LOG_ERR("Erro SPI Driver: %d", ret);
-            spi_consecutive_errors++;
-
-            // Tenta curar
-            reset_spi_peripheral();
-
-            if(spi_consecutive_errors > 10) // 10 erros seguidos = Morte
-            {
-                LOG_ERR("FALHA CRITICA: Reiniciando Sistema...");
-                k_sleep(K_MSEC(200));
-                sys_reboot(SYS_REBOOT_COLD);
-            }
-            k_sleep(K_MSEC(10));
+            // Nunca caberia neste modo de link: descarta para não travar a fila
+            LOG_WRN("Resposta 0x%02X (%d bytes) maior que a transação. Descartada.", hdr[CMD_HDR_ID_OFFSET],
+                    (int) frame_len);
+            ring_buf_get(&hub_res_fifo, NULL, frame_len);
             continue;
         }
+        if(used + frame_len > capacity)
+            break;
+
+        ring_buf_get(&hub_res_fifo, &slot->tx[used], frame_len);
+        used += frame_len;
+
+        if(hdr[CMD_HDR_ID_OFFSET] == CMD_LINK_CONFIG_RES_ID)
+            *link_config_sent = true;
+    }
+    return used;
+}
+
+// Prepara o slot para ser armado de novo, no modo de link corrente
+static void hub_prepare_slot(hub_slot_t* slot)
+{
+    bool link_config_sent = false;
+
+    if(atomic_clear(&link_desync))
+    {
+        link_mode = CMD_LINK_MODE_FIXED;
+        link_mode_pending = -1;
+    }
+
+    slot->mode = link_mode;
+    if(link_mode == CMD_LINK_MODE_FIXED && hub_transport.master_clocked)
+    {
+        // Modo legado: sempre 64 bytes; sobra vai para telemetria e depois zero
+        size_t used = hub_pack_replies(slot, CMD_LINK_FIXED_SIZE, &link_config_sent);
+        used = hub_pack_telemetry(slot, used, CMD_LINK_FIXED_SIZE);
+        memset(&slot->tx[used], 0, CMD_LINK_FIXED_SIZE - used);
+        slot->tx_len = CMD_LINK_FIXED_SIZE;
+        slot->pending = (used > 0);
+    }
+    else
+    {
+        // Modo com tamanho (ou transporte de stream): só os bytes das respostas empacotadas (+ telemetria pendente)
+        size_t used = hub_pack_replies(slot, CMD_LINK_MAX_BODY, &link_config_sent);
+        slot->tx_len = hub_pack_telemetry(slot, used, CMD_LINK_MAX_BODY);
+        slot->pending = (slot->tx_len > 0);
+    }
+
+    // A resposta do LINK_CONFIG foi neste slot; os próximos já usam o modo novo
+    if(link_config_sent && link_mode_pending >= 0)
+    {
+        link_mode = (uint8_t) link_mode_pending;
+        link_mode_pending = -1;
+        LOG_INF("Modo de link: %s", link_mode == CMD_LINK_MODE_VARIABLE ? "VARIABLE" : "FIXED");
+    }
+}
+
+void hub_thread_entry(void* p1, void* p2, void* p3)
+{
+    uint8_t idx;
+
+    LOG_INF("Hub Parser (Stream Mode) Iniciado.");
+
+    while(1)
+    {
+        k_msgq_get(&slot_done_q, &idx, K_FOREVER);
+        hub_slot_t* slot = &hub_slots[idx];
 
         // --- ALIMENTA O PARSER ---
-        for(int i = 0; i < SPI_PACKET_SIZE; i++)
-        {
-            protocol_feed_byte(rx_raw_buffer[i]);
-        }
+        // Roda enquanto a thread de link já mantém o próximo slot armado.
+        // O bloco inteiro vai de uma vez; frame cortado continua no próximo slot.
+        hub_rx_cycles = slot->rx_cycles;
+        frame_scanner_feed(&hub_scanner, slot->rx, slot->rx_len);
+
+        // Slot volta para a fila com a resposta mais recente
+        memset(slot->rx, 0, slot->rx_len);
+        if(slot->pending)
+            hub_requeue_slot(slot);
+        hub_ota_result();
+        hub_prepare_slot(slot);
+        if(slot->pending)
+            atomic_inc(&tx_pending_slots); // Antes do put: a thread de link pode consumir já
+        k_msgq_put(&slot_free_q, &idx, K_FOREVER);
+        hub_update_attention();
+
+        // Stream: o transporte pode estar parado no outro slot esperando RX
+        if(slot->pending && hub_transport.kick != NULL)
+            hub_transport.kick();
 
-        memset(rx_raw_buffer, 0, SPI_PACKET_SIZE);
         ota_check_and_reboot();
     }
 }
@@ -0,0 +1,73 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "hub_transport.h"
+#include "hub_pipe_bottom.h"
+
+LOG_MODULE_REGISTER(hub_pipe, LOG_LEVEL_INF);
+
+// --- TRANSPORTE PIPE (native_sim) ---
+// Socket Unix no host (CONFIG_HUB_TRANSPORT_PIPE_PATH) com o mesmo stream de frames da
+// UART: sem header de link, sem padding. A leitura do lado host (hub_pipe_bottom.c) não
+// bloqueia; enquanto não chega nada, a thread de link dorme um tick ou até um kick. O
+// prj_native_sim.conf sobe o tick para 50 us: é esse o piso de latência de uma ida e volta.
+// Build: west build -b native_sim -- -DCONF_FILE=prj_native_sim.conf
+
+static K_SEM_DEFINE(pipe_kick, 0, 1);
+static bool pipe_connected;
+
+static int hub_pipe_init(void)
+{
+    if(hub_pipe_bottom_open(CONFIG_HUB_TRANSPORT_PIPE_PATH) != 0)
+    {
+        LOG_ERR("Nao foi possivel criar %s", CONFIG_HUB_TRANSPORT_PIPE_PATH);
+        return -1;
+    }
+    LOG_INF("Aguardando mestre em %s", CONFIG_HUB_TRANSPORT_PIPE_PATH);
+    return 0;
+}
+
+static int hub_pipe_exchange(hub_slot_t* slot)
+{
+    // Sem cliente, a resposta se perde (como numa UART sem ninguém do outro lado)
+    if(slot->tx_len > 0)
+        hub_pipe_bottom_write(slot->tx, slot->tx_len);
+
+    while(1)
+    {
+        int n = hub_pipe_bottom_read(slot->rx, sizeof(slot->rx));
+        if(n > 0)
+        {
+            if(!pipe_connected)
+                LOG_INF("Mestre conectado.");
+            pipe_connected = true;
+            slot->rx_len = (size_t) n;
+            return 0;
+        }
+        if(n < 0 && pipe_connected)
+        {
+            LOG_WRN("Mestre desconectou.");
+            pipe_connected = false;
+        }
+
+        if(k_sem_take(&pipe_kick, K_TICKS(1)) == 0)
+        {
+            slot->rx_len = 0;
+            return 0;
+        }
+    }
+}
+
+static void hub_pipe_kick(void)
+{
+    k_sem_give(&pipe_kick);
+}
+
+const hub_transport_t hub_transport = {
+    .name = "PIPE",
+    .master_clocked = false,
+    .init = hub_pipe_init,
+    .exchange = hub_pipe_exchange,
+    .kick = hub_pipe_kick,
+    .attention = NULL,
+    .frame_ok = NULL,
+};
@@ -0,0 +1,95 @@
+#define _GNU_SOURCE
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include "hub_pipe_bottom.h"
+
+static int listen_fd = -1;
+static int client_fd = -1;
+
+int hub_pipe_bottom_open(const char* path)
+{
+    struct sockaddr_un addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(listen_fd < 0)
+        return -1;
+
+    if(bind(listen_fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(listen_fd, 1) < 0)
+    {
+        perror("hub_pipe");
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+// Aceita um cliente novo se não há nenhum conectado
+static int hub_pipe_bottom_client(void)
+{
+    if(client_fd < 0 && listen_fd >= 0)
+        client_fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK);
+    return client_fd;
+}
+
+static void hub_pipe_bottom_drop(void)
+{
+    close(client_fd);
+    client_fd = -1;
+}
+
+int hub_pipe_bottom_read(uint8_t* buf, size_t len)
+{
+    if(hub_pipe_bottom_client() < 0)
+        return 0;
+
+    ssize_t n = recv(client_fd, buf, len, 0);
+    if(n > 0)
+        return (int) n;
+    if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return 0;
+
+    hub_pipe_bottom_drop(); // EOF ou erro: espera o próximo cliente
+    return -1;
+}
+
+int hub_pipe_bottom_write(const uint8_t* buf, size_t len)
+{
+    size_t sent = 0;
+
+    if(hub_pipe_bottom_client() < 0)
+        return -1;
+
+    while(sent < len)
+    {
+        ssize_t n = send(client_fd, &buf[sent], len - sent, MSG_NOSIGNAL);
+        if(n > 0)
+        {
+            sent += (size_t) n;
+            continue;
+        }
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            struct pollfd pfd = {.fd = client_fd, .events = POLLOUT};
+            if(poll(&pfd, 1, 100) > 0)
+                continue;
+        }
+        else if(n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        hub_pipe_bottom_drop();
+        return -1;
+    }
+    return (int) len;
+}
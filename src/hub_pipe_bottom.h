@@ -0,0 +1,24 @@
+#ifndef HUB_PIPE_BOTTOM_H
+#define HUB_PIPE_BOTTOM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Lado host do transporte PIPE (native_sim). Compilado contra a libc do Linux
+ * (target native_simulator), fora do Zephyr: só tipos C puros na interface.
+ * Um cliente por vez no socket Unix. Tudo roda na thread do kernel simulado: a leitura
+ * nunca bloqueia, e a escrita só bloqueia (parando o kernel) se o cliente não lê.
+ */
+
+/* Cria o socket em 'path' (apaga um socket velho). 0 ou -1. */
+int hub_pipe_bottom_open(const char* path);
+
+/* Lê o que houver, sem bloquear. Retorna bytes lidos, 0 se nada, -1 se o cliente saiu. */
+int hub_pipe_bottom_read(uint8_t* buf, size_t len);
+
+/* Envia tudo. Com o socket cheio, espera até 100 ms por vez ele esvaziar, com o kernel
+ * simulado parado; sem progresso nesse tempo, derruba o cliente. Retorna len ou -1. */
+int hub_pipe_bottom_write(const uint8_t* buf, size_t len);
+
+#endif
@@ -0,0 +1,173 @@
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/spi.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/reboot.h>
+#include <string.h>
+#include <soc.h>
+#include <stm32_ll_spi.h>
+#include "hub_transport.h"
+
+LOG_MODULE_REGISTER(hub_spi, LOG_LEVEL_INF);
+
+// --- TRANSPORTE SPI ESCRAVO (DMA) ---
+// O mestre gera o clock: cada exchange() é uma transação armada e esperando o mestre.
+// O pino spi-ready sobe enquanto o DMA está armado; hub-attn sobe enquanto há algo
+// para o mestre ler (handshake em cmd.h).
+
+static const struct device* spi_dev = DEVICE_DT_GET(DT_NODELABEL(spi1));
+static const struct gpio_dt_spec ready_pin = GPIO_DT_SPEC_GET(DT_ALIAS(spi_ready), gpios);
+static const struct gpio_dt_spec attn_pin = GPIO_DT_SPEC_GET(DT_ALIAS(hub_attn), gpios);
+
+#define SPI_PACKET_SIZE CMD_LINK_FIXED_SIZE // Tamanho do chunk físico no modo FIXED
+
+static atomic_t spi_consecutive_errors = ATOMIC_INIT(0);
+
+static const struct spi_config spi_cfg =
+{
+    // Modo 0: CPOL=0, CPHA=0
+    .operation = SPI_WORD_SET(8) | SPI_TRANSFER_MSB | SPI_OP_MODE_SLAVE,
+    .frequency = 1000000,
+    .slave = 0,
+};
+
+// --- RESET DE HARDWARE (Auto-Cura) ---
+static void reset_spi_peripheral(void)
+{
+    SPI_TypeDef* spi_regs = (SPI_TypeDef*) DT_REG_ADDR(DT_NODELABEL(spi1));
+
+    // Sequência de Reset Seguro
+    spi_regs->CR1 &= ~SPI_CR1_SPE; // Desabilita
+    k_busy_wait(100);
+
+    // Limpa Flags
+    volatile uint32_t temp;
+    temp = spi_regs->DR;
+    temp = spi_regs->SR;
+    (void) temp;
+
+    spi_regs->CR1 |= SPI_CR1_SPE; // Habilita
+    LOG_WRN(">>> SPI HARDWARE RESET <<<");
+}
+
+static int hub_spi_init(void)
+{
+    if(!device_is_ready(spi_dev))
+        return -1;
+
+    if(device_is_ready(ready_pin.port))
+    {
+        gpio_pin_configure_dt(&ready_pin, GPIO_OUTPUT_INACTIVE);
+    }
+    if(device_is_ready(attn_pin.port))
+    {
+        gpio_pin_configure_dt(&attn_pin, GPIO_OUTPUT_INACTIVE);
+    }
+    return 0;
+}
+
+// Uma transferência física; trata erro de driver (reset/reboot) e devolve o retorno do driver.
+static int hub_spi_xfer(uint8_t* tx, uint8_t* rx, size_t len)
+{
+    struct spi_buf rx_buf = {.buf = rx, .len = len};
+    struct spi_buf_set rx_set = {.buffers = &rx_buf, .count = 1};
+
+    struct spi_buf tx_buf_s = {.buf = tx, .len = len};
+    struct spi_buf_set tx_set = {.buffers = &tx_buf_s, .count = 1};
+
+    gpio_pin_set_dt(&ready_pin, 1);
+    int ret = spi_transceive(spi_dev, &spi_cfg, &tx_set, &rx_set);
+    gpio_pin_set_dt(&ready_pin, 0);
+
+    // --- TRATAMENTO DE ERRO FÍSICO ---
+    if(ret < 0)
+    {
+        LOG_ERR("Erro SPI Driver: %d", ret);
+
+        // Tenta curar
+        reset_spi_peripheral();
+
+        if(atomic_inc(&spi_consecutive_errors) >= 10) // 10 erros seguidos = Morte
+        {
+            LOG_ERR("FALHA CRITICA: Reiniciando Sistema...");
+            k_sleep(K_MSEC(200));
+            sys_reboot(SYS_REBOOT_COLD);
+        }
+        k_sleep(K_MSEC(10));
+    }
+    return ret;
+}
+
+static int hub_spi_fixed_transaction(hub_slot_t* slot)
+{
+    int ret = hub_spi_xfer(slot->tx, slot->rx, SPI_PACKET_SIZE);
+    if(ret < 0)
+        return ret;
+
+    // Em modo slave o driver retorna quantos frames realmente chegaram
+    slot->rx_len = (ret > 0 && ret < SPI_PACKET_SIZE) ? (size_t) ret : SPI_PACKET_SIZE;
+    return 0;
+}
+
+static int hub_spi_variable_transaction(hub_slot_t* slot)
+{
+    cmd_link_hdr_t hdr_tx = {.magic = CMD_LINK_MAGIC_SLAVE, .flags = 0, .len = (uint16_t) slot->tx_len};
+    cmd_link_hdr_t hdr_rx;
+
+    int ret = hub_spi_xfer((uint8_t*) &hdr_tx, (uint8_t*) &hdr_rx, sizeof(hdr_rx));
+    if(ret < 0)
+        return ret;
+
+    if(hdr_rx.magic != CMD_LINK_MAGIC_MASTER || hdr_rx.len > CMD_LINK_MAX_BODY)
+    {
+        // Mestre fora de sincronia (reiniciou ou ainda está no modo FIXED): o corpo não
+        // foi trocado, então só o RX se perde; as respostas do slot voltam para a fila
+        LOG_WRN("Header de link invalido (%02X). Voltando ao modo FIXED.", hdr_rx.magic);
+        hub_link_desync();
+        slot->rx_len = 0;
+        return HUB_EXCHANGE_TX_LOST;
+    }
+
+    size_t body = MAX(hdr_rx.len, slot->tx_len);
+    if(body > 0)
+    {
+        memset(&slot->tx[slot->tx_len], 0, body - slot->tx_len);
+        ret = hub_spi_xfer(slot->tx, slot->rx, body);
+        if(ret < 0)
+            return ret;
+    }
+    slot->rx_len = hdr_rx.len;
+    return 0;
+}
+
+static int hub_spi_exchange(hub_slot_t* slot)
+{
+    if(slot->mode == CMD_LINK_MODE_VARIABLE)
+        return hub_spi_variable_transaction(slot);
+    return hub_spi_fixed_transaction(slot);
+}
+
+static void hub_spi_attention(bool active)
+{
+    gpio_pin_set_dt(&attn_pin, active ? 1 : 0);
+}
+
+static void hub_spi_frame_ok(void)
+{
+    // Zera erros pois tivemos sucesso
+    if(atomic_get(&spi_consecutive_errors) > 0)
+    {
+        LOG_INF("SPI Recuperado! Erros zerados.");
+        atomic_set(&spi_consecutive_errors, 0);
+    }
+}
+
+const hub_transport_t hub_transport = {
+    .name = "SPI",
+    .master_clocked = true,
+    .init = hub_spi_init,
+    .exchange = hub_spi_exchange,
+    .kick = NULL,
+    .attention = hub_spi_attention,
+    .frame_ok = hub_spi_frame_ok,
+};
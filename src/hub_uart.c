@@ -0,0 +1,130 @@
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/ring_buffer.h>
+#include "hub_transport.h"
+
+LOG_MODULE_REGISTER(hub_uart, LOG_LEVEL_INF);
+
+// --- TRANSPORTE UART (API ASYNC + DMA NA USART1) ---
+// Stream full-duplex: sem header de link e sem padding, os frames vão colados.
+// O RX fica sempre ligado em buffer duplo; cada UART_RX_RDY (timeout de silêncio ou
+// buffer cheio) copia os bytes para uart_rx_ring e acorda a thread de link.
+// Build: west build -- -DEXTRA_CONF_FILE=uart_transport.conf -DEXTRA_DTC_OVERLAY_FILE=uart_transport.overlay
+
+static const struct device* uart_dev = DEVICE_DT_GET(DT_NODELABEL(usart1));
+
+#define UART_RX_CHUNK      64   // Buffer do DMA de RX (dois, alternados pelo driver)
+#define UART_RX_TIMEOUT_US 200  // Silêncio na linha que fecha um bloco (~20 bytes a 921600)
+#define UART_TX_TIMEOUT_MS 100  // 260 bytes levam ~3 ms a 921600 e ~23 ms a 115200
+
+static uint8_t uart_rx_bufs[2][UART_RX_CHUNK];
+static uint8_t uart_rx_next; // Próximo buffer entregue em UART_RX_BUF_REQUEST
+
+RING_BUF_DECLARE(uart_rx_ring, 2 * CMD_LINK_MAX_BODY);
+
+static K_SEM_DEFINE(uart_tx_done, 0, 1);
+static K_SEM_DEFINE(uart_wake, 0, 1); // RX chegou ou o Hub tem algo a enviar
+static atomic_t uart_rx_overruns = ATOMIC_INIT(0);
+
+static void hub_uart_callback(const struct device* dev, struct uart_event* evt, void* user_data)
+{
+    (void) user_data;
+
+    switch(evt->type)
+    {
+    case UART_TX_DONE:
+    case UART_TX_ABORTED:
+        k_sem_give(&uart_tx_done);
+        break;
+
+    case UART_RX_RDY:
+        // Fila cheia: perde bytes; o scanner ressincroniza no próximo SOF e o mestre repete
+        if(ring_buf_put(&uart_rx_ring, &evt->data.rx.buf[evt->data.rx.offset], evt->data.rx.len) <
+           evt->data.rx.len)
+            atomic_inc(&uart_rx_overruns);
+        k_sem_give(&uart_wake);
+        break;
+
+    case UART_RX_BUF_REQUEST:
+        uart_rx_buf_rsp(dev, uart_rx_bufs[uart_rx_next], UART_RX_CHUNK);
+        uart_rx_next ^= 1;
+        break;
+
+    case UART_RX_DISABLED:
+        // Erro de linha (framing/ruído) desliga o RX: religa do zero
+        uart_rx_next = 1;
+        uart_rx_enable(dev, uart_rx_bufs[0], UART_RX_CHUNK, UART_RX_TIMEOUT_US);
+        break;
+
+    case UART_RX_STOPPED:
+        LOG_WRN("UART RX parou (motivo %d)", evt->data.rx_stop.reason);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static int hub_uart_init(void)
+{
+    if(!device_is_ready(uart_dev))
+        return -1;
+
+    int ret = uart_callback_set(uart_dev, hub_uart_callback, NULL);
+    if(ret < 0)
+    {
+        LOG_ERR("UART sem API async (%d)", ret);
+        return ret;
+    }
+
+    uart_rx_next = 1;
+    return uart_rx_enable(uart_dev, uart_rx_bufs[0], UART_RX_CHUNK, UART_RX_TIMEOUT_US);
+}
+
+static int hub_uart_exchange(hub_slot_t* slot)
+{
+    if(slot->tx_len > 0)
+    {
+        k_sem_reset(&uart_tx_done);
+        int ret = uart_tx(uart_dev, slot->tx, slot->tx_len, SYS_FOREVER_US);
+        if(ret < 0)
+        {
+            LOG_ERR("Erro UART TX: %d", ret);
+            k_sleep(K_MSEC(10));
+            return ret;
+        }
+        if(k_sem_take(&uart_tx_done, K_MSEC(UART_TX_TIMEOUT_MS)) != 0)
+        {
+            uart_tx_abort(uart_dev);
+            LOG_ERR("UART TX travado. Abortado.");
+            return -EIO;
+        }
+    }
+
+    // O slot volta com o que chegou (pode ser nada, se foi um kick)
+    k_sem_take(&uart_wake, K_FOREVER);
+    slot->rx_len = ring_buf_get(&uart_rx_ring, slot->rx, sizeof(slot->rx));
+    if(!ring_buf_is_empty(&uart_rx_ring))
+        k_sem_give(&uart_wake); // Não coube tudo no slot: o resto vai no próximo
+
+    atomic_val_t lost = atomic_clear(&uart_rx_overruns);
+    if(lost > 0)
+        LOG_WRN("UART RX: %d blocos perdidos (fila cheia)", (int) lost);
+    return 0;
+}
+
+static void hub_uart_kick(void)
+{
+    k_sem_give(&uart_wake);
+}
+
+const hub_transport_t hub_transport = {
+    .name = "UART",
+    .master_clocked = false,
+    .init = hub_uart_init,
+    .exchange = hub_uart_exchange,
+    .kick = hub_uart_kick,
+    .attention = NULL,
+    .frame_ok = NULL,
+};
@@ -1,9 +1,11 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <string.h>
 #include "sensor_data.h"
 #include "encoder.h"
 #include "motor_driver.h"
 #include "hub.h"
+#include "logic_engine.h"
 
 LOG_MODULE_REGISTER(logic_engine, LOG_LEVEL_INF);
 
@@ -25,6 +27,74 @@ static pump_status_t global_status = {.current_state = STATE_IDLE,
 
 static bool test_mode_warned = false;
 
+/* --- LATÊNCIA POR COMANDO ---
+ * Acumulado em ciclos na thread da Logic Engine; convertido para us só na leitura.
+ * A leitura vem do hub (outra thread), por isso o spinlock.
+ */
+#define LATENCY_NUM_CMDS (CMD_CLEAR_ALARM + 1)
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint64_t decode_sum;
+    uint64_t queue_sum;
+    uint64_t fsm_sum;
+} latency_acc_t;
+
+static latency_acc_t latency_acc[LATENCY_NUM_CMDS];
+static struct k_spinlock latency_lock;
+
+static void latency_record(const pump_cmd_t* cmd, uint32_t t_fsm, uint32_t t_act)
+{
+    if((unsigned) cmd->id >= LATENCY_NUM_CMDS || cmd->t_rx == 0)
+        return;
+
+    // Subtração em uint32_t: correta mesmo com o contador de ciclos dando a volta
+    uint32_t total = t_act - cmd->t_rx;
+
+    k_spinlock_key_t key = k_spin_lock(&latency_lock);
+    latency_acc_t* acc = &latency_acc[cmd->id];
+    if(acc->count == 0 || total < acc->min)
+        acc->min = total;
+    if(total > acc->max)
+        acc->max = total;
+    acc->count++;
+    acc->sum += total;
+    acc->decode_sum += (uint32_t) (cmd->t_decoded - cmd->t_rx);
+    acc->queue_sum += (uint32_t) (t_fsm - cmd->t_decoded);
+    acc->fsm_sum += (uint32_t) (t_act - t_fsm);
+    k_spin_unlock(&latency_lock, key);
+}
+
+static uint32_t cyc_avg_us(uint64_t sum, uint32_t count)
+{
+    return count ? k_cyc_to_us_floor32((uint32_t) (sum / count)) : 0;
+}
+
+bool logic_get_latency(command_id_t id, pump_latency_t* out, bool reset)
+{
+    if((unsigned) id >= LATENCY_NUM_CMDS)
+        return false;
+
+    k_spinlock_key_t key = k_spin_lock(&latency_lock);
+    latency_acc_t acc = latency_acc[id];
+    if(reset)
+        memset(&latency_acc[id], 0, sizeof(latency_acc[id]));
+    k_spin_unlock(&latency_lock, key);
+
+    out->count = acc.count;
+    out->min_us = k_cyc_to_us_floor32(acc.min);
+    out->max_us = k_cyc_to_us_floor32(acc.max);
+    out->avg_us = cyc_avg_us(acc.sum, acc.count);
+    out->decode_avg_us = cyc_avg_us(acc.decode_sum, acc.count);
+    out->queue_avg_us = cyc_avg_us(acc.queue_sum, acc.count);
+    out->fsm_avg_us = cyc_avg_us(acc.fsm_sum, acc.count);
+    return true;
+}
+
 /* Adicione no topo do logic_engine.c */
 #define RATE_PURGE_DEFAULT 1200 // ml/h máxima
 #define RATE_BOLUS_DEFAULT 600  // ml/h padrão de bolus
@@ -94,6 +164,7 @@ void logic_thread_entry(void* p1, void* p2, void* p3)
         if(events[0].state == K_POLL_STATE_MSGQ_DATA_AVAILABLE)
         {
             k_msgq_get(&cmd_queue, &cmd, K_NO_WAIT);
+            uint32_t t_fsm = k_cycle_get_32();
 
             LOG_INF("CMD Proc: ID=%d Param=%d", cmd.id, (int) cmd.param);
 
@@ -174,6 +245,9 @@ void logic_thread_entry(void* p1, void* p2, void* p3)
             {
                 update_motor_hardware(&global_status);
             }
+
+            // Atuação concluída (ou comando só de configuração aplicado)
+            latency_record(&cmd, t_fsm, k_cycle_get_32());
         }
 
         /* --- 2. Processamento de Sensores Analógicos (Bolha/Oclusão) --- */
@@ -210,6 +284,9 @@ void logic_thread_entry(void* p1, void* p2, void* p3)
                 update_motor_hardware(&global_status);
             }
 
+            // Amostra segue para a telemetria assinada pelo Gateway (se houver)
+            hub_telemetry_sample(&sensor, &global_status);
+
             events[1].state = K_POLL_STATE_NOT_READY;
         }
 
@@ -246,7 +323,8 @@ void logic_thread_entry(void* p1, void* p2, void* p3)
         }
 
         /* --- 4. Atualizar o Hub SPI --- */
-        // Envia o estado atualizado para que o Hub possa responder ao próximo poll do Mestre
+        // Envia o estado atualizado para que o Hub possa responder ao próximo poll do Mestre.
+        // Sem mudança desde a última volta, o hub descarta sem tocar na geração.
         hub_set_status(&global_status);
     }
 }
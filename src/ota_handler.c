@@ -6,43 +6,734 @@
 #include <zephyr/sys/reboot.h>
 #include <zephyr/drivers/watchdog.h>
 #include <zephyr/storage/flash_map.h>
+#include <zephyr/app_version.h>
+#include <string.h>
+#include <errno.h>
 #include "ota_handler.h"
+#include "hub.h"
+#include "cmd.h"
+#include "utl_crc16.h"
+#include "utl_lz.h"
+#include "utl_delta.h"
+#include "utl_sha256.h"
+
+#if defined(CONFIG_RETENTION) && DT_NODE_EXISTS(DT_NODELABEL(ota_cursor))
+#include <zephyr/retention/retention.h>
+#define OTA_CURSOR_RETAINED 1
+#endif
 
 LOG_MODULE_REGISTER(ota_handler, LOG_LEVEL_INF);
 
-static struct flash_img_context ctx;
+// Memória da janela de recepção: com o chunk padrão (48) dá as 32 posições do mapa,
+// com o maior (245) dá 16
+#define OTA_WINDOW_BYTES 4096
+
+// Escritor de flash: abaixo do Hub e da Logic Engine, só grava quando eles estão parados
+// Pilha: utl_lz -> utl_delta -> flash_img -> SHA-256 do bloco relido, tudo na mesma cadeia
+#define OTA_WRITER_STACK_SIZE 1536
+#define OTA_WRITER_PRIORITY   8
+// Chunks entregues e ainda não gravados (o resto espera na janela)
+#define OTA_WRITE_QUEUE_LEN 8
+
+BUILD_ASSERT(!IS_ENABLED(CONFIG_IMG_ERASE_PROGRESSIVELY), "o START já apaga o slot antes de gravar");
+BUILD_ASSERT(CMD_OTA_SHA256_SIZE == UTL_SHA256_SIZE, "digest do OTA_END");
+
 static bool reboot_pending = false;
 
-void ota_start(uint32_t total_size)
+// --- JANELA DE RECEPÇÃO (thread do Hub) ---
+// ota_pos é o fim do que já foi entregue ao escritor, em ordem, e todo chunk é conferido
+// contra ela. Chunk que chega fica em win_buf, no slot (índice do chunk % ota_window);
+// win_present tem o bit i do chunk da posição + i. Os chunks a partir da posição vão para
+// a fila do escritor enquanto houver espaço; com a fila cheia eles esperam na janela.
+static uint8_t win_buf[OTA_WINDOW_BYTES];
+static uint32_t win_present;
+static uint16_t ota_chunk;  // Bytes por chunk, negociado no START
+static uint8_t ota_window;  // Chunks que cabem em win_buf (até CMD_OTA_WINDOW_CHUNKS)
+static uint32_t ota_total;
+static uint32_t ota_pos;
+static uint16_t ota_crc;    // CRC-16 de tudo o que já foi entregue ao escritor, em ordem
+static bool ota_active;
+// Erro de flash: só o escritor grava, e só ele zera (ao abrir o START/RESUME); o Hub só lê.
+// Com erro a imagem já não presta até o próximo START.
+static atomic_t ota_error = ATOMIC_INIT(0);
+
+BUILD_ASSERT(CMD_OTA_WINDOW_CHUNKS <= 32, "win_present/missing são de 32 bits");
+BUILD_ASSERT(OTA_WINDOW_BYTES >= 2 * CMD_OTA_CHUNK_DATA_MAX, "janela sem espaço para chunk adiantado");
+
+// --- CURSOR PERSISTIDO ---
+// Imagem em curso e quanto dela o flash_img já descarregou no flash (o que ainda estava no
+// buffer dele ou na fila se perde num reset). Fica na RAM retida do app.overlay, com
+// prefixo e checksum do subsistema de retenção: sobrevive a reset, não a falta de energia.
+// Depois do reset o conteúdo do slot é relido para refazer o CRC, então um cursor que não
+// bate com o flash só faz o mestre recomeçar do START.
+typedef struct
 {
-    LOG_INF("Iniciando OTA. Tamanho: %d bytes", total_size);
+    uint32_t total_size;
+    uint32_t written; // Bytes já no flash (ctx.stream.bytes_written)
+    uint16_t chunk_size;
+} ota_cursor_t;
 
-    flash_img_init(&ctx);
-    reboot_pending = false;
+#ifdef OTA_CURSOR_RETAINED
+static const struct device* const cursor_dev = DEVICE_DT_GET(DT_NODELABEL(ota_cursor));
+
+static void ota_cursor_save(const ota_cursor_t* cur)
+{
+    if(retention_write(cursor_dev, 0, (const uint8_t*) cur, sizeof(*cur)) < 0)
+        LOG_WRN("Cursor do OTA não persistido");
 }
-int ota_write_chunk(uint8_t* data, size_t len)
+
+static bool ota_cursor_load(ota_cursor_t* out)
 {
-    int ret = flash_img_buffered_write(&ctx, data, len, false);
+    return device_is_ready(cursor_dev) && retention_is_valid(cursor_dev) == 1 &&
+           retention_read(cursor_dev, 0, (uint8_t*) out, sizeof(*out)) == 0;
+}
+
+static void ota_cursor_clear(void)
+{
+    retention_clear(cursor_dev);
+}
+#else
+// Sem RAM retida (native_sim): o cursor só vale até o reset
+static void ota_cursor_save(const ota_cursor_t* cur)
+{
+}
+
+static bool ota_cursor_load(ota_cursor_t* out)
+{
+    return false;
+}
+
+static void ota_cursor_clear(void)
+{
+}
+#endif
+
+// --- FILA DO ESCRITOR ---
+// Toda operação de flash (apagar, gravar, fechar a imagem) roda na thread do escritor; o
+// Hub só enfileira e continua atendendo o link, OTA_STATUS inclusive.
+typedef enum
+{
+    OTA_JOB_START,  // Novo slot: flash_img do zero, apaga o slot pelo tamanho da imagem (resposta em ota_done_ret)
+    OTA_JOB_RESUME, // Cursor válido depois de reset: flash_img na posição cur.written (SHA-256 até ela em data)
+    OTA_JOB_DATA,   // Próximos len bytes da imagem (ou do stream comprimido / patch)
+    OTA_JOB_FINISH, // Descarrega o resto, confere o digest em data (len 0 = sem) e agenda o swap
+                    // (resposta em ota_done_ret)
+    OTA_JOB_ABORT,  // START recusado: esquece a imagem anterior
+} ota_job_type_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint16_t len;
+    ota_cursor_t cur;
+    uint32_t image_size; // START: imagem descomprimida, 0 = chunks crus
+    uint8_t flags;       // START: CMD_OTA_FLAG_*
+    uint8_t data[CMD_OTA_CHUNK_DATA_MAX];
+} ota_job_t;
+
+// Além dos chunks (contados por ota_data_slots), cabem um START/RESUME ainda não lido e o
+// FINISH: o END enfileira sem esperar
+K_MSGQ_DEFINE(ota_write_q, sizeof(ota_job_t), OTA_WRITE_QUEUE_LEN + 2, 4);
+static K_SEM_DEFINE(ota_data_slots, OTA_WRITE_QUEUE_LEN, OTA_WRITE_QUEUE_LEN);
+
+// Pedido com resposta adiada (START e FINISH): o Hub marca ota_busy ao enfileirar, o
+// escritor publica o resultado em ota_done_ret e levanta ota_done, e o Hub recolhe os dois
+static bool ota_busy;
+static uint8_t ota_busy_job;
+static atomic_t ota_done = ATOMIC_INIT(0);
+static int ota_done_ret;
+
+// END com o resto da imagem ainda na janela e a fila cheia: o FINISH só vai quando tudo
+// tiver sido entregue. OTA_END_WAIT = esperando; OTA_END_KICK = o escritor abriu lugar na
+// fila e acordou o Hub para empurrar mais.
+enum
+{
+    OTA_END_IDLE,
+    OTA_END_WAIT,
+    OTA_END_KICK,
+};
+static atomic_t ota_end_state = ATOMIC_INIT(OTA_END_IDLE);
+static uint8_t ota_end_sha[UTL_SHA256_SIZE];
+static bool ota_end_has_sha;
+static uint16_t ota_end_crc;
+
+static ota_job_t job_tx; // Montado pelo Hub
+static ota_job_t job_rx; // Em execução no escritor
+
+static void ota_writer_entry(void* p1, void* p2, void* p3);
+K_THREAD_DEFINE(ota_writer_tid, OTA_WRITER_STACK_SIZE, ota_writer_entry, NULL, NULL, NULL, OTA_WRITER_PRIORITY, 0, 0);
+
+// --- ESCRITOR ---
+// Estado só da thread do escritor
+static struct flash_img_context ctx;
+static ota_cursor_t cursor;
+static uint32_t image_end; // Tamanho da imagem no slot1
+
+// Imagem comprimida ou delta: o stream passa pelo utl_lz e/ou pelo utl_delta (que lê a base
+// no slot0) e só a saída vai para o flash_img. O estado dos decodificadores (anel de
+// UTL_LZ_WINDOW bytes, registro do patch) não sobrevive a reset: sem cursor.
+static utl_lz_dec_t lz;
+static utl_delta_dec_t delta;
+static const struct flash_area* base_fa;
+static uint8_t ota_flags; // CMD_OTA_FLAG_* da imagem em curso
+
+// SHA-256 da imagem no slot1: cada bloco que o stream_flash descarrega é relido do flash
+// para o callback dele, e o hash é desse conteúdo. Sai junto com a gravação, sem passada
+// de leitura no fim, e pega também byte que o flash não gravou certo.
+static utl_sha256_t sha;
+static uint8_t sha_digest[UTL_SHA256_SIZE];
+
+BUILD_ASSERT(sizeof(utl_sha256_t) <= CMD_OTA_CHUNK_DATA_MAX, "o RESUME leva o hash em ota_job_t.data");
+
+// Apaga a página que contém 'off' e devolve o fim dela
+static int ota_erase_page(uint32_t off, uint32_t* end)
+{
+    struct flash_pages_info page;
+
+    int ret = flash_get_page_info_by_offs(ctx.stream.fdev, ctx.stream.offset + off, &page);
+    if(ret == 0)
+        ret = flash_area_erase(ctx.flash_area, page.start_offset - ctx.stream.offset, page.size);
     if(ret < 0)
-        LOG_ERR("Erro gravando flash: %d", ret);
+    {
+        LOG_ERR("Erro apagando o slot em %u: %d", off, ret);
+        return ret;
+    }
+    *end = page.start_offset - ctx.stream.offset + page.size;
+    return 0;
+}
+
+// Sem erase progressivo, o START deixa o slot pronto: as páginas da imagem e a do trailer
+// do MCUboot (se a imagem não chegou nela). No F411 o slot1 é um setor só de 128 KiB, um
+// erase de 1 a 2 s que para a CPU inteira (o código roda do mesmo banco de flash): não dá
+// para intercalar com os chunks, e o START só é respondido depois dele.
+static int ota_erase_slot(void)
+{
+    uint32_t end = 0;
+    int ret = 0;
+
+    while(ret == 0 && end < image_end)
+        ret = ota_erase_page(end, &end);
+    if(ret == 0 && end < ctx.flash_area->fa_size)
+        ret = ota_erase_page(ctx.flash_area->fa_size - 1, &end);
     return ret;
 }
 
-void ota_finish(void)
+static int ota_flash_write(const uint8_t* data, size_t len)
+{
+    int ret = flash_img_buffered_write(&ctx, data, len, false);
+    if(ret < 0)
+    {
+        LOG_ERR("Erro gravando flash em %u: %d", (uint32_t) ctx.stream.bytes_written, ret);
+        atomic_set(&ota_error, ret);
+        return ret;
+    }
+
+    // O flash_img descarrega um bloco inteiro por vez: o cursor anda junto
+    if(ota_flags == 0 && ctx.stream.bytes_written != cursor.written)
+    {
+        cursor.written = ctx.stream.bytes_written;
+        ota_cursor_save(&cursor);
+    }
+    return 0;
+}
+
+static int ota_sha_block(uint8_t* buf, size_t len, size_t offset)
+{
+    utl_sha256_update(&sha, buf, len);
+    return 0;
+}
+
+static int ota_delta_sink(void* arg, const uint8_t* data, size_t len)
 {
-    flash_img_buffered_write(&ctx, NULL, 0, true);
+    return ota_flash_write(data, len);
+}
 
-    LOG_INF("Download completo. Verificando e Agendando Swap...");
+static int ota_base_read(void* arg, uint32_t offset, uint8_t* buf, size_t len)
+{
+    return flash_area_read(base_fa, offset, buf, len);
+}
+
+// Saída do utl_lz (ou o próprio stream): patch para o utl_delta, ou a imagem
+static int ota_lz_sink(void* arg, const uint8_t* data, size_t len)
+{
+    if(ota_flags & CMD_OTA_FLAG_DELTA)
+        return utl_delta_dec_feed(&delta, data, len);
+    return ota_flash_write(data, len);
+}
 
-    if(boot_request_upgrade(BOOT_UPGRADE_TEST) == 0)
+static void ota_stream_feed(const uint8_t* data, size_t len)
+{
+    int ret = (ota_flags & CMD_OTA_FLAG_LZ) ? utl_lz_dec_feed(&lz, data, len) : ota_lz_sink(NULL, data, len);
+    if(ret == -ENOEXEC)
     {
-        LOG_INF("Update agendado com sucesso!");
-        reboot_pending = true;
+        LOG_ERR("Patch para outra base: pede v%u.%u.%u, slot0 tem v" APP_VERSION_STRING " (ou CRC diferente)",
+                delta.hdr_version >> 16, (delta.hdr_version >> 8) & 0xFF, delta.hdr_version & 0xFF);
+    }
+    else if(ret < 0 && atomic_get(&ota_error) == 0)
+    {
+        LOG_ERR("Stream %s inválido em %u: %d", (ota_flags & CMD_OTA_FLAG_DELTA) ? "delta" : "comprimido",
+                (uint32_t) ctx.stream.bytes_written, ret);
     }
+    if(ret < 0 && atomic_get(&ota_error) == 0)
+        atomic_set(&ota_error, ret);
+}
+
+// START e RESUME: flash_img no começo do slot (apagado) ou na posição do cursor (o que o
+// stream_flash_progress_load faz quando há settings). 'prefix' = SHA-256 do que o cursor já
+// tem no slot (RESUME), ou NULL.
+static void ota_job_open(const ota_cursor_t* cur, uint32_t image_size, uint8_t flags, const uint8_t* prefix)
+{
+    bool resume = prefix != NULL;
+    atomic_set(&ota_error, 0);
+    int ret = flash_img_init(&ctx);
+    if(ret < 0)
+    {
+        LOG_ERR("flash_img_init: %d", ret);
+        atomic_set(&ota_error, ret);
+        return;
+    }
+    ctx.stream.callback = ota_sha_block;
+    if(resume)
+        memcpy(&sha, prefix, sizeof(sha));
     else
+        utl_sha256_init(&sha);
+    cursor = *cur;
+    image_end = (image_size != 0) ? image_size : cur->total_size;
+    ota_flags = flags;
+    if(flags & CMD_OTA_FLAG_DELTA)
+    {
+        ret = flash_area_open(FIXED_PARTITION_ID(slot0_partition), &base_fa);
+        if(ret < 0)
+        {
+            LOG_ERR("slot0 (base do patch): %d", ret);
+            atomic_set(&ota_error, ret);
+            return;
+        }
+        utl_delta_dec_init(&delta, image_size, APP_VERSION_NUMBER, FIXED_PARTITION_SIZE(slot0_partition),
+                           ota_base_read, ota_delta_sink, NULL);
+    }
+    // O tamanho do patch não vem no START: no delta comprimido quem sabe onde acaba é o utl_delta
+    if(flags & CMD_OTA_FLAG_LZ)
+        utl_lz_dec_init(&lz, (flags & CMD_OTA_FLAG_DELTA) ? UINT32_MAX : image_size, ota_lz_sink, NULL);
+
+    if(resume)
+    {
+        // O cursor só existe com o slot já apagado pelo START
+        ctx.stream.bytes_written = cur->written;
+        return;
+    }
+
+    ota_cursor_clear();
+    ret = ota_erase_slot();
+    if(ret < 0)
+        atomic_set(&ota_error, ret);
+    else if(flags == 0)
+        ota_cursor_save(&cursor);
+}
+
+// Depois do último bloco: o hash está completo. 'expected' NULL = END sem digest.
+static int ota_check_digest(const uint8_t* expected)
+{
+    utl_sha256_final(&sha, sha_digest);
+    if(expected == NULL)
+    {
+        LOG_WRN("END sem digest: imagem não conferida antes do swap");
+        return 0;
+    }
+    if(memcmp(sha_digest, expected, sizeof(sha_digest)) != 0)
+    {
+        LOG_ERR("SHA-256 da imagem gravada não bate com o do END: swap não agendado");
+        return -EILSEQ;
+    }
+    return 0;
+}
+
+static int ota_job_finish(const uint8_t* expected)
+{
+    int ret = atomic_get(&ota_error);
+    if(ret != 0)
+        return ret;
+    if(((ota_flags & CMD_OTA_FLAG_DELTA) && !utl_delta_dec_done(&delta)) ||
+       (ota_flags == CMD_OTA_FLAG_LZ && !utl_lz_dec_done(&lz)))
+    {
+        LOG_ERR("Stream acabou com %u de %u bytes da imagem",
+                (uint32_t) (ctx.stream.bytes_written + ctx.stream.buf_bytes), image_end);
+        return -EBADMSG;
+    }
+
+    ota_cursor_clear();
+    ret = flash_img_buffered_write(&ctx, NULL, 0, true);
+    if(ret < 0)
+    {
+        LOG_ERR("Erro gravando o fim da imagem: %d", ret);
+        return ret;
+    }
+    ret = ota_check_digest(expected);
+    if(ret < 0)
+        return ret;
+
+    LOG_INF("Download completo (CRC16 0x%04X). Verificando e Agendando Swap...", utl_crc16_final(ota_crc));
+
+    if(boot_request_upgrade(BOOT_UPGRADE_TEST) != 0)
     {
         LOG_ERR("Falha ao agendar update!");
+        return -EIO;
     }
+    LOG_INF("Update agendado com sucesso!");
+    return 0;
+}
+
+static void ota_writer_entry(void* p1, void* p2, void* p3)
+{
+    for(;;)
+    {
+        k_msgq_get(&ota_write_q, &job_rx, K_FOREVER);
+
+        switch(job_rx.type)
+        {
+        case OTA_JOB_START:
+            ota_job_open(&job_rx.cur, job_rx.image_size, job_rx.flags, NULL);
+            ota_done_ret = atomic_get(&ota_error);
+            atomic_set(&ota_done, 1);
+            hub_wake();
+            break;
+        case OTA_JOB_RESUME:
+            ota_job_open(&job_rx.cur, job_rx.image_size, job_rx.flags, job_rx.data);
+            break;
+        case OTA_JOB_DATA:
+            k_sem_give(&ota_data_slots);
+            if(atomic_cas(&ota_end_state, OTA_END_WAIT, OTA_END_KICK))
+                hub_wake();
+            if(atomic_get(&ota_error) != 0)
+                break;
+            if(ota_flags != 0)
+                ota_stream_feed(job_rx.data, job_rx.len);
+            else
+                ota_flash_write(job_rx.data, job_rx.len);
+            break;
+        case OTA_JOB_FINISH:
+            ota_done_ret = ota_job_finish((job_rx.len != 0) ? job_rx.data : NULL);
+            atomic_set(&ota_done, 1);
+            hub_wake();
+            break;
+        case OTA_JOB_ABORT:
+            ota_cursor_clear();
+            break;
+        }
+    }
+}
+
+// --- HUB ---
+static inline size_t ota_chunk_len(uint32_t offset)
+{
+    return MIN(ota_chunk, ota_total - offset);
+}
+
+// Sessão nova: valida os parâmetros e zera janela, posição e CRC (o erro é zerado pelo
+// escritor, quando ele pega o START)
+static int ota_session_init(uint32_t total_size, uint16_t chunk_size, uint32_t image_size, uint8_t flags)
+{
+    ota_active = false;
+    if(chunk_size == 0 || chunk_size > CMD_OTA_CHUNK_DATA_MAX || total_size == 0 ||
+       ((image_size != 0) ? image_size : total_size) > FIXED_PARTITION_SIZE(slot1_partition) ||
+       (flags & ~(CMD_OTA_FLAG_LZ | CMD_OTA_FLAG_DELTA)) != 0 || (image_size != 0) != (flags != 0))
+        return -EINVAL;
+
+    reboot_pending = false;
+    win_present = 0;
+    ota_chunk = chunk_size;
+    ota_window = MIN(CMD_OTA_WINDOW_CHUNKS, OTA_WINDOW_BYTES / chunk_size);
+    ota_total = total_size;
+    ota_pos = 0;
+    ota_crc = utl_crc16_init();
+    ota_active = true;
+    return 0;
+}
+
+// Erro de flash da sessão em curso: com o START ainda na fila, ota_error é da anterior
+static int ota_session_error(void)
+{
+    return (ota_busy && ota_busy_job == OTA_JOB_START) ? 0 : (int) atomic_get(&ota_error);
+}
+
+// Troca o que a fila tem por um único job de controle (a fila acabou de esvaziar: cabe)
+static void ota_job_send(ota_job_type_t type, const ota_cursor_t* cur, uint32_t image_size, uint8_t flags)
+{
+    k_msgq_purge(&ota_write_q);
+    k_sem_init(&ota_data_slots, OTA_WRITE_QUEUE_LEN, OTA_WRITE_QUEUE_LEN);
+    job_tx.type = type;
+    job_tx.len = 0;
+    job_tx.image_size = image_size;
+    job_tx.flags = flags;
+    if(cur != NULL)
+        job_tx.cur = *cur;
+    k_msgq_put(&ota_write_q, &job_tx, K_NO_WAIT);
+}
+
+// Passa ao escritor, em ordem, os chunks da janela a partir da posição, até a fila encher.
+// Depois de retomar, a posição pode cair no meio de um chunk: só vai o resto dele.
+static void ota_drain(void)
+{
+    while(win_present & 1)
+    {
+        uint32_t idx = ota_pos / ota_chunk;
+        uint32_t skip = ota_pos - idx * ota_chunk;
+        uint32_t slot = idx % ota_window;
+
+        job_tx.type = OTA_JOB_DATA;
+        job_tx.len = ota_chunk_len(idx * ota_chunk) - skip;
+        memcpy(job_tx.data, &win_buf[slot * ota_chunk + skip], job_tx.len);
+        if(k_sem_take(&ota_data_slots, K_NO_WAIT) != 0)
+            return;
+        k_msgq_put(&ota_write_q, &job_tx, K_NO_WAIT);
+
+        ota_crc = utl_crc16_update(ota_crc, job_tx.data, job_tx.len);
+        ota_pos += job_tx.len;
+        win_present >>= 1;
+    }
+}
+
+// Chunks ainda não entregues ao escritor, a partir do que contém a posição
+static uint32_t ota_chunks_left(void)
+{
+    return (ota_pos < ota_total) ? DIV_ROUND_UP(ota_total, ota_chunk) - ota_pos / ota_chunk : 0;
+}
+
+static uint32_t ota_window_mask(uint32_t chunks)
+{
+    return (chunks >= 32) ? UINT32_MAX : (BIT(chunks) - 1);
+}
+
+// END esperando a janela: empurra o que a fila aceita e, com a imagem toda entregue,
+// confere o CRC do stream e manda o FINISH. 0 = FINISH na fila ou ainda esperando.
+static int ota_end_push(void)
+{
+    int ret = (int) atomic_get(&ota_error);
+    if(ret != 0)
+        return ret;
+
+    ota_drain();
+    if(ota_pos != ota_total)
+        return 0;
+    atomic_set(&ota_end_state, OTA_END_IDLE);
+
+    if(ota_end_has_sha && ota_end_crc != utl_crc16_final(ota_crc))
+    {
+        LOG_ERR("CRC16 do stream 0x%04X, o END diz 0x%04X", utl_crc16_final(ota_crc), ota_end_crc);
+        return -EILSEQ;
+    }
+
+    // O resto da fila, o último bloco e o hash ficam com o escritor; o Hub segue atendendo
+    job_tx.type = OTA_JOB_FINISH;
+    job_tx.len = ota_end_has_sha ? UTL_SHA256_SIZE : 0;
+    memcpy(job_tx.data, ota_end_sha, job_tx.len);
+    return (k_msgq_put(&ota_write_q, &job_tx, K_NO_WAIT) != 0) ? -ENOSPC : 0;
+}
+
+// Refaz o CRC e o SHA-256 do que o cursor diz que já está no slot
+static int ota_prefix_from_flash(uint32_t len, uint16_t* crc, utl_sha256_t* hash)
+{
+    const struct flash_area* fa;
+    uint8_t buf[256];
+
+    int ret = flash_area_open(FIXED_PARTITION_ID(slot1_partition), &fa);
+    if(ret < 0)
+        return ret;
+
+    *crc = utl_crc16_init();
+    utl_sha256_init(hash);
+    for(uint32_t off = 0; off < len && ret == 0; off += sizeof(buf))
+    {
+        size_t n = MIN(sizeof(buf), len - off);
+        ret = flash_area_read(fa, off, buf, n);
+        *crc = utl_crc16_update(*crc, buf, n);
+        utl_sha256_update(hash, buf, n);
+    }
+    flash_area_close(fa);
+    return ret;
+}
+
+void ota_init(void)
+{
+    ota_cursor_t cur;
+    uint16_t crc;
+    utl_sha256_t prefix;
+
+    if(!ota_cursor_load(&cur))
+        return;
+
+    int ret = (cur.written > cur.total_size) ? -EINVAL : ota_session_init(cur.total_size, cur.chunk_size, 0, 0);
+    if(ret == 0)
+        ret = ota_prefix_from_flash(cur.written, &crc, &prefix);
+    if(ret < 0)
+    {
+        LOG_WRN("Cursor do OTA inválido (%d), descartado", ret);
+        ota_active = false;
+        ota_cursor_clear();
+        return;
+    }
+
+    ota_pos = cur.written;
+    ota_crc = crc;
+    memcpy(job_tx.data, &prefix, sizeof(prefix));
+    ota_job_send(OTA_JOB_RESUME, &cur, 0, 0);
+    LOG_INF("OTA retomado: %u de %u bytes, CRC16 0x%04X", cur.written, cur.total_size, utl_crc16_final(crc));
+}
+
+int ota_start(uint32_t total_size, uint16_t chunk_size, uint32_t image_size, uint8_t flags)
+{
+    if(ota_busy)
+        return -EBUSY;
+    if(chunk_size == 0)
+        chunk_size = CMD_OTA_CHUNK_SIZE_DEFAULT;
+
+    if(image_size != 0)
+    {
+        const char* mode = (flags == CMD_OTA_FLAG_LZ)      ? "comprimido"
+                           : (flags == CMD_OTA_FLAG_DELTA) ? "delta"
+                                                           : "delta comprimido";
+        LOG_INF("Iniciando OTA %s. %d bytes -> imagem de %d, chunks de %d", mode, total_size, image_size, chunk_size);
+    }
+    else
+    {
+        LOG_INF("Iniciando OTA. Tamanho: %d bytes, chunks de %d", total_size, chunk_size);
+    }
+
+    int ret = ota_session_init(total_size, chunk_size, image_size, flags);
+    if(ret < 0)
+    {
+        LOG_ERR("OTA recusado: %d", ret);
+        ota_job_send(OTA_JOB_ABORT, NULL, 0, 0);
+        return ret;
+    }
+
+    // O escritor apaga o slot; a resposta do START sai quando ele acaba
+    ota_cursor_t cur = {.total_size = total_size, .written = 0, .chunk_size = chunk_size};
+    ota_job_send(OTA_JOB_START, &cur, image_size, flags);
+    ota_busy = true;
+    ota_busy_job = OTA_JOB_START;
+    return OTA_PENDING;
+}
+
+int ota_write_chunk(uint32_t offset, const uint8_t* data, size_t len)
+{
+    if(!ota_active)
+        return -EPERM;
+    int ret = ota_session_error();
+    if(ret != 0)
+        return ret;
+
+    // Todo chunk é cheio e alinhado, menos o último da imagem
+    if(offset % ota_chunk != 0 || offset >= ota_total || len != ota_chunk_len(offset))
+        return -EINVAL;
+
+    // Já entregue: retransmissão de algo que o mestre ainda não sabia que chegou
+    if(offset + len <= ota_pos)
+        return 0;
+
+    // Janela em chunks a partir do que contém a posição
+    uint32_t rel = offset / ota_chunk - ota_pos / ota_chunk;
+    if(rel >= ota_window)
+        return -ENOSPC;
+
+    if(!(win_present & BIT(rel)))
+    {
+        uint32_t slot = (offset / ota_chunk) % ota_window;
+        memcpy(&win_buf[slot * ota_chunk], data, len);
+        win_present |= BIT(rel);
+    }
+    ota_drain();
+    return 0;
+}
+
+int ota_get_status(ota_status_t* st)
+{
+    memset(st, 0, sizeof(*st));
+    if(!ota_active)
+        return -EPERM;
+
+    // A fila pode ter andado desde o último chunk
+    ota_drain();
+
+    // Só conta chunks que existem na imagem e cabem na janela
+    uint32_t mask = ota_window_mask(MIN(ota_chunks_left(), ota_window));
+
+    st->next_offset = ota_pos;
+    st->missing = ~win_present & mask;
+    st->total_size = ota_total;
+    st->chunk_size = ota_chunk;
+    st->image_crc = utl_crc16_final(ota_crc);
+    return ota_busy ? -EBUSY : ota_session_error();
+}
+
+int ota_finish(const uint8_t* sha256, uint16_t image_crc)
+{
+    if(ota_busy)
+        return (ota_busy_job == OTA_JOB_FINISH) ? -EINPROGRESS : -EBUSY;
+    if(!ota_active)
+        return -EPERM;
+    int ret = ota_session_error();
+    if(ret != 0)
+        return ret;
+
+    // Chunks já confirmados podem estar na janela com a fila cheia (o mestre passo a passo
+    // manda o END logo depois do último ACK, sem OTA_STATUS). Se o resto todo está lá, o END
+    // fica pendente e vai sendo entregue a cada lugar que o escritor abre (ota_take_result).
+    ota_drain();
+    uint32_t left = ota_chunks_left();
+    if(left > ota_window || (win_present & ota_window_mask(left)) != ota_window_mask(left))
+    {
+        LOG_ERR("END com a imagem incompleta: %u de %u bytes", ota_pos, ota_total);
+        return -EAGAIN;
+    }
+
+    ota_end_has_sha = (sha256 != NULL);
+    ota_end_crc = image_crc;
+    if(sha256 != NULL)
+        memcpy(ota_end_sha, sha256, UTL_SHA256_SIZE);
+    atomic_set(&ota_end_state, OTA_END_WAIT);
+    ret = ota_end_push();
+    if(ret < 0)
+    {
+        atomic_set(&ota_end_state, OTA_END_IDLE);
+        return ret;
+    }
+    ota_busy = true;
+    ota_busy_job = OTA_JOB_FINISH;
+    return OTA_PENDING;
+}
+
+bool ota_take_result(int* ret)
+{
+    if(!ota_busy)
+        return false;
+    if(atomic_get(&ota_end_state) != OTA_END_IDLE)
+    {
+        // Antes do empurrão: lugar aberto durante ele acorda o Hub de novo
+        atomic_set(&ota_end_state, OTA_END_WAIT);
+        int err = ota_end_push();
+        if(err == 0)
+            return false;
+        atomic_set(&ota_end_state, OTA_END_IDLE);
+        ota_done_ret = err;
+        atomic_set(&ota_done, 1);
+    }
+    if(!atomic_get(&ota_done))
+        return false;
+
+    atomic_clear(&ota_done);
+    ota_busy = false;
+    *ret = ota_done_ret;
+    if(ota_busy_job == OTA_JOB_FINISH || *ret != 0)
+        ota_active = false;
+    if(ota_busy_job == OTA_JOB_FINISH && *ret == 0)
+        reboot_pending = true;
+    return true;
+}
+
+bool ota_result_ready(void)
+{
+    return atomic_get(&ota_done) != 0 || atomic_get(&ota_end_state) == OTA_END_KICK;
 }
 
 void ota_check_and_reboot(void)
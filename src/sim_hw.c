@@ -0,0 +1,135 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "adc_driver.h"
+#include "encoder.h"
+#include "motor_driver.h"
+
+LOG_MODULE_REGISTER(sim_hw, LOG_LEVEL_INF);
+
+// --- HARDWARE SIMULADO (native_sim) ---
+// Substitui adc_driver.c, encoder.c e motor_driver.c quando o firmware roda no Linux:
+// o Hub, a Logic Engine e o OTA são os mesmos do alvo. O motor integra passos no tempo
+// e o encoder lê essa posição; o ADC gera valores estáveis com um pouco de ruído.
+
+#define STEPS_PER_REV      200.0f
+#define MICROSTEPPING      16.0f
+#define LEAD_SCREW_PITCH   2.0f
+#define TOTAL_STEPS_PER_MM ((STEPS_PER_REV * MICROSTEPPING) / LEAD_SCREW_PITCH)
+
+K_MSGQ_DEFINE(sensor_data_q, sizeof(sensor_packet_t), 10, 4);
+
+static struct k_spinlock sim_lock;
+static uint32_t motor_hz;        // 0 = parado
+static int64_t motor_t0;         // k_uptime_get() da última integração
+static uint64_t motor_steps;     // Passos dados desde o boot
+static int32_t last_angle;
+
+// Acumula os passos dados desde a última chamada (chamar com sim_lock)
+static void sim_motor_integrate(void)
+{
+    int64_t now = k_uptime_get();
+    motor_steps += (uint64_t) motor_hz * (uint64_t) (now - motor_t0) / 1000u;
+    motor_t0 = now;
+}
+
+int motor_init(void)
+{
+    motor_t0 = k_uptime_get();
+    return 0;
+}
+
+void motor_enable(bool enable)
+{
+    if(!enable)
+        motor_stop();
+}
+
+void motor_stop(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&sim_lock);
+    sim_motor_integrate();
+    motor_hz = 0;
+    k_spin_unlock(&sim_lock, key);
+}
+
+void motor_run(uint32_t flow_rate_ml_h, uint8_t syringe_diameter)
+{
+    if(flow_rate_ml_h == 0 || syringe_diameter == 0)
+    {
+        motor_stop();
+        return;
+    }
+
+    // Mesma conta do motor_driver.c: vazão -> velocidade linear -> frequência de passo
+    float radius_cm = (float) syringe_diameter / 20.0f;
+    float area_cm2 = 3.14159f * radius_cm * radius_cm;
+    float speed_mm_s = ((float) flow_rate_ml_h / area_cm2 * 10.0f) / 3600.0f;
+    uint32_t hz = (uint32_t) (speed_mm_s * TOTAL_STEPS_PER_MM);
+
+    k_spinlock_key_t key = k_spin_lock(&sim_lock);
+    sim_motor_integrate();
+    motor_hz = hz < 1 ? 1 : hz;
+    k_spin_unlock(&sim_lock, key);
+}
+
+int encoder_init(void)
+{
+    last_angle = encoder_get_angle();
+    LOG_INF("Encoder simulado.");
+    return 0;
+}
+
+int32_t encoder_get_angle(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&sim_lock);
+    sim_motor_integrate();
+    uint64_t steps = motor_steps;
+    k_spin_unlock(&sim_lock, key);
+
+    return (int32_t) ((steps % (uint64_t) (STEPS_PER_REV * MICROSTEPPING)) * 360u /
+                      (uint64_t) (STEPS_PER_REV * MICROSTEPPING));
+}
+
+int32_t encoder_get_delta(void)
+{
+    int32_t current_angle = encoder_get_angle();
+    int32_t delta = current_angle - last_angle;
+
+    // Mesmo wrap-around do encoder.c
+    if(delta < -180)
+        delta += 360;
+    else if(delta > 180)
+        delta -= 360;
+
+    last_angle = current_angle;
+    return delta;
+}
+
+int adc_driver_init(void)
+{
+    return 0;
+}
+
+void adc_thread_entry(void* p1, void* p2, void* p3)
+{
+    sensor_packet_t packet;
+    uint32_t noise = 1;
+
+    LOG_INF("ADC simulado.");
+
+    while(1)
+    {
+        noise = noise * 1103515245u + 12345u; // LCG: ruído de poucos mV, reprodutível
+        int32_t jitter = (int32_t) ((noise >> 16) % 9) - 4;
+
+        packet.bolha_mv = 3000 + jitter;
+        packet.oclusao_mv = 120 + jitter / 2;
+        packet.volume_pot_mv = 1650;
+        packet.timestamp = k_uptime_get_32();
+
+        k_msgq_put(&sensor_data_q, &packet, K_NO_WAIT);
+        k_sleep(K_MSEC(10));
+    }
+}
+
+K_THREAD_DEFINE(adc_tid, 1024, adc_thread_entry, NULL, NULL, NULL, 2, 0, 0);
@@ -0,0 +1,330 @@
+/* cmd_codec.hpp - Codec de frames header-only para o lado Host (C++17, sem alocação)
+ *
+ * Layout e tamanhos saem em tempo de compilação da mesma CMD_TABLE do firmware (cmd.h):
+ * Cmd<ID>::type é o membro de cmd_cmds_t, min_payload/max_payload são as colunas da
+ * tabela. As structs de payload são packed e na ordem do fio, então o payload é a
+ * própria memória da struct (little endian): encode/decode viram header + memcpy + CRC.
+ * Nos comandos de tamanho variável (OTA_CHUNK e TLM_DATA) o fio é o prefixo fixo
+ * seguido de 'len'/'records_len' bytes, contíguos na struct; no OTA_START o chunk_size
+ * só vai quando != 0, e o image_size (com as flags, se não são só LZ) na comprimida ou delta;
+ * no OTA_END o CRC e o SHA-256 só vão quando o digest não é zero.
+ * Os static_assert abaixo quebram o build se uma struct sair de sincronia com a tabela.
+ *
+ * Só depende de cmd.h (nada para linkar): o CRC-16/CCITT tem tabelas constexpr próprias.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+extern "C" {
+    #include "cmd.h"
+}
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "cmd_codec.hpp: payload = memória da struct (host LE)");
+
+namespace cmdc {
+
+// Bytes do chamador: o codec nunca aloca nem copia para buffers próprios
+struct Span {
+    uint8_t *data;
+    size_t size;
+};
+
+struct ConstSpan {
+    const uint8_t *data;
+    size_t size;
+
+    ConstSpan(const uint8_t *d, size_t n) : data(d), size(n) {}
+    ConstSpan(Span s) : data(s.data), size(s.size) {}
+};
+
+// --- CRC-16/CCITT (poly 0x1021, init 0xFFFF), igual ao utl_crc16 ---
+// crc_slices[k][v] = CRC de v seguido de k bytes zero (slicing-by-8, como o firmware com
+// UTL_CRC16_SLICES = 8); crc_slices[0] é a tabela byte a byte.
+constexpr std::array<std::array<uint16_t, 256>, 8> make_crc_slices()
+{
+    std::array<std::array<uint16_t, 256>, 8> t{};
+    for (unsigned i = 0; i < 256; i++) {
+        uint16_t c = (uint16_t)(i << 8);
+        for (int b = 0; b < 8; b++)
+            c = (uint16_t)((c & 0x8000) ? (c << 1) ^ 0x1021 : (c << 1));
+        t[0][i] = c;
+    }
+    for (unsigned k = 1; k < 8; k++)
+        for (unsigned i = 0; i < 256; i++)
+            t[k][i] = (uint16_t)((t[k - 1][i] << 8) ^ t[0][t[k - 1][i] >> 8]);
+    return t;
+}
+
+inline constexpr std::array<std::array<uint16_t, 256>, 8> crc_slices = make_crc_slices();
+
+// Byte a byte: para tempo de compilação
+constexpr uint16_t crc16_bytes(const uint8_t *p, size_t n, uint16_t crc = 0xFFFF)
+{
+    while (n--)
+        crc = (uint16_t)((crc << 8) ^ crc_slices[0][((crc >> 8) ^ *p++) & 0xFF]);
+    return crc;
+}
+
+inline constexpr uint8_t crc_check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+static_assert(crc16_bytes(crc_check, sizeof(crc_check)) == 0x29B1, "CRC-16/CCITT-FALSE");
+
+// Runtime: 8 bytes por volta, o resto byte a byte
+inline uint16_t crc16(const uint8_t *p, size_t n, uint16_t crc = 0xFFFF)
+{
+    const auto &t = crc_slices;
+    for (; n >= 8; p += 8, n -= 8)
+        crc = t[7][(crc >> 8) ^ p[0]] ^ t[6][(crc & 0xFF) ^ p[1]] ^ t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]] ^
+              t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    return crc16_bytes(p, n, crc);
+}
+
+// --- LAYOUT POR COMANDO (gerado da CMD_TABLE) ---
+template <cmd_ids_t Id>
+struct Cmd;
+
+#define CMDC_TRAITS(name_, id_, member, min, max, enc, dec, hub)                                \
+    template <>                                                                                \
+    struct Cmd<CMD_##name_##_ID> {                                                             \
+        using type = decltype(cmd_cmds_t::member);                                             \
+        static constexpr cmd_ids_t id = CMD_##name_##_ID;                                      \
+        static constexpr const char *name = #name_;                                            \
+        static constexpr size_t min_payload = (min);                                           \
+        static constexpr size_t max_payload = (max);                                           \
+        static constexpr size_t max_frame = CMD_HDR_SIZE + (max) + CMD_TRAILER_SIZE;           \
+        static constexpr bool variable = (min) != (max);                                       \
+    };
+CMD_TABLE(CMDC_TRAITS)
+#undef CMDC_TRAITS
+
+// Faixa de tamanho por ID, para validar frames cujo tipo só se sabe em runtime
+struct Limits {
+    bool known;
+    uint8_t min_payload;
+    uint8_t max_payload;
+};
+
+constexpr std::array<Limits, CMD_NUM_CMDS> make_limits()
+{
+    std::array<Limits, CMD_NUM_CMDS> l{};
+#define CMDC_LIMITS(name, id, member, min, max, enc, dec, hub) l[CMD_##name##_ID] = {true, (min), (max)};
+    CMD_TABLE(CMDC_LIMITS)
+#undef CMDC_LIMITS
+    return l;
+}
+
+inline constexpr std::array<Limits, CMD_NUM_CMDS> limits = make_limits();
+
+// Cauda variável: quantos bytes além de min_payload o valor leva no fio
+template <typename T>
+struct Tail {
+    static constexpr size_t size(const T &) { return 0; }
+    static bool set(T &, size_t n) { return n == 0; }
+};
+
+template <>
+struct Tail<cmd_ota_chunk_t> {
+    static constexpr size_t size(const cmd_ota_chunk_t &v) { return v.len; }
+    static bool set(cmd_ota_chunk_t &v, size_t n)
+    {
+        if (n > sizeof(v.data)) return false;
+        v.len = (uint8_t)n;
+        return true;
+    }
+};
+
+// OTA_START: chunk_size só vai no fio quando != 0 (START antigo = só total_size),
+// image_size só na imagem comprimida ou delta (leva o chunk_size junto), e flags só
+// quando não são CMD_OTA_FLAG_LZ sozinho
+template <>
+struct Tail<cmd_ota_start_t> {
+    static constexpr size_t size(const cmd_ota_start_t &v)
+    {
+        return v.image_size ? IMAGE + (v.flags != CMD_OTA_FLAG_LZ ? sizeof(v.flags) : 0)
+                            : v.chunk_size ? sizeof(v.chunk_size) : 0;
+    }
+    static bool set(cmd_ota_start_t &v, size_t n)
+    {
+        if (n < IMAGE + sizeof(v.flags)) v.flags = (n == IMAGE) ? CMD_OTA_FLAG_LZ : 0;
+        if (n < IMAGE) v.image_size = 0;
+        if (n == 0) v.chunk_size = 0;
+        return n == 0 || n == sizeof(v.chunk_size) || n == IMAGE || n == IMAGE + sizeof(v.flags);
+    }
+
+private:
+    static constexpr size_t IMAGE = sizeof(uint16_t) + sizeof(uint32_t); // chunk_size + image_size
+};
+
+// OTA_END: o payload inteiro (CRC + SHA-256) só vai com digest; zerado = END sem payload
+template <>
+struct Tail<cmd_ota_end_t> {
+    static constexpr size_t size(const cmd_ota_end_t &v)
+    {
+        for (uint8_t b : v.sha256)
+            if (b != 0) return sizeof(v);
+        return 0;
+    }
+    static bool set(cmd_ota_end_t &v, size_t n)
+    {
+        if (n == 0) v = cmd_ota_end_t{};
+        return n == 0 || n == sizeof(v); // Digest zerado com payload cai na conferência do get
+    }
+};
+
+template <>
+struct Tail<cmd_tlm_data_t> {
+    static constexpr size_t size(const cmd_tlm_data_t &v) { return v.records_len; }
+    static bool set(cmd_tlm_data_t &v, size_t n)
+    {
+        if (n > sizeof(v.records)) return false;
+        v.records_len = (uint8_t)n;
+        return true;
+    }
+};
+
+// O prefixo fixo precisa ser exatamente a memória da struct até a cauda
+static_assert(offsetof(cmd_ota_chunk_t, data) == Cmd<CMD_OTA_CHUNK_REQ_ID>::min_payload, "layout OTA_CHUNK");
+static_assert(sizeof(cmd_ota_chunk_t::data) == Cmd<CMD_OTA_CHUNK_REQ_ID>::max_payload - Cmd<CMD_OTA_CHUNK_REQ_ID>::min_payload,
+              "layout OTA_CHUNK");
+static_assert(offsetof(cmd_tlm_data_t, records) == Cmd<CMD_TLM_DATA_ID>::min_payload, "layout TLM_DATA");
+
+// Comandos de tamanho fixo: a struct tem o tamanho do payload (vazia = sem payload)
+#define CMDC_CHECK(name, id, member, min, max, enc, dec, hub)                                    \
+    static_assert(Cmd<CMD_##name##_ID>::variable ||                                             \
+                      (std::is_empty<Cmd<CMD_##name##_ID>::type>::value ? (min) == 0             \
+                                                                      : sizeof(Cmd<CMD_##name##_ID>::type) == (min)), \
+                  "payload de " #name " fora de sincronia com a CMD_TABLE");
+CMD_TABLE(CMDC_CHECK)
+#undef CMDC_CHECK
+
+// --- HEADER ---
+struct Header {
+    uint8_t dst;
+    uint8_t src;
+    uint8_t seq;
+    cmd_ids_t id;
+    uint16_t size; // Bytes de payload
+};
+
+inline void put_header(uint8_t *p, const Header &h)
+{
+    p[0] = CMD_SOF_1_BYTE;
+    p[1] = CMD_SOF_2_BYTE;
+    p[2] = h.dst;
+    p[3] = h.src;
+    p[CMD_HDR_ID_OFFSET] = (uint8_t)h.id;
+    p[CMD_HDR_SEQ_OFFSET] = h.seq;
+    p[CMD_HDR_SIZE_OFFSET] = (uint8_t)h.size;
+    p[CMD_HDR_SIZE_OFFSET + 1] = (uint8_t)(h.size >> 8);
+}
+
+inline void put_trailer(uint8_t *p, size_t frame_len)
+{
+    uint16_t crc = crc16(p, frame_len - CMD_TRAILER_SIZE);
+    p[frame_len - 2] = (uint8_t)crc;
+    p[frame_len - 1] = (uint8_t)(crc >> 8);
+}
+
+// --- ENCODE ---
+// Escreve o frame no início de 'out'. Retorna o tamanho do frame, ou 0 se não couber
+// (ou se a cauda passar do máximo da tabela); nesse caso 'out' pode ter sido tocado.
+template <cmd_ids_t Id>
+size_t encode(Span out, uint8_t dst, uint8_t src, uint8_t seq, const typename Cmd<Id>::type &v)
+{
+    using C = Cmd<Id>;
+    size_t payload = C::min_payload + Tail<typename C::type>::size(v);
+    size_t frame_len = CMD_HDR_SIZE + payload + CMD_TRAILER_SIZE;
+
+    if (payload > C::max_payload || frame_len > out.size) return 0;
+
+    put_header(out.data, {dst, src, seq, Id, (uint16_t)payload});
+    if (payload) std::memcpy(out.data + CMD_HDR_SIZE, &v, payload);
+    put_trailer(out.data, frame_len);
+    return frame_len;
+}
+
+// Só header (comandos sem payload, sem precisar de um valor)
+template <cmd_ids_t Id>
+size_t encode(Span out, uint8_t dst, uint8_t src, uint8_t seq)
+{
+    static_assert(Cmd<Id>::max_payload == 0, "comando com payload");
+    return encode<Id>(out, dst, src, seq, typename Cmd<Id>::type{});
+}
+
+// --- DECODE ---
+// Frame validado: header lido e payload apontando para dentro do buffer do chamador
+struct View {
+    Header hdr;
+    const uint8_t *payload;
+    size_t frame_len;
+};
+
+// Valida o frame no início de 'in' (SOF, ID conhecido, faixa da tabela, CRC)
+inline bool parse(ConstSpan in, View &v)
+{
+    const uint8_t *p = in.data;
+    if (in.size < CMD_HDR_SIZE + CMD_TRAILER_SIZE) return false;
+    if (p[0] != CMD_SOF_1_BYTE || p[1] != CMD_SOF_2_BYTE) return false;
+
+    uint8_t id = p[CMD_HDR_ID_OFFSET];
+    uint16_t size = (uint16_t)(p[CMD_HDR_SIZE_OFFSET] | (p[CMD_HDR_SIZE_OFFSET + 1] << 8));
+    if (id >= CMD_NUM_CMDS || !limits[id].known) return false;
+    if (size < limits[id].min_payload || size > limits[id].max_payload) return false;
+
+    size_t frame_len = CMD_HDR_SIZE + size + CMD_TRAILER_SIZE;
+    if (in.size < frame_len) return false;
+
+    uint16_t crc = (uint16_t)(p[frame_len - 2] | (p[frame_len - 1] << 8));
+    if (crc16(p, frame_len - CMD_TRAILER_SIZE) != crc) return false;
+
+    v.hdr = {p[2], p[3], p[CMD_HDR_SEQ_OFFSET], (cmd_ids_t)id, size};
+    v.payload = p + CMD_HDR_SIZE;
+    v.frame_len = frame_len;
+    return true;
+}
+
+// Copia o payload de uma View já validada para a struct do comando
+template <cmd_ids_t Id>
+bool get(const View &v, typename Cmd<Id>::type &out)
+{
+    using T = typename Cmd<Id>::type;
+    if (v.hdr.id != Id) return false;
+    if (!Tail<T>::set(out, v.hdr.size - Cmd<Id>::min_payload)) return false;
+    if (v.hdr.size) std::memcpy(&out, v.payload, v.hdr.size);
+    // OTA_CHUNK: o 'len' do fio vem no prefixo e tem que bater com o tamanho do frame
+    return Tail<T>::size(out) + Cmd<Id>::min_payload == v.hdr.size;
+}
+
+template <cmd_ids_t Id>
+bool decode(ConstSpan in, Header &hdr, typename Cmd<Id>::type &out)
+{
+    View v;
+    if (!parse(in, v) || !get<Id>(v, out)) return false;
+    hdr = v.hdr;
+    return true;
+}
+
+// Chama fn(Cmd<ID>{}, valor) com o tipo certo para o ID do frame. false se o frame não valida.
+template <typename Fn>
+bool visit(const View &v, Fn &&fn)
+{
+    switch (v.hdr.id) {
+#define CMDC_VISIT(name, id, member, min, max, enc, dec, hub)                                    \
+    case CMD_##name##_ID: {                                                                    \
+        Cmd<CMD_##name##_ID>::type value{};                                                    \
+        if (!get<CMD_##name##_ID>(v, value)) return false;                                     \
+        fn(Cmd<CMD_##name##_ID>{}, value);                                                     \
+        return true;                                                                           \
+    }
+        CMD_TABLE(CMDC_VISIT)
+#undef CMDC_VISIT
+    default:
+        return false;
+    }
+}
+
+} // namespace cmdc
@@ -0,0 +1,157 @@
+/* cmd_codec_bench.cpp - Throughput de encode/decode por comando: cmd_codec.hpp x cmd.c
+ *
+ * Um benchmark por linha da CMD_TABLE e por sentido, para o codec header-only do host
+ * (cmdc) e para o codec C do firmware (cmd_encode/cmd_decode) compilado no host.
+ * Antes de medir, confere que os dois geram os mesmos bytes e que cada um decodifica o
+ * frame do outro: o benchmark também é o teste de que os layouts batem.
+ *
+ * Build (a partir de test/, precisa da Google Benchmark):
+ *   gcc -O2 -c -I../include -I../utl ../src/cmd.c ../utl/utl_io.c ../utl/utl_crc16.c ../utl/utl_varint.c
+ *   g++ -O2 -std=c++17 -I../include -I../utl cmd_codec_bench.cpp cmd.o utl_io.o utl_crc16.o utl_varint.o \
+ *       -lbenchmark -lpthread -o cmd_codec_bench
+ */
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <benchmark/benchmark.h>
+#include "cmd_codec.hpp"
+
+// Valor de exemplo: bytes variados e, nos comandos variáveis, a cauda no máximo
+template <cmd_ids_t Id>
+static typename cmdc::Cmd<Id>::type amostra()
+{
+    using T = typename cmdc::Cmd<Id>::type;
+    T v{};
+    if (!std::is_empty<T>::value) {
+        uint8_t *p = reinterpret_cast<uint8_t *>(&v);
+        for (size_t i = 0; i < sizeof(T); i++) p[i] = (uint8_t)(i * 37 + Id);
+    }
+    cmdc::Tail<T>::set(v, cmdc::Cmd<Id>::max_payload - cmdc::Cmd<Id>::min_payload);
+    if constexpr (Id == CMD_TLM_DATA_ID)
+        v.format = CMD_TLM_FMT_DELTA; // O decoder C recusa formato desconhecido (DELTA não amarra count)
+    return v;
+}
+
+template <cmd_ids_t Id>
+static size_t encode_c(uint8_t *buf, const typename cmdc::Cmd<Id>::type &v)
+{
+    cmd_cmds_t cmd;
+    uint8_t src = ADDR_MASTER, dst = ADDR_SLAVE, seq = 7;
+    cmd_ids_t id = Id;
+    size_t len = 0;
+
+    std::memcpy(&cmd, &v, sizeof(v));
+    return cmd_encode(buf, &len, &src, &dst, &seq, &id, &cmd) ? len : 0;
+}
+
+// --- CONFERÊNCIA: mesmos bytes nos dois codecs, decode cruzado ---
+template <cmd_ids_t Id>
+static bool confere()
+{
+    using C = cmdc::Cmd<Id>;
+    auto v = amostra<Id>();
+    uint8_t a[FRAME_MAX_CMD_SIZE], b[FRAME_MAX_CMD_SIZE];
+
+    size_t na = cmdc::encode<Id>({a, sizeof(a)}, ADDR_SLAVE, ADDR_MASTER, 7, v);
+    size_t nb = encode_c<Id>(b, v);
+    if (na == 0 || na != nb || std::memcmp(a, b, na) != 0) {
+        printf("[FALHA] %s: encode difere (cmdc %zu bytes, C %zu bytes)\n", C::name, na, nb);
+        return false;
+    }
+
+    cmdc::Header h;
+    typename C::type back{};
+    uint8_t src, dst, seq;
+    cmd_ids_t id;
+    cmd_cmds_t cmd;
+    if (!cmdc::decode<Id>({b, nb}, h, back) || !cmd_decode(a, na, &src, &dst, &seq, &id, &cmd) || id != Id) {
+        printf("[FALHA] %s: decode cruzado\n", C::name);
+        return false;
+    }
+    return true;
+}
+
+// --- BENCHMARKS ---
+template <cmd_ids_t Id>
+static void bm_encode_cmdc(benchmark::State &state)
+{
+    auto v = amostra<Id>();
+    uint8_t buf[FRAME_MAX_CMD_SIZE];
+    size_t len = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&v);
+        len = cmdc::encode<Id>({buf, sizeof(buf)}, ADDR_SLAVE, ADDR_MASTER, 7, v);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * len));
+}
+
+template <cmd_ids_t Id>
+static void bm_encode_c(benchmark::State &state)
+{
+    auto v = amostra<Id>();
+    uint8_t buf[FRAME_MAX_CMD_SIZE];
+    size_t len = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&v);
+        len = encode_c<Id>(buf, v);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * len));
+}
+
+template <cmd_ids_t Id>
+static void bm_decode_cmdc(benchmark::State &state)
+{
+    uint8_t buf[FRAME_MAX_CMD_SIZE];
+    size_t len = cmdc::encode<Id>({buf, sizeof(buf)}, ADDR_SLAVE, ADDR_MASTER, 7, amostra<Id>());
+    cmdc::Header h;
+    typename cmdc::Cmd<Id>::type v{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buf);
+        bool ok = cmdc::decode<Id>({buf, len}, h, v);
+        benchmark::DoNotOptimize(ok);
+        benchmark::DoNotOptimize(&v);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * len));
+}
+
+template <cmd_ids_t Id>
+static void bm_decode_c(benchmark::State &state)
+{
+    uint8_t buf[FRAME_MAX_CMD_SIZE];
+    size_t len = encode_c<Id>(buf, amostra<Id>());
+    uint8_t src, dst, seq;
+    cmd_ids_t id;
+    cmd_cmds_t cmd;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buf);
+        bool ok = cmd_decode(buf, len, &src, &dst, &seq, &id, &cmd);
+        benchmark::DoNotOptimize(ok);
+        benchmark::DoNotOptimize(&cmd);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * len));
+}
+
+int main(int argc, char **argv)
+{
+    bool ok = true;
+#define CONFERE(name, id, member, min, max, enc, dec, hub) ok = confere<CMD_##name##_ID>() && ok;
+    CMD_TABLE(CONFERE)
+#undef CONFERE
+    if (!ok) return 1;
+    printf("Layouts conferidos: cmd_codec.hpp e cmd.c geram os mesmos frames.\n");
+
+#define REGISTRA(name, id, member, min, max, enc, dec, hub)                                      \
+    benchmark::RegisterBenchmark("encode/cmdc/" #name, bm_encode_cmdc<CMD_##name##_ID>);       \
+    benchmark::RegisterBenchmark("encode/c/" #name, bm_encode_c<CMD_##name##_ID>);             \
+    benchmark::RegisterBenchmark("decode/cmdc/" #name, bm_decode_cmdc<CMD_##name##_ID>);       \
+    benchmark::RegisterBenchmark("decode/c/" #name, bm_decode_c<CMD_##name##_ID>);
+    CMD_TABLE(REGISTRA)
+#undef REGISTRA
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
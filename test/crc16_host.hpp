@@ -0,0 +1,227 @@
+/* crc16_host.hpp - CRC-16/CCITT do Gateway: folding com multiplicação sem carry + dispatch em runtime
+ *
+ * Mesmo CRC do firmware (utl_crc16: poly 0x1021, init 0xFFFF, MSB primeiro, sem XOR final),
+ * bit a bit idêntico a utl_crc16_data. Para imagens de OTA inteiras e rajadas de telemetria.
+ *
+ * Como funciona: a mensagem é um polinômio M(x) (primeiro byte = grau mais alto) e o CRC é
+ * M(x)·x^16 mod P. O CRC corrente entra somado (XOR) aos 2 primeiros bytes. Os blocos de
+ * 16 bytes viram inteiros de 128 bits (byte swap) e o acumulador A anda bloco a bloco:
+ *     A·x^128 + B  ≡  H·(x^192 mod P) + L·(x^128 mod P) + B      (A = H·x^64 + L)
+ * As constantes têm 16 bits, então cada produto de 64x16 bits cabe em 128 sem reduzir:
+ * basta manter A congruente módulo P. Quatro acumuladores independentes (64 bytes por volta,
+ * constantes x^576/x^512) escondem a latência da multiplicação; no fim eles são dobrados num
+ * só, e os 16 bytes de A mais a cauda (< 16 bytes) passam pelo motor escalar (utl_crc16),
+ * o que já faz a redução final A·x^16 mod P.
+ *
+ * x86-64: PCLMULQDQ + SSSE3 (pshufb). ARM64: PMULL (extensão crypto). O resto cai no
+ * utl_crc16_update (slicing-by-N). A escolha é feita uma vez, pela CPU em que roda.
+ * Link: utl_crc16.o (gcc -c ../utl/utl_crc16.c).
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+    #include "utl_crc16.h"
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC16_HOST_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define CRC16_HOST_ARM64 1
+#endif
+
+namespace crc16h {
+
+typedef uint16_t (*update_fn)(uint16_t crc, const uint8_t *data, size_t len);
+
+struct Engine {
+    const char *name;
+    update_fn update;
+};
+
+// x^n mod P, P = x^16 + x^12 + x^5 + 1
+constexpr uint64_t xpow_mod(unsigned n)
+{
+    uint32_t r = 1;
+    while (n--) {
+        r <<= 1;
+        if (r & 0x10000) r ^= 0x11021;
+    }
+    return r;
+}
+
+// Dobra de 1 bloco (128 bits) e de 4 blocos (512 bits): {parte alta, parte baixa}
+constexpr uint64_t K1_HI = xpow_mod(192), K1_LO = xpow_mod(128);
+constexpr uint64_t K4_HI = xpow_mod(576), K4_LO = xpow_mod(512);
+
+// Abaixo disso não há bloco para dobrar
+constexpr size_t FOLD_MIN = 16;
+
+inline uint16_t update_scalar(uint16_t crc, const uint8_t *data, size_t len)
+{
+    return utl_crc16_update(crc, data, len);
+}
+
+#if CRC16_HOST_X86
+// --- x86-64: PCLMULQDQ ---
+// Acumulador = inteiro de 128 bits com o primeiro byte do bloco no topo
+#define CRC16_CLMUL __attribute__((target("pclmul,ssse3")))
+
+CRC16_CLMUL static inline __m128i clmul_load(const uint8_t *p)
+{
+    const __m128i swap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)p), swap);
+}
+
+CRC16_CLMUL static inline __m128i clmul_fold(__m128i a, __m128i k, __m128i next)
+{
+    __m128i h = _mm_clmulepi64_si128(a, k, 0x11);
+    __m128i l = _mm_clmulepi64_si128(a, k, 0x00);
+    return _mm_xor_si128(_mm_xor_si128(h, l), next);
+}
+
+CRC16_CLMUL inline uint16_t update_clmul(uint16_t crc, const uint8_t *p, size_t len)
+{
+    if (len < FOLD_MIN) return utl_crc16_update(crc, p, len);
+
+    const __m128i k1 = _mm_set_epi64x((long long)K1_HI, (long long)K1_LO);
+    const __m128i k4 = _mm_set_epi64x((long long)K4_HI, (long long)K4_LO);
+    const __m128i init = _mm_set_epi64x((long long)((uint64_t)crc << 48), 0);
+    __m128i a;
+
+    if (len >= 128) {
+        __m128i a0 = _mm_xor_si128(clmul_load(p), init);
+        __m128i a1 = clmul_load(p + 16);
+        __m128i a2 = clmul_load(p + 32);
+        __m128i a3 = clmul_load(p + 48);
+        p += 64;
+        len -= 64;
+        while (len >= 64) {
+            a0 = clmul_fold(a0, k4, clmul_load(p));
+            a1 = clmul_fold(a1, k4, clmul_load(p + 16));
+            a2 = clmul_fold(a2, k4, clmul_load(p + 32));
+            a3 = clmul_fold(a3, k4, clmul_load(p + 48));
+            p += 64;
+            len -= 64;
+        }
+        a = clmul_fold(clmul_fold(clmul_fold(a0, k1, a1), k1, a2), k1, a3);
+    } else {
+        a = _mm_xor_si128(clmul_load(p), init);
+        p += 16;
+        len -= 16;
+    }
+    for (; len >= 16; p += 16, len -= 16)
+        a = clmul_fold(a, k1, clmul_load(p));
+
+    // A volta a ser 16 bytes na ordem do fio; o escalar reduz e segue com a cauda
+    uint8_t rest[16];
+    _mm_storeu_si128((__m128i *)rest, clmul_load((const uint8_t *)&a));
+    return utl_crc16_update(utl_crc16_update(0, rest, sizeof(rest)), p, len);
+}
+
+inline bool clmul_supported()
+{
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+}
+
+#undef CRC16_CLMUL
+#define CRC16_HOST_CLMUL_NAME "pclmulqdq"
+#elif CRC16_HOST_ARM64
+// --- ARM64: PMULL ---
+// Acumulador = {parte alta, parte baixa} nas lanes 0 e 1 (vrev64 de cada metade do bloco)
+#define CRC16_CLMUL __attribute__((target("arch=armv8-a+crypto")))
+
+CRC16_CLMUL static inline uint64x2_t clmul_load(const uint8_t *p)
+{
+    return vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(p)));
+}
+
+CRC16_CLMUL static inline uint64x2_t clmul_fold(uint64x2_t a, uint64_t k_hi, uint64_t k_lo, uint64x2_t next)
+{
+    poly128_t h = vmull_p64((poly64_t)vgetq_lane_u64(a, 0), (poly64_t)k_hi);
+    poly128_t l = vmull_p64((poly64_t)vgetq_lane_u64(a, 1), (poly64_t)k_lo);
+    uint64x2_t r = veorq_u64(vreinterpretq_u64_p128(h), vreinterpretq_u64_p128(l)); // {baixa, alta}
+    return veorq_u64(vextq_u64(r, r, 1), next);
+}
+
+CRC16_CLMUL inline uint16_t update_clmul(uint16_t crc, const uint8_t *p, size_t len)
+{
+    if (len < FOLD_MIN) return utl_crc16_update(crc, p, len);
+
+    const uint64x2_t init = vcombine_u64(vcreate_u64((uint64_t)crc << 48), vcreate_u64(0));
+    uint64x2_t a;
+
+    if (len >= 128) {
+        uint64x2_t a0 = veorq_u64(clmul_load(p), init);
+        uint64x2_t a1 = clmul_load(p + 16);
+        uint64x2_t a2 = clmul_load(p + 32);
+        uint64x2_t a3 = clmul_load(p + 48);
+        p += 64;
+        len -= 64;
+        while (len >= 64) {
+            a0 = clmul_fold(a0, K4_HI, K4_LO, clmul_load(p));
+            a1 = clmul_fold(a1, K4_HI, K4_LO, clmul_load(p + 16));
+            a2 = clmul_fold(a2, K4_HI, K4_LO, clmul_load(p + 32));
+            a3 = clmul_fold(a3, K4_HI, K4_LO, clmul_load(p + 48));
+            p += 64;
+            len -= 64;
+        }
+        a = clmul_fold(a0, K1_HI, K1_LO, a1);
+        a = clmul_fold(a, K1_HI, K1_LO, a2);
+        a = clmul_fold(a, K1_HI, K1_LO, a3);
+    } else {
+        a = veorq_u64(clmul_load(p), init);
+        p += 16;
+        len -= 16;
+    }
+    for (; len >= 16; p += 16, len -= 16)
+        a = clmul_fold(a, K1_HI, K1_LO, clmul_load(p));
+
+    uint8_t rest[16];
+    vst1q_u8(rest, vrev64q_u8(vreinterpretq_u8_u64(a)));
+    return utl_crc16_update(utl_crc16_update(0, rest, sizeof(rest)), p, len);
+}
+
+inline bool clmul_supported()
+{
+    return (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+}
+
+#undef CRC16_CLMUL
+#define CRC16_HOST_CLMUL_NAME "pmull"
+#endif
+
+// --- DISPATCH ---
+inline Engine pick()
+{
+#ifdef CRC16_HOST_CLMUL_NAME
+    if (clmul_supported()) return {CRC16_HOST_CLMUL_NAME, update_clmul};
+#endif
+    return {"utl_crc16", update_scalar};
+}
+
+// Motor desta CPU (escolhido na primeira chamada)
+inline const Engine &engine()
+{
+    static const Engine e = pick();
+    return e;
+}
+
+// Mesma API incremental do utl_crc16: crc = update(crc, ...) em pedaços de qualquer tamanho
+inline uint16_t update(uint16_t crc, const uint8_t *data, size_t len)
+{
+    return engine().update(crc, data, len);
+}
+
+inline uint16_t data(const uint8_t *data, size_t len)
+{
+    return update(utl_crc16_init(), data, len);
+}
+
+} // namespace crc16h
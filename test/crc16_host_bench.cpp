@@ -0,0 +1,97 @@
+/* crc16_host_bench.cpp - CRC-16 do Gateway (crc16_host.hpp) contra utl_crc16_data
+ *
+ * Confere o motor com multiplicação sem carry contra utl_crc16_data em todos os tamanhos
+ * até 1 KiB (8 alinhamentos de início, CRC de entrada variado), em pedaços incrementais
+ * e numa imagem de 128 KiB. Depois mede os dois em 64 B (slot FIXED), 4 KiB e 128 KiB.
+ *
+ * Build (a partir de test/, precisa da Google Benchmark):
+ *   gcc -O2 -c -I../utl ../utl/utl_crc16.c
+ *   g++ -O2 -std=c++17 -I../utl crc16_host_bench.cpp utl_crc16.o -lbenchmark -lpthread -o crc16_host_bench
+ */
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "crc16_host.hpp"
+
+static std::vector<uint8_t> dados(size_t n)
+{
+    std::mt19937 rng(4321);
+    std::vector<uint8_t> v(n);
+    for (auto &b : v) b = (uint8_t)rng();
+    return v;
+}
+
+// --- CONFERÊNCIA ---
+static bool confere(const crc16h::Engine &e)
+{
+    auto buf = dados(128 * 1024 + 8);
+    static const uint8_t check[] = "123456789";
+
+    if (e.update(0xFFFF, check, 9) != 0x29B1) {
+        printf("[FALHA] %s: check \"123456789\" != 0x29B1\n", e.name);
+        return false;
+    }
+
+    for (size_t off = 0; off < 8; off++) {
+        for (size_t n = 0; n <= 1024; n++) {
+            const uint8_t *p = buf.data() + off;
+            uint16_t acc = (uint16_t)(0xFFFF - n * 257);
+            if (e.update(acc, p, n) != utl_crc16_data(p, n, acc)) {
+                printf("[FALHA] %s: offset %zu, %zu bytes, crc inicial %04X\n", e.name, off, n, acc);
+                return false;
+            }
+        }
+    }
+
+    // Imagem inteira de uma vez e em pedaços de tamanhos que não dividem os blocos
+    uint16_t ref = utl_crc16_data(buf.data(), 128 * 1024, 0xFFFF);
+    if (e.update(0xFFFF, buf.data(), 128 * 1024) != ref) {
+        printf("[FALHA] %s: 128 KiB\n", e.name);
+        return false;
+    }
+    for (size_t step : {1, 17, 48, 64, 250, 4096}) {
+        uint16_t crc = utl_crc16_init();
+        for (size_t i = 0; i < 128 * 1024; i += step)
+            crc = e.update(crc, buf.data() + i, std::min(step, 128 * 1024 - i));
+        if (utl_crc16_final(crc) != ref) {
+            printf("[FALHA] %s: incremental em pedaços de %zu\n", e.name, step);
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- BENCHMARKS ---
+static void bm_crc(benchmark::State &state, crc16h::Engine e)
+{
+    auto buf = dados((size_t)state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buf.data());
+        uint16_t crc = e.update(0xFFFF, buf.data(), buf.size());
+        benchmark::DoNotOptimize(crc);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * buf.size()));
+}
+
+int main(int argc, char **argv)
+{
+    const crc16h::Engine escalar = {"utl_crc16", crc16h::update_scalar};
+    const crc16h::Engine &cpu = crc16h::engine();
+
+    if (!confere(cpu)) return 1;
+    printf("Motor desta CPU: %s (confere com utl_crc16_data).\n", cpu.name);
+
+    benchmark::RegisterBenchmark("crc16/utl_crc16", bm_crc, escalar)->Arg(64)->Arg(4 * 1024)->Arg(128 * 1024);
+    if (cpu.update != escalar.update)
+        benchmark::RegisterBenchmark((std::string("crc16/") + cpu.name).c_str(), bm_crc, cpu)
+            ->Arg(64)->Arg(4 * 1024)->Arg(128 * 1024);
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,345 @@
+/* delta_bench.cpp - OTA delta: delta_host.hpp (gerador) ida e volta com o utl_delta do firmware
+ *
+ * Roda contra um simulador do flash do F411: slot0 com a base no começo e o resto apagado
+ * (só leitura, leitura fora dele é erro), slot1 em páginas de 16 KiB que só aceitam gravar
+ * byte apagado e só na ordem, como o flash_img. Para cada par base/nova: gera o patch, comprime com o
+ * lz_host.hpp, e aplica as duas formas (utl_lz -> utl_delta -> slot1) em pedaços de
+ * tamanho aleatório, como os chunks chegam ao escritor; o slot1 tem que sair igual à
+ * imagem nova. Confere também:
+ *  - base errada (um byte, outra versão, maior que o slot0): -ENOEXEC antes de gravar nada;
+ *  - patch truncado ou corrompido: nunca grava além da imagem nem lê fora do slot0, e
+ *    truncado nunca fecha como completo;
+ *  - casos de borda: imagens de 1 a 300 bytes, base vazia, imagens iguais.
+ * Imprime quanto cada forma custa em frames de chunk cheio (CMD_OTA_CHUNK_DATA_MAX) e mede
+ * as duas pontas.
+ *
+ * Uso: delta_bench [base.bin nova.bin]... (sem pares: o próprio executável como base e
+ * uma "versão nova" sintética: trechos inseridos, bytes trocados e ponteiros deslocados)
+ *
+ * Build (a partir de test/, precisa da Google Benchmark):
+ *   gcc -O2 -c -I../utl ../utl/utl_delta.c ../utl/utl_lz.c ../utl/utl_varint.c ../utl/utl_crc16.c
+ *   g++ -O2 -std=c++17 -I../include -I../utl delta_bench.cpp utl_delta.o utl_lz.o utl_varint.o utl_crc16.o
+ *       -lbenchmark -lpthread -o delta_bench
+ *   ./delta_bench blackpill_v1.2.2.bin blackpill_v1.2.3.bin
+ */
+#include <cerrno>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "delta_host.hpp"
+#include "lz_host.hpp"
+
+extern "C" {
+    #include "cmd.h"
+}
+
+static const size_t CHUNK = CMD_OTA_CHUNK_DATA_MAX;
+static const uint32_t VERSAO = deltah::version(1, 2, 3);
+
+// --- SIMULADOR DE FLASH ---
+struct Flash {
+    static const size_t PAGE = 16 * 1024;
+    static const size_t SLOT = 128 * 1024;
+
+    std::vector<uint8_t> slot0 = std::vector<uint8_t>(SLOT, 0xFF);
+    std::vector<uint8_t> slot1 = std::vector<uint8_t>(SLOT, 0x00); // Lixo da imagem anterior
+    std::vector<bool> apagada = std::vector<bool>(SLOT / PAGE, false);
+    size_t gravado = 0; // O flash_img grava em ordem
+    size_t limite = 0;  // Tamanho da imagem: gravar além é erro do decodificador
+    bool erro = false;
+
+    // A imagem instalada ocupa o começo do slot0; o resto está apagado
+    void instala(const std::vector<uint8_t> &base)
+    {
+        std::fill(slot0.begin(), slot0.end(), 0xFF);
+        std::copy(base.begin(), base.end(), slot0.begin());
+    }
+
+    void comeca(size_t tamanho)
+    {
+        std::fill(apagada.begin(), apagada.end(), false);
+        std::fill(slot1.begin(), slot1.end(), 0x00);
+        gravado = 0;
+        limite = tamanho;
+        erro = false;
+    }
+
+    static int le(void *arg, uint32_t off, uint8_t *buf, size_t len)
+    {
+        Flash *f = (Flash *)arg;
+        if ((size_t)off + len > SLOT) {
+            f->erro = true;
+            return -EIO;
+        }
+        memcpy(buf, &f->slot0[off], len);
+        return 0;
+    }
+
+    static int grava(void *arg, const uint8_t *data, size_t len)
+    {
+        Flash *f = (Flash *)arg;
+        if (f->gravado + len > f->limite) {
+            f->erro = true;
+            return -ENOSPC;
+        }
+        for (size_t i = 0; i < len; i++, f->gravado++) {
+            size_t p = f->gravado / PAGE;
+            if (!f->apagada[p]) { // O escritor apaga a página antes do primeiro byte dela
+                memset(&f->slot1[p * PAGE], 0xFF, PAGE);
+                f->apagada[p] = true;
+            }
+            if (f->slot1[f->gravado] != 0xFF) {
+                f->erro = true;
+                return -EIO;
+            }
+            f->slot1[f->gravado] = data[i];
+        }
+        return 0;
+    }
+};
+
+// Patch cru, ou comprimido: a saída do utl_lz alimenta o utl_delta (como no escritor)
+struct Aplicador {
+    utl_delta_dec_t delta;
+    utl_lz_dec_t lz;
+    bool comprimido;
+
+    static int lz_sink(void *arg, const uint8_t *data, size_t len)
+    {
+        return utl_delta_dec_feed(&((Aplicador *)arg)->delta, data, len);
+    }
+
+    void comeca(Flash &f, size_t img_size, uint32_t patch_size, bool z, uint32_t versao = VERSAO,
+                uint32_t limite = Flash::SLOT)
+    {
+        f.comeca(img_size);
+        comprimido = z;
+        utl_delta_dec_init(&delta, img_size, versao, limite, Flash::le, Flash::grava, &f);
+        if (z) utl_lz_dec_init(&lz, patch_size, lz_sink, this);
+    }
+
+    int feed(const uint8_t *p, size_t n)
+    {
+        return comprimido ? utl_lz_dec_feed(&lz, p, n) : utl_delta_dec_feed(&delta, p, n);
+    }
+
+    bool completo() const { return utl_delta_dec_done(&delta) && (!comprimido || utl_lz_dec_done(&lz)); }
+};
+
+static Flash flash;
+static Aplicador ap;
+
+static bool aplica(const std::vector<uint8_t> &img, const std::vector<uint8_t> &stream, uint32_t patch_size, bool z,
+                   std::mt19937 &rng, size_t max_pedaco)
+{
+    ap.comeca(flash, img.size(), patch_size, z);
+    for (size_t pos = 0; pos < stream.size();) {
+        size_t n = std::min<size_t>(1 + rng() % max_pedaco, stream.size() - pos);
+        if (ap.feed(&stream[pos], n) != 0) return false;
+        pos += n;
+    }
+    return ap.completo() && !flash.erro && flash.gravado == img.size() &&
+           memcmp(flash.slot1.data(), img.data(), img.size()) == 0;
+}
+
+// Base e imagem nova: patch cru e comprimido, em pedaços de chunk e bem pequenos
+static bool ida_e_volta(const std::vector<uint8_t> &base, const std::vector<uint8_t> &img, std::mt19937 &rng)
+{
+    auto patch = deltah::diff(base, img, VERSAO);
+    auto z = lzh::compress(patch.data(), patch.size());
+    flash.instala(base);
+    return aplica(img, patch, 0, false, rng, CHUNK) && aplica(img, patch, 0, false, rng, 5) &&
+           aplica(img, z, patch.size(), true, rng, CHUNK) && aplica(img, z, patch.size(), true, rng, 5);
+}
+
+// Base que não é a do patch (um byte, outra versão, maior que o slot0 legível): recusa no
+// cabeçalho, sem gravar nada
+static bool base_errada(const std::vector<uint8_t> &base, const std::vector<uint8_t> &img, std::mt19937 &rng)
+{
+    auto patch = deltah::diff(base, img, VERSAO);
+
+    for (int caso = 0; caso < 3; caso++) {
+        flash.instala(base);
+        uint32_t versao = (caso == 1) ? deltah::version(1, 2, 4) : VERSAO;
+        uint32_t limite = (caso == 2) ? (uint32_t)base.size() - 1 : Flash::SLOT;
+        if (caso == 0) flash.slot0[rng() % base.size()] ^= 0x01;
+
+        ap.comeca(flash, img.size(), 0, false, versao, limite);
+        if (ap.feed(patch.data(), patch.size()) != -ENOEXEC || flash.gravado != 0) return false;
+    }
+    flash.instala(base);
+    return true;
+}
+
+// Patch estragado: pode dar erro, ficar incompleto ou (corrompido) sair outra imagem, mas
+// nunca grava além do tamanho nem lê fora do slot0, e truncado nunca fecha
+static bool estragado_seguro(const std::vector<uint8_t> &base, const std::vector<uint8_t> &img, std::mt19937 &rng)
+{
+    auto patch = deltah::diff(base, img, VERSAO);
+    flash.instala(base);
+
+    for (int t = 0; t < 200; t++) {
+        auto ruim = patch;
+        bool truncado = t % 2 == 0;
+        if (truncado) ruim.resize(rng() % ruim.size());
+        else ruim[UTL_DELTA_HDR_SIZE + rng() % (ruim.size() - UTL_DELTA_HDR_SIZE)] ^= (uint8_t)(1 + rng() % 255);
+
+        ap.comeca(flash, img.size(), 0, false);
+        ap.feed(ruim.data(), ruim.size());
+        if (flash.erro || (truncado && ap.completo())) return false;
+    }
+    return true;
+}
+
+// "Versão nova" de uma imagem: o que um rebuild costuma fazer com um binário
+static std::vector<uint8_t> nova_versao(const std::vector<uint8_t> &base, std::mt19937 &rng)
+{
+    std::vector<uint8_t> v = base;
+
+    // Ponteiros para depois do meio andam 24 bytes (o código inserido abaixo)
+    uint32_t meio = (uint32_t)v.size() / 2;
+    for (size_t i = 0; i + 4 <= v.size(); i += 4) {
+        uint32_t w;
+        memcpy(&w, &v[i], 4);
+        if (w > meio && w < v.size()) {
+            w += 24;
+            memcpy(&v[i], &w, 4);
+        }
+    }
+    for (int k = 0; k < 200; k++) v[rng() % v.size()] = (uint8_t)rng();
+    for (int k = 0; k < 3; k++) {
+        size_t at = meio + rng() % (v.size() - meio);
+        std::vector<uint8_t> novo(8);
+        for (auto &b : novo) b = (uint8_t)rng();
+        v.insert(v.begin() + at, novo.begin(), novo.end());
+    }
+    return v;
+}
+
+// --- CONFERÊNCIA ---
+static bool confere(const std::vector<std::vector<uint8_t>> &bases, const std::vector<std::vector<uint8_t>> &novas)
+{
+    std::mt19937 rng(2024);
+
+    for (size_t n = 1; n <= 300; n++) {
+        std::vector<uint8_t> base(n), img;
+        for (auto &b : base) b = (uint8_t)(rng() % 4);
+        img = base;
+        for (size_t k = 0; k < 1 + n / 50; k++) img[rng() % n] = (uint8_t)rng();
+        if (rng() % 2) img.insert(img.begin() + rng() % n, (uint8_t)rng());
+        if (!ida_e_volta(base, img, rng) || !ida_e_volta(base, base, rng) || !ida_e_volta({}, img, rng) ||
+            !ida_e_volta(img, std::vector<uint8_t>(1 + rng() % 3, 0xAA), rng)) {
+            printf("[FALHA] borda: %zu bytes\n", n);
+            return false;
+        }
+    }
+
+    for (size_t k = 0; k < bases.size(); k++) {
+        if (!ida_e_volta(bases[k], novas[k], rng)) {
+            printf("[FALHA] par %zu\n", k);
+            return false;
+        }
+        if (!base_errada(bases[k], novas[k], rng)) {
+            printf("[FALHA] par %zu: patch aplicado sobre a base errada\n", k);
+            return false;
+        }
+        if (!estragado_seguro(bases[k], novas[k], rng)) {
+            printf("[FALHA] par %zu: patch estragado passou do slot\n", k);
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- BENCHMARKS ---
+static void bm_diff(benchmark::State &state, size_t k, const std::vector<std::vector<uint8_t>> *bases,
+                    const std::vector<std::vector<uint8_t>> *novas)
+{
+    for (auto _ : state) {
+        auto p = deltah::diff((*bases)[k], (*novas)[k], VERSAO);
+        benchmark::DoNotOptimize(p.data());
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * (*novas)[k].size()));
+}
+
+static void bm_apply(benchmark::State &state, size_t k, const std::vector<std::vector<uint8_t>> *bases,
+                     const std::vector<std::vector<uint8_t>> *novas)
+{
+    const auto &img = (*novas)[k];
+    auto patch = deltah::diff((*bases)[k], img, VERSAO);
+    auto z = lzh::compress(patch.data(), patch.size());
+    flash.instala((*bases)[k]);
+    for (auto _ : state) {
+        ap.comeca(flash, img.size(), patch.size(), true);
+        for (size_t pos = 0; pos < z.size(); pos += CHUNK) ap.feed(&z[pos], std::min(CHUNK, z.size() - pos));
+        benchmark::DoNotOptimize(flash.gravado);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * img.size()));
+}
+
+static std::vector<uint8_t> ler(const std::string &nome)
+{
+    std::ifstream f(nome, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+static size_t frames(size_t n) { return (n + CHUNK - 1) / CHUNK; }
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> nomes;
+    std::vector<std::vector<uint8_t>> bases, novas;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') continue; // Opções da Google Benchmark
+        nomes.push_back(argv[i]);
+    }
+    if (nomes.size() % 2 != 0) {
+        printf("[FALHA] Arquivos vão em pares: base nova\n");
+        return 1;
+    }
+
+    std::mt19937 rng(7);
+    for (size_t i = 0; i < nomes.size(); i += 2) {
+        bases.push_back(ler(nomes[i]));
+        novas.push_back(ler(nomes[i + 1]));
+    }
+    if (nomes.empty()) {
+        auto exe = ler("/proc/self/exe");
+        exe.resize(std::min(exe.size(), Flash::SLOT - Flash::PAGE));
+        bases.push_back(exe);
+        novas.push_back(nova_versao(exe, rng));
+        nomes = {"/proc/self/exe", "(sintética)"};
+    }
+    for (size_t k = 0; k < bases.size(); k++) {
+        if (bases[k].empty() || novas[k].empty() || bases[k].size() > Flash::SLOT || novas[k].size() > Flash::SLOT) {
+            printf("[FALHA] par %zu: imagem vazia, ilegível ou maior que o slot\n", k);
+            return 1;
+        }
+    }
+
+    if (!confere(bases, novas)) return 1;
+    printf("utl_delta confere com delta_host.hpp (flash simulado, slots de %zu KiB).\n", Flash::SLOT / 1024);
+
+    for (size_t k = 0; k < bases.size(); k++) {
+        const auto &img = novas[k];
+        auto patch = deltah::diff(bases[k], img, VERSAO);
+        size_t z_img = lzh::compress(img.data(), img.size()).size();
+        size_t z_patch = lzh::compress(patch.data(), patch.size()).size();
+        printf("%s -> %s: %zu bytes; frames de %zu: imagem %zu, --lz %zu, patch %zu (%zu bytes), --delta %zu (%zu bytes, %.1f%%)\n",
+               nomes[2 * k].c_str(), nomes[2 * k + 1].c_str(), img.size(), CHUNK, frames(img.size()), frames(z_img),
+               frames(patch.size()), patch.size(), frames(z_patch), z_patch, 100.0 * z_patch / img.size());
+        benchmark::RegisterBenchmark(("delta/diff/" + std::to_string(k)).c_str(), bm_diff, k, &bases, &novas);
+        benchmark::RegisterBenchmark(("delta/apply_lz/" + std::to_string(k)).c_str(), bm_apply, k, &bases, &novas);
+    }
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,186 @@
+/* delta_host.hpp - Gerador de patch do OTA delta (formato do utl_delta) para o lado Host
+ *
+ * Mesmo algoritmo do bsdiff: varre a imagem nova procurando o maior trecho exato na base;
+ * enquanto o trecho só confirma o alinhamento corrente (mesma distância base/nova), segue.
+ * Quando aparece um alinhamento melhor, fecha um registro: o trecho aproximado antes dele
+ * vira diff (nova - base, quase tudo zero onde só mudaram endereços), o que não bate com
+ * nada vira extra, e o seek leva a base para o novo alinhamento. O bsdiff acha o maior
+ * trecho com um suffix array; aqui são cadeias de hash de 8 bytes com até 'depth'
+ * candidatos, que para imagens de algumas centenas de KiB dá o mesmo patch na prática.
+ *
+ * O patch sai cru: os zeros do diff ficam para o lz_host.hpp (ota_master --delta manda
+ * o patch comprimido).
+ *
+ * Depende de utl_delta.h (formato), utl_varint.c e utl_crc16.c (linkar junto).
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+    #include "utl_delta.h"
+    #include "utl_varint.h"
+    #include "utl_crc16.h"
+    #include "utl_io.h"
+}
+
+namespace deltah {
+
+static constexpr unsigned HASH_BITS = 16;
+static constexpr size_t HASH_LEN = 8;
+
+// Versão no formato do cabeçalho (APP_VERSION_NUMBER do Zephyr)
+inline uint32_t version(unsigned major, unsigned minor, unsigned patch)
+{
+    return (uint32_t)((major << 16) | (minor << 8) | patch);
+}
+
+class Differ {
+public:
+    explicit Differ(int depth = 64) : depth_(depth), head_(1u << HASH_BITS) {}
+
+    std::vector<uint8_t> diff(const std::vector<uint8_t> &base, const std::vector<uint8_t> &img, uint32_t base_version)
+    {
+        std::vector<uint8_t> out(UTL_DELTA_HDR_SIZE);
+        uint8_t *h = out.data();
+        utl_io_put32_tl_ap(UTL_DELTA_MAGIC, h);
+        utl_io_put32_tl_ap(base_version, h);
+        utl_io_put32_tl_ap((uint32_t)base.size(), h);
+        utl_io_put32_tl_ap((uint32_t)img.size(), h);
+        utl_io_put16_tl_ap(utl_crc16_data(base.data(), base.size(), 0xFFFF), h);
+
+        index(base);
+        scan(base, img, out);
+        return out;
+    }
+
+private:
+    int depth_;
+    std::vector<int32_t> head_;
+    std::vector<int32_t> prev_;
+
+    static uint32_t hash(const uint8_t *p)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return (uint32_t)((v * 0x9E3779B97F4A7C15ull) >> (64 - HASH_BITS));
+    }
+
+    void index(const std::vector<uint8_t> &base)
+    {
+        std::fill(head_.begin(), head_.end(), -1);
+        prev_.assign(base.size(), -1);
+        for (size_t i = 0; i + HASH_LEN <= base.size(); i++) {
+            uint32_t k = hash(&base[i]);
+            prev_[i] = head_[k];
+            head_[k] = (int32_t)i;
+        }
+    }
+
+    // Maior trecho exato da base igual a img[i..]
+    size_t search(const std::vector<uint8_t> &base, const std::vector<uint8_t> &img, size_t i, size_t *pos) const
+    {
+        size_t best = 0;
+        *pos = 0;
+        if (i + HASH_LEN > img.size()) return 0;
+        int32_t c = head_[hash(&img[i])];
+        for (int d = 0; c >= 0 && d < depth_; d++, c = prev_[c]) {
+            size_t len = 0;
+            while ((size_t)c + len < base.size() && i + len < img.size() && base[c + len] == img[i + len]) len++;
+            if (len > best) {
+                best = len;
+                *pos = (size_t)c;
+            }
+        }
+        return best;
+    }
+
+    static void put_varint(std::vector<uint8_t> &out, uint32_t v)
+    {
+        uint8_t buf[UTL_VARINT_MAX_SIZE];
+        out.insert(out.end(), buf, buf + utl_varint_put(v, buf));
+    }
+
+    // Laço do bsdiff (scan/lastscan/lastpos/lastoffset), registros no formato do utl_delta
+    void scan(const std::vector<uint8_t> &base, const std::vector<uint8_t> &img, std::vector<uint8_t> &out) const
+    {
+        const int64_t oldsize = (int64_t)base.size();
+        const int64_t newsize = (int64_t)img.size();
+        int64_t scan = 0, len = 0, lastscan = 0, lastpos = 0, lastoffset = 0;
+        size_t pos = 0;
+
+        while (scan < newsize) {
+            int64_t oldscore = 0;
+            int64_t scsc = scan += len;
+            for (; scan < newsize; scan++) {
+                len = (int64_t)search(base, img, (size_t)scan, &pos);
+                for (; scsc < scan + len; scsc++)
+                    if (scsc + lastoffset < oldsize && base[scsc + lastoffset] == img[scsc]) oldscore++;
+                if ((len == oldscore && len != 0) || len > oldscore + 8) break;
+                if (scan + lastoffset < oldsize && base[scan + lastoffset] == img[scan]) oldscore--;
+            }
+            if (len == oldscore && scan != newsize) continue;
+
+            // Estende o alinhamento anterior para frente e o novo para trás, enquanto
+            // mais da metade dos bytes bate
+            int64_t s = 0, sf = 0, lenf = 0;
+            for (int64_t i = 0; lastscan + i < scan && lastpos + i < oldsize;) {
+                if (base[lastpos + i] == img[lastscan + i]) s++;
+                i++;
+                if (s * 2 - i > sf * 2 - lenf) {
+                    sf = s;
+                    lenf = i;
+                }
+            }
+            int64_t lenb = 0;
+            if (scan < newsize) {
+                int64_t sb = 0;
+                s = 0;
+                for (int64_t i = 1; scan >= lastscan + i && (int64_t)pos >= i; i++) {
+                    if (base[pos - i] == img[scan - i]) s++;
+                    if (s * 2 - i > sb * 2 - lenb) {
+                        sb = s;
+                        lenb = i;
+                    }
+                }
+            }
+            if (lastscan + lenf > scan - lenb) {
+                int64_t overlap = (lastscan + lenf) - (scan - lenb);
+                int64_t ss = 0, lens = 0;
+                s = 0;
+                for (int64_t i = 0; i < overlap; i++) {
+                    if (img[lastscan + lenf - overlap + i] == base[lastpos + lenf - overlap + i]) s++;
+                    if (img[scan - lenb + i] == base[pos - lenb + i]) s--;
+                    if (s > ss) {
+                        ss = s;
+                        lens = i + 1;
+                    }
+                }
+                lenf += lens - overlap;
+                lenb -= lens;
+            }
+
+            int64_t extra = (scan - lenb) - (lastscan + lenf);
+            put_varint(out, (uint32_t)lenf);
+            put_varint(out, (uint32_t)extra);
+            // O registro que fecha a imagem não leva seek
+            if (scan - lenb < newsize) put_varint(out, utl_varint_zigzag((int32_t)(((int64_t)pos - lenb) - (lastpos + lenf))));
+            for (int64_t i = 0; i < lenf; i++) out.push_back((uint8_t)(img[lastscan + i] - base[lastpos + i]));
+            out.insert(out.end(), img.begin() + (lastscan + lenf), img.begin() + (lastscan + lenf + extra));
+
+            lastscan = scan - lenb;
+            lastpos = (int64_t)pos - lenb;
+            lastoffset = (int64_t)pos - scan;
+        }
+    }
+};
+
+inline std::vector<uint8_t> diff(const std::vector<uint8_t> &base, const std::vector<uint8_t> &img, uint32_t base_version)
+{
+    return Differ().diff(base, img, base_version);
+}
+
+} // namespace deltah
@@ -0,0 +1,72 @@
+/* frame_batch.hpp - Empacota/desempacota vários frames por transação SPI (lado Host) */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+extern "C" {
+    #include "cmd.h"
+}
+
+// Acrescenta um frame já codificado ao buffer de transmissão.
+// Retorna false (sem escrever nada) se o frame não couber no espaço restante.
+inline bool frame_batch_push(uint8_t *buf, size_t capacity, size_t *used, const uint8_t *frame, size_t frame_len)
+{
+    if (*used + frame_len > capacity) return false;
+    memcpy(&buf[*used], frame, frame_len);
+    *used += frame_len;
+    return true;
+}
+
+// Gera sequências para pedidos com tag (pula CMD_SEQ_NONE ao dar a volta).
+inline uint8_t frame_batch_next_seq()
+{
+    static uint8_t seq = CMD_SEQ_NONE;
+    if (++seq == CMD_SEQ_NONE) ++seq;
+    return seq;
+}
+
+// Codifica um comando direto no fim do buffer de transmissão.
+inline bool frame_batch_encode(uint8_t *buf, size_t capacity, size_t *used, uint8_t src, uint8_t dst, uint8_t seq,
+                               cmd_ids_t id, cmd_cmds_t *cmd)
+{
+    uint8_t frame[FRAME_MAX_CMD_SIZE];
+    size_t frame_len = 0;
+
+    if (!cmd_encode(frame, &frame_len, &src, &dst, &seq, &id, cmd)) return false;
+    return frame_batch_push(buf, capacity, used, frame, frame_len);
+}
+
+// Percorre todos os frames válidos de um buffer recebido (padding e lixo entre frames são ignorados).
+// fn(src, dst, seq, id, cmd) é chamada para cada frame. Retorna quantos frames foram decodificados.
+template <typename Fn>
+int frame_batch_for_each(const uint8_t *rx, size_t len, Fn &&fn)
+{
+    int count = 0;
+    size_t i = 0;
+
+    while (i + CMD_HDR_SIZE + CMD_TRAILER_SIZE <= len) {
+        if (rx[i] != CMD_SOF_1_BYTE || rx[i + 1] != CMD_SOF_2_BYTE) {
+            i++;
+            continue;
+        }
+
+        size_t payload = rx[i + CMD_HDR_SIZE_OFFSET] | (rx[i + CMD_HDR_SIZE_OFFSET + 1] << 8);
+        size_t frame_len = CMD_HDR_SIZE + payload + CMD_TRAILER_SIZE;
+
+        uint8_t src, dst, seq;
+        cmd_ids_t id;
+        cmd_cmds_t cmd;
+        if (payload <= CMD_MAX_DATA_SIZE && i + frame_len <= len &&
+            cmd_decode(const_cast<uint8_t *>(&rx[i]), frame_len, &src, &dst, &seq, &id, &cmd)) {
+            fn(src, dst, seq, id, cmd);
+            count++;
+            i += frame_len;
+        }
+        else {
+            i++;
+        }
+    }
+    return count;
+}
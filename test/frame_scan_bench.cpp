@@ -0,0 +1,241 @@
+/* frame_scan_bench.cpp - Compara o scanner em blocos com a máquina de estados antiga (byte a byte)
+ *
+ * Roda no host, sem SPI. Build (a partir de test/):
+ *   gcc -O2 -c -I../include -I../utl ../src/frame_scanner.c ../src/cmd.c ../utl/utl_io.c ../utl/utl_crc16.c
+ *       ../utl/utl_varint.c
+ *   g++ -O2 -std=c++17 -I../include -I../utl frame_scan_bench.cpp frame_scanner.o cmd.o utl_io.o utl_crc16.o
+ *       utl_varint.o -o frame_scan_bench
+ */
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "frame_batch.hpp"
+
+extern "C" {
+    #include "frame_scanner.h"
+    #include "utl_io.h"
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t ciclos() { return __rdtsc(); }
+static const char *UNIDADE = "bytes/ciclo";
+#else
+static inline uint64_t ciclos()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static const char *UNIDADE = "bytes/ns";
+#endif
+
+// --- CÓPIA DO PARSER ANTIGO (protocol_feed_byte do hub.c) ---
+namespace legado {
+
+typedef enum
+{
+    STATE_WAIT_SOF1,
+    STATE_WAIT_SOF2,
+    STATE_READ_HEADER,
+    STATE_READ_PAYLOAD,
+} parser_state_t;
+
+static parser_state_t p_state = STATE_WAIT_SOF1;
+static uint8_t p_buffer[CMD_MAX_DATA_SIZE + 16];
+static uint16_t p_index = 0;
+static uint16_t p_expected_len = 0;
+static void (*on_frame)(uint8_t *frame, size_t len, void *ctx);
+static void *on_frame_ctx;
+
+__attribute__((noinline)) void protocol_feed_byte(uint8_t byte)
+{
+    switch (p_state)
+    {
+    case STATE_WAIT_SOF1:
+        if (byte == CMD_SOF_1_BYTE)
+            p_state = STATE_WAIT_SOF2;
+        break;
+
+    case STATE_WAIT_SOF2:
+        if (byte == CMD_SOF_2_BYTE)
+        {
+            p_state = STATE_READ_HEADER;
+            p_index = 0;
+            p_buffer[p_index++] = CMD_SOF_1_BYTE;
+            p_buffer[p_index++] = CMD_SOF_2_BYTE;
+        }
+        else if (byte != CMD_SOF_1_BYTE)
+        {
+            p_state = STATE_WAIT_SOF1;
+        }
+        break;
+
+    case STATE_READ_HEADER:
+        p_buffer[p_index++] = byte;
+        if (p_index >= CMD_HDR_SIZE)
+        {
+            p_expected_len = utl_io_get16_fl(&p_buffer[CMD_HDR_SIZE_OFFSET]);
+            p_state = (p_expected_len > CMD_MAX_DATA_SIZE) ? STATE_WAIT_SOF1 : STATE_READ_PAYLOAD;
+        }
+        break;
+
+    case STATE_READ_PAYLOAD:
+        if (p_expected_len > 0 || p_index < (CMD_HDR_SIZE + CMD_TRAILER_SIZE))
+            p_buffer[p_index++] = byte;
+
+        if (p_index >= (CMD_HDR_SIZE + p_expected_len + CMD_TRAILER_SIZE))
+        {
+            on_frame(p_buffer, p_index, on_frame_ctx);
+            p_state = STATE_WAIT_SOF1;
+        }
+        break;
+    }
+}
+
+} // namespace legado
+
+// --- CONTADOR DE FRAMES (mesmo callback nos dois parsers) ---
+struct Coleta {
+    size_t frames = 0;
+    uint32_t soma = 0;                 // Checksum barato dos bytes entregues
+    std::vector<std::vector<uint8_t>> *guardados = nullptr;
+};
+
+static void coleta_frame(uint8_t *frame, size_t len, void *ctx)
+{
+    Coleta *c = static_cast<Coleta *>(ctx);
+    c->frames++;
+    for (size_t i = 0; i < len; i++) c->soma = c->soma * 31 + frame[i];
+    if (c->guardados) c->guardados->emplace_back(frame, frame + len);
+}
+
+// --- CARGAS ---
+// Transações de tamanho fixo; frames podem atravessar a fronteira entre transações.
+struct Carga {
+    const char *nome;
+    size_t transacao;
+    std::vector<uint8_t> stream;
+};
+
+static void acrescenta_frame(std::vector<uint8_t> &out, cmd_ids_t id, uint8_t seq)
+{
+    uint8_t buf[FRAME_MAX_CMD_SIZE];
+    size_t used = 0;
+    cmd_cmds_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    if (id == CMD_OTA_CHUNK_REQ_ID) {
+        cmd.ota_chunk_req.offset = seq * 48u;
+        cmd.ota_chunk_req.len = 48;
+        memset(cmd.ota_chunk_req.data, 0xAA, 48); // Payload cheio de SOF1: pior caso para a busca
+    }
+    frame_batch_encode(buf, sizeof(buf), &used, ADDR_MASTER, ADDR_SLAVE, seq, id, &cmd);
+    out.insert(out.end(), buf, buf + used);
+}
+
+// Um pedido curto por transação de 64 bytes, resto é padding de zeros (modo FIXED)
+static Carga carga_fixed(size_t transacoes)
+{
+    Carga c{"FIXED 64B, 1 frame + padding", 64, {}};
+    for (size_t t = 0; t < transacoes; t++) {
+        size_t ini = c.stream.size();
+        acrescenta_frame(c.stream, CMD_GET_STATUS_REQ_ID, (uint8_t)(t | 1));
+        c.stream.resize(ini + 64, 0);
+    }
+    return c;
+}
+
+// Chunks de OTA colados, sem padding, cortados em transações de 256 bytes (modo VARIABLE)
+static Carga carga_ota(size_t frames)
+{
+    Carga c{"VARIABLE 256B, chunks OTA colados", 256, {}};
+    for (size_t f = 0; f < frames; f++)
+        acrescenta_frame(c.stream, CMD_OTA_CHUNK_REQ_ID, (uint8_t)(f | 1));
+    c.stream.resize((c.stream.size() + 255) / 256 * 256, 0);
+    return c;
+}
+
+// Lixo aleatório com frames intercalados: exercita ressincronização
+static Carga carga_ruido(size_t frames, uint32_t semente)
+{
+    Carga c{"Ruído + frames", 64, {}};
+    std::mt19937 rng(semente);
+    for (size_t f = 0; f < frames; f++) {
+        size_t lixo = rng() % 40;
+        for (size_t i = 0; i < lixo; i++) {
+            uint32_t r = rng() % 8;
+            c.stream.push_back(r == 0 ? CMD_SOF_1_BYTE : (uint8_t)rng()); // AAs soltos de propósito
+        }
+        acrescenta_frame(c.stream, (f & 1) ? CMD_GET_STATUS_REQ_ID : CMD_OTA_CHUNK_REQ_ID, (uint8_t)(f | 1));
+    }
+    c.stream.resize((c.stream.size() + 63) / 64 * 64, 0);
+    return c;
+}
+
+// --- EXECUÇÃO ---
+static Coleta roda_legado(const Carga &c, std::vector<std::vector<uint8_t>> *guardados = nullptr)
+{
+    Coleta col;
+    col.guardados = guardados;
+    legado::p_state = legado::STATE_WAIT_SOF1;
+    legado::on_frame = coleta_frame;
+    legado::on_frame_ctx = &col;
+    for (size_t off = 0; off < c.stream.size(); off += c.transacao)
+        for (size_t i = 0; i < c.transacao; i++)
+            legado::protocol_feed_byte(c.stream[off + i]);
+    return col;
+}
+
+static Coleta roda_scanner(const Carga &c, std::vector<std::vector<uint8_t>> *guardados = nullptr)
+{
+    Coleta col;
+    col.guardados = guardados;
+    frame_scanner_t scanner;
+    frame_scanner_init(&scanner, coleta_frame, &col);
+    for (size_t off = 0; off < c.stream.size(); off += c.transacao)
+        frame_scanner_feed(&scanner, &c.stream[off], c.transacao);
+    return col;
+}
+
+template <typename F>
+static double mede(const Carga &c, F fn, int repeticoes)
+{
+    uint64_t melhor = UINT64_MAX;
+    for (int r = 0; r < repeticoes; r++) {
+        uint64_t t0 = ciclos();
+        Coleta col = fn(c, nullptr);
+        uint64_t t1 = ciclos();
+        if (col.frames == 0) printf("?");
+        if (t1 - t0 < melhor) melhor = t1 - t0;
+    }
+    return (double)c.stream.size() / (double)melhor;
+}
+
+int main()
+{
+    std::vector<Carga> cargas = {carga_fixed(20000), carga_ota(8000), carga_ruido(8000, 1234)};
+    bool ok = true;
+
+    // Os dois parsers precisam entregar exatamente os mesmos frames
+    for (const Carga &c : cargas) {
+        std::vector<std::vector<uint8_t>> a, b;
+        Coleta ca = roda_legado(c, &a);
+        Coleta cb = roda_scanner(c, &b);
+        if (a != b) {
+            printf("[ERRO] %s: legado %zu frames, scanner %zu frames\n", c.nome, ca.frames, cb.frames);
+            ok = false;
+        }
+    }
+    if (!ok) return 1;
+
+    printf("%-36s %14s %14s %8s\n", "Carga", "legado", "scanner", "ganho");
+    for (const Carga &c : cargas) {
+        double l = mede(c, roda_legado, 20);
+        double s = mede(c, roda_scanner, 20);
+        printf("%-36s %14.3f %14.3f %7.1fx\n", c.nome, l, s, s / l);
+    }
+    printf("(unidade: %s, melhor de 20 execuções)\n", UNIDADE);
+    return 0;
+}
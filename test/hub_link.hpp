@@ -0,0 +1,203 @@
+/* hub_link.hpp - Lado mestre do link SPI com handshake READY/ATTN (ver cmd.h)
+ *
+ * READY: slot armado no escravo. ATTN: escravo tem resposta/telemetria esperando.
+ * Nenhum sleep chutado: toda espera é por uma borda de GPIO (com timeout), e o único
+ * atraso fixo é CMD_LINK_ARM_US, a janela entre a subida do READY e o DMA armado.
+ *
+ * GPIO pelo character device do kernel (uAPI v2, Linux 5.10+): os pinos são linhas de
+ * /dev/gpiochip0 (no Raspberry Pi, o número BCM), pedidas como entrada com as duas bordas,
+ * e a espera é um ppoll() no fd da linha. Não usa sysfs nem biblioteca de GPIO.
+ */
+#pragma once
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include <linux/spi/spidev.h>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "frame_batch.hpp"
+
+// Uma linha de entrada com eventos de borda (subida e descida)
+class GpioLine {
+public:
+    GpioLine(const char *chip, int line)
+    {
+        int fd_chip = open(chip, O_RDONLY | O_CLOEXEC);
+        if (fd_chip < 0) throw std::runtime_error(std::string("GPIO: não abriu ") + chip);
+
+        struct gpio_v2_line_request req;
+        memset(&req, 0, sizeof(req));
+        req.offsets[0] = (uint32_t)line;
+        req.num_lines = 1;
+        req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+        strncpy(req.consumer, "hub_link", sizeof(req.consumer) - 1);
+        int ret = ioctl(fd_chip, GPIO_V2_GET_LINE_IOCTL, &req);
+        close(fd_chip);
+        if (ret < 0) throw std::runtime_error("GPIO: linha " + std::to_string(line) + " ocupada ou inexistente");
+        fd_ = req.fd;
+    }
+    ~GpioLine() { close(fd_); }
+    GpioLine(const GpioLine &) = delete;
+    GpioLine &operator=(const GpioLine &) = delete;
+
+    bool get()
+    {
+        struct gpio_v2_line_values v = {0, 1};
+        return ioctl(fd_, GPIO_V2_LINE_GET_VALUES_IOCTL, &v) == 0 && (v.bits & 1);
+    }
+
+    // Dorme até alguma borda ou o timeout e descarta os eventos da fila. false = timeout.
+    bool wait_for_edge(long timeout_ns)
+    {
+        struct pollfd pfd = {fd_, POLLIN, 0};
+        struct timespec ts = {timeout_ns / 1000000000, timeout_ns % 1000000000};
+        if (ppoll(&pfd, 1, &ts, nullptr) <= 0) return false;
+
+        struct gpio_v2_line_event ev[16];
+        return read(fd_, ev, sizeof(ev)) > 0;
+    }
+
+private:
+    int fd_;
+};
+
+class HubLink {
+public:
+    static const long TIMEOUT_NS = 1000000000; // 1 s sem borda = escravo travado
+
+    // gpio_ready / gpio_attn: linhas de 'gpio_chip'
+    HubLink(int fd_spi, uint32_t speed, int gpio_ready, int gpio_attn, const char *gpio_chip = "/dev/gpiochip0")
+        : fd_(fd_spi),
+          speed_(speed),
+          ready_(gpio_chip, gpio_ready), // Sobe = armado, desce = DMA acabou
+          attn_(gpio_chip, gpio_attn)
+    {
+    }
+
+    // Modo negociado com CMD_LINK_CONFIG_REQ_ID (a troca vale a partir da próxima transação)
+    void set_variable(bool on) { variable_ = on; }
+    bool variable() const { return variable_; }
+
+    bool attention() { return attn_.get(); }
+
+    // Espera ATTN alto. false = timeout (nada chegou para ler).
+    bool wait_attention(long timeout_ns = TIMEOUT_NS) { return wait_level(attn_, true, timeout_ns); }
+
+    // Uma transferência física full-duplex, assim que o escravo armar o DMA
+    int xfer(const uint8_t *tx, uint8_t *rx, size_t len)
+    {
+        if (!wait_level(ready_, true, TIMEOUT_NS)) {
+            fprintf(stderr, "[ERRO] Timeout esperando READY!\n");
+            return -1;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(CMD_LINK_ARM_US));
+
+        struct spi_ioc_transfer tr;
+        memset(&tr, 0, sizeof(tr));
+        tr.tx_buf = (unsigned long)tx;
+        tr.rx_buf = (unsigned long)rx;
+        tr.len = (uint32_t)len;
+        tr.speed_hz = speed_;
+        tr.bits_per_word = 8;
+
+        if (ioctl(fd_, SPI_IOC_MESSAGE(1), &tr) < 1) {
+            perror("Erro SPI Xfer");
+            return -1;
+        }
+
+        // O escravo baixa o READY assim que o DMA termina: sem isso, o nível alto
+        // da transação que acabou seria confundido com o próximo slot armado.
+        if (!wait_level(ready_, false, TIMEOUT_NS)) {
+            fprintf(stderr, "[ERRO] READY não baixou depois da transação!\n");
+            return -1;
+        }
+        return 0;
+    }
+
+    // Uma transação no modo corrente. FIXED: 64 bytes (tx completado com zeros).
+    // VARIABLE: header de 4 bytes nos dois sentidos e corpo de max(len mestre, len escravo).
+    int transaction(const uint8_t *tx, size_t tx_len, uint8_t *rx, size_t *rx_len)
+    {
+        uint8_t body[CMD_LINK_MAX_BODY];
+
+        if (!variable_) {
+            memset(body, 0, CMD_LINK_FIXED_SIZE);
+            if (tx_len) memcpy(body, tx, tx_len);
+            *rx_len = CMD_LINK_FIXED_SIZE;
+            return xfer(body, rx, CMD_LINK_FIXED_SIZE);
+        }
+
+        cmd_link_hdr_t hdr_tx = {CMD_LINK_MAGIC_MASTER, 0, (uint16_t)tx_len};
+        cmd_link_hdr_t hdr_rx;
+        if (xfer((uint8_t *)&hdr_tx, (uint8_t *)&hdr_rx, sizeof(hdr_rx)) < 0) return -1;
+
+        if (hdr_rx.magic != CMD_LINK_MAGIC_SLAVE || hdr_rx.len > CMD_LINK_MAX_BODY) {
+            printf("[ERRO] Header de link inválido (%02X)\n", hdr_rx.magic);
+            return -1;
+        }
+
+        size_t n = (hdr_rx.len > tx_len) ? hdr_rx.len : tx_len;
+        if (n > 0) {
+            memset(body, 0, n);
+            if (tx_len) memcpy(body, tx, tx_len);
+            if (xfer(body, rx, n) < 0) return -1;
+        }
+        *rx_len = hdr_rx.len;
+        return 0;
+    }
+
+    // Envia um pedido e continua lendo enquanto o escravo sinalizar ATTN, até 'done'
+    // (chamado com cada bloco recebido) devolver true. A volta toda dura o processamento
+    // do escravo mais as transações necessárias para atravessar o pipeline.
+    // Retorna 0 (done), -1 (erro de link) ou -2 (ATTN não subiu dentro do timeout).
+    template <typename Done>
+    int round_trip(const uint8_t *tx, size_t tx_len, uint8_t *rx, Done &&done, long timeout_ns = TIMEOUT_NS)
+    {
+        size_t rx_len = 0;
+        if (transaction(tx, tx_len, rx, &rx_len) < 0) return -1;
+        if (done(rx, rx_len)) return 0;
+
+        while (true) {
+            if (!wait_attention(timeout_ns)) return -2;
+            if (transaction(nullptr, 0, rx, &rx_len) < 0) return -1;
+            if (done(rx, rx_len)) return 0;
+        }
+    }
+
+    // Espera ATTN e lê uma transação vazia. rx_len = 0 se ATTN não subiu no timeout.
+    int poll(uint8_t *rx, size_t *rx_len, long timeout_ns = TIMEOUT_NS)
+    {
+        *rx_len = 0;
+        if (!wait_attention(timeout_ns)) return 0;
+        return transaction(nullptr, 0, rx, rx_len);
+    }
+
+private:
+    // Espera o pino chegar em 'level', dormindo nas bordas. Bordas antigas na fila do
+    // kernel (ou do outro sentido, no READY) só fazem reler o nível: o nível é quem manda.
+    static bool wait_level(GpioLine &pin, bool level, long timeout_ns)
+    {
+        auto limite = std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeout_ns);
+        while (pin.get() != level) {
+            long resta = (long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                limite - std::chrono::steady_clock::now()).count();
+            if (resta <= 0) return false;
+            pin.wait_for_edge(resta);
+        }
+        return true;
+    }
+
+    int fd_;
+    uint32_t speed_;
+    GpioLine ready_;
+    GpioLine attn_;
+    bool variable_ = false;
+};
@@ -0,0 +1,177 @@
+/* lz_bench.cpp - OTA comprimido: lz_host.hpp (compressor) ida e volta com o utl_lz do firmware
+ *
+ * Para cada imagem (arquivos da linha de comando; sem nenhum, o próprio executável):
+ * comprime, descomprime com utl_lz_dec_feed em pedaços de tamanho aleatório (como os
+ * chunks chegam ao escritor) e compara byte a byte. Antes disso confere casos de borda
+ * (1 a 300 bytes, zeros, ruído) e que streams truncados ou corrompidos nunca passam do
+ * tamanho anunciado nem fecham como completos. Imprime a razão e quantos frames de chunk
+ * cheio (CMD_OTA_CHUNK_DATA_MAX) cada imagem custa crua e comprimida, depois mede as duas pontas.
+ *
+ * Build (a partir de test/, precisa da Google Benchmark):
+ *   gcc -O2 -c -I../utl ../utl/utl_lz.c
+ *   g++ -O2 -std=c++17 -I../include -I../utl lz_bench.cpp utl_lz.o -lbenchmark -lpthread -o lz_bench
+ *   ./lz_bench blackpill_v1.2.3.bin
+ */
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "lz_host.hpp"
+
+extern "C" {
+    #include "cmd.h"
+}
+
+static const size_t CHUNK = CMD_OTA_CHUNK_DATA_MAX;
+
+struct Saida {
+    std::vector<uint8_t> bytes;
+    size_t limite;
+};
+
+static int sink(void *arg, const uint8_t *data, size_t len)
+{
+    Saida *s = (Saida *)arg;
+    if (s->bytes.size() + len > s->limite) return -1; // O decodificador nunca deveria passar
+    s->bytes.insert(s->bytes.end(), data, data + len);
+    return 0;
+}
+
+// Descomprime entregando o stream em pedaços de 1..max_pedaco bytes
+static bool ida_e_volta(const std::vector<uint8_t> &img, std::mt19937 &rng, size_t max_pedaco)
+{
+    auto z = lzh::compress(img.data(), img.size());
+    static utl_lz_dec_t d;
+    Saida s{{}, img.size()};
+    utl_lz_dec_init(&d, img.size(), sink, &s);
+
+    for (size_t pos = 0; pos < z.size();) {
+        size_t n = std::min<size_t>(1 + rng() % max_pedaco, z.size() - pos);
+        if (utl_lz_dec_feed(&d, &z[pos], n) != 0) return false;
+        pos += n;
+    }
+    return utl_lz_dec_done(&d) && s.bytes == img;
+}
+
+// Stream estragado: pode dar erro ou ficar incompleto, mas nunca completo com outra saída
+static bool estragado_seguro(const std::vector<uint8_t> &img, std::mt19937 &rng)
+{
+    auto z = lzh::compress(img.data(), img.size());
+    static utl_lz_dec_t d;
+
+    for (int t = 0; t < 200; t++) {
+        auto ruim = z;
+        if (t % 2 == 0) ruim.resize(rng() % ruim.size());
+        else ruim[rng() % ruim.size()] ^= (uint8_t)(1 + rng() % 255);
+
+        Saida s{{}, img.size()};
+        utl_lz_dec_init(&d, img.size(), sink, &s);
+        int ret = utl_lz_dec_feed(&d, ruim.data(), ruim.size());
+        if (ret == -1) return false;                                            // Passou do tamanho
+        if (ret == 0 && utl_lz_dec_done(&d) && s.bytes != img && t % 2 == 0) return false; // Truncado "completo"
+    }
+    return true;
+}
+
+// --- CONFERÊNCIA ---
+static bool confere(const std::vector<std::vector<uint8_t>> &imagens)
+{
+    std::mt19937 rng(99);
+
+    for (size_t n = 1; n <= 300; n++) {
+        std::vector<uint8_t> v(n);
+        for (size_t i = 0; i < n; i++) v[i] = (i % 7 < 3) ? (uint8_t)rng() : (uint8_t)(i / 7);
+        std::vector<uint8_t> zeros(n, 0);
+        if (!ida_e_volta(v, rng, 8) || !ida_e_volta(zeros, rng, 3)) {
+            printf("[FALHA] borda: %zu bytes\n", n);
+            return false;
+        }
+    }
+
+    std::vector<uint8_t> ruido(64 * 1024);
+    for (auto &b : ruido) b = (uint8_t)rng();
+    std::vector<uint8_t> zeros(128 * 1024, 0);
+    if (!ida_e_volta(ruido, rng, CHUNK) || !ida_e_volta(zeros, rng, CHUNK)) {
+        printf("[FALHA] ruído / zeros\n");
+        return false;
+    }
+
+    for (size_t k = 0; k < imagens.size(); k++) {
+        if (!ida_e_volta(imagens[k], rng, CHUNK) || !ida_e_volta(imagens[k], rng, 7)) {
+            printf("[FALHA] imagem %zu\n", k);
+            return false;
+        }
+        if (!estragado_seguro(imagens[k], rng)) {
+            printf("[FALHA] imagem %zu: stream estragado passou\n", k);
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- BENCHMARKS ---
+static void bm_compress(benchmark::State &state, const std::vector<uint8_t> *img)
+{
+    for (auto _ : state) {
+        auto z = lzh::compress(img->data(), img->size());
+        benchmark::DoNotOptimize(z.data());
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * img->size()));
+}
+
+static int sink_nulo(void *, const uint8_t *, size_t) { return 0; }
+
+static void bm_decompress(benchmark::State &state, const std::vector<uint8_t> *img)
+{
+    auto z = lzh::compress(img->data(), img->size());
+    static utl_lz_dec_t d;
+    for (auto _ : state) {
+        utl_lz_dec_init(&d, img->size(), sink_nulo, nullptr);
+        for (size_t pos = 0; pos < z.size(); pos += CHUNK)
+            utl_lz_dec_feed(&d, &z[pos], std::min(CHUNK, z.size() - pos));
+        benchmark::DoNotOptimize(d.out_done);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * img->size()));
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> nomes;
+    std::vector<std::vector<uint8_t>> imagens;
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') continue; // Opções da Google Benchmark
+        nomes.push_back(argv[i]);
+    }
+    if (nomes.empty()) nomes.push_back("/proc/self/exe");
+    for (auto &n : nomes) {
+        std::ifstream f(n, std::ios::binary);
+        std::vector<uint8_t> v((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        if (v.empty()) {
+            printf("[FALHA] %s vazio ou ilegível\n", n.c_str());
+            return 1;
+        }
+        imagens.push_back(std::move(v));
+    }
+
+    if (!confere(imagens)) return 1;
+    printf("utl_lz (janela %d) confere com lz_host.hpp.\n", UTL_LZ_WINDOW);
+
+    for (size_t k = 0; k < imagens.size(); k++) {
+        size_t n = imagens[k].size();
+        size_t z = lzh::compress(imagens[k].data(), n).size();
+        printf("%s: %zu -> %zu bytes (%.1f%%), chunks de %zu: %zu -> %zu frames\n", nomes[k].c_str(), n, z,
+               100.0 * z / n, CHUNK, (n + CHUNK - 1) / CHUNK, (z + CHUNK - 1) / CHUNK);
+        benchmark::RegisterBenchmark(("lz/compress/" + std::to_string(k)).c_str(), bm_compress, &imagens[k]);
+        benchmark::RegisterBenchmark(("lz/decompress/" + std::to_string(k)).c_str(), bm_decompress, &imagens[k]);
+    }
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
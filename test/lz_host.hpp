@@ -0,0 +1,135 @@
+/* lz_host.hpp - Compressor do OTA comprimido (formato do utl_lz) para o lado Host
+ *
+ * Gera o stream que o utl_lz_dec_feed do firmware descomprime: sequências do LZ4 (token,
+ * literais, offset de 2 bytes, extensões de 255) com offsets limitados à janela do
+ * decodificador, UTL_LZ_WINDOW. Como a janela é pequena, a busca pode ser bem mais funda
+ * que a do LZ4: cadeias de hash de 4 bytes, até 'depth' candidatos por posição, e match
+ * preguiçoso (se a posição seguinte tem um match maior, a corrente vira literal).
+ * A última sequência só tem literais (ou o stream acaba no fim de um match).
+ *
+ * Header-only, só depende de utl_lz.h (os defines do formato).
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+    #include "utl_lz.h"
+}
+
+namespace lzh {
+
+static constexpr unsigned HASH_BITS = 14;
+
+struct Match {
+    size_t len = 0;
+    size_t off = 0;
+};
+
+class Compressor {
+public:
+    explicit Compressor(size_t window = UTL_LZ_WINDOW, int depth = 256)
+        : window_(window), depth_(depth), head_(1u << HASH_BITS), prev_(window) {}
+
+    std::vector<uint8_t> compress(const uint8_t *p, size_t n)
+    {
+        std::vector<uint8_t> out;
+        out.reserve(n / 2 + 16);
+        std::fill(head_.begin(), head_.end(), -1);
+        std::fill(prev_.begin(), prev_.end(), -1);
+
+        size_t lit = 0; // Início dos literais pendentes
+        size_t i = 0;
+        while (i + UTL_LZ_MIN_MATCH <= n) {
+            Match m = find(p, n, i);
+            if (m.len < UTL_LZ_MIN_MATCH) {
+                insert(p, i++);
+                continue;
+            }
+            // Preguiçoso: um match melhor começando no próximo byte ganha
+            insert(p, i);
+            if (i + 1 + UTL_LZ_MIN_MATCH <= n) {
+                Match next = find(p, n, i + 1);
+                if (next.len > m.len + 1) {
+                    i++;
+                    continue;
+                }
+            }
+            emit(out, p + lit, i - lit, m);
+            for (size_t k = 1; k < m.len && i + k + UTL_LZ_MIN_MATCH <= n; k++) insert(p, i + k);
+            i += m.len;
+            lit = i;
+        }
+        if (lit < n || out.empty()) emit(out, p + lit, n - lit, Match{});
+        return out;
+    }
+
+private:
+    size_t window_;
+    int depth_;
+    std::vector<int32_t> head_;
+    std::vector<int32_t> prev_;
+
+    static uint32_t hash(const uint8_t *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    void insert(const uint8_t *p, size_t i)
+    {
+        uint32_t h = hash(p + i);
+        prev_[i % window_] = head_[h];
+        head_[h] = (int32_t)i;
+    }
+
+    Match find(const uint8_t *p, size_t n, size_t i) const
+    {
+        Match best;
+        int32_t c = head_[hash(p + i)];
+        for (int d = 0; c >= 0 && d < depth_; d++) {
+            size_t off = i - (size_t)c;
+            if (off > window_) break;
+            size_t len = 0;
+            while (i + len < n && p[c + len] == p[i + len]) len++;
+            if (len > best.len) {
+                best.len = len;
+                best.off = off;
+            }
+            int32_t nc = prev_[(size_t)c % window_];
+            if (nc >= c) break; // Entrada já reciclada pelo anel
+            c = nc;
+        }
+        return best;
+    }
+
+    static void put_ext(std::vector<uint8_t> &out, size_t v)
+    {
+        for (; v >= 255; v -= 255) out.push_back(255);
+        out.push_back((uint8_t)v);
+    }
+
+    // Uma sequência: literais e, se m.len != 0, o match
+    static void emit(std::vector<uint8_t> &out, const uint8_t *lit, size_t nlit, const Match &m)
+    {
+        size_t ml = m.len ? m.len - UTL_LZ_MIN_MATCH : 0;
+        out.push_back((uint8_t)(((nlit < 15 ? nlit : 15) << 4) | (ml < 15 ? ml : 15)));
+        if (nlit >= 15) put_ext(out, nlit - 15);
+        out.insert(out.end(), lit, lit + nlit);
+        if (!m.len) return;
+        out.push_back((uint8_t)m.off);
+        out.push_back((uint8_t)(m.off >> 8));
+        if (ml >= 15) put_ext(out, ml - 15);
+    }
+};
+
+inline std::vector<uint8_t> compress(const uint8_t *p, size_t n)
+{
+    return Compressor().compress(p, n);
+}
+
+} // namespace lzh
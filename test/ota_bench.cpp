@@ -0,0 +1,489 @@
+/* ota_bench.cpp - OTA de ponta a ponta: o ota_handler.c do firmware contra flash e escritor simulados
+ *
+ * Roda o ota_handler.c inteiro no host (ota_sim/: Zephyr, flash do F411 e RAM retida
+ * simulados; Hub e escritor numa thread só, o escritor anda quando o teste manda) e faz
+ * o papel do mestre. Confere:
+ *  - janela: chunks fora de ordem, perdidos e repetidos (inclusive abaixo de next_offset),
+ *    com o escritor andando aos poucos; imagem crua, --lz e --delta, páginas de 16 KiB e o
+ *    setor único de 128 KiB do F411; resets no meio (crua retoma pelo OTA_STATUS, as
+ *    outras recomeçam do START);
+ *  - fila do escritor cheia e o resto na janela quando o END chega: o END fica pendente e
+ *    o resto anda a cada lugar que o escritor abre;
+ *  - retomada com next_offset no meio de um chunk: o chunk vai inteiro, só o resto grava;
+ *  - erro de flash no escritor no meio da sessão: OTA_STATUS, chunks e END devolvem o erro,
+ *    e o START seguinte começa limpo;
+ *  - START e END com resposta adiada: OTA_STATUS ocupado, END repetido, START no meio;
+ *  - SHA-256 ou CRC errados e byte mal gravado: sem swap; patch para outra base: nada gravado.
+ * Depois mede quanto Hub + escritor custam por imagem (crua e --lz, chunks de 48 e 245).
+ *
+ * Uso: ota_bench [imagem.bin] (sem imagem: o começo do próprio executável)
+ *
+ * Build (a partir de test/, precisa da Google Benchmark):
+ *   gcc -O2 -c -Iota_sim -I../include -I../utl -I../src ota_sim/ota_sim.c ../utl/utl_crc16.c ../utl/utl_lz.c
+ *       ../utl/utl_delta.c ../utl/utl_varint.c ../utl/utl_sha256.c
+ *   g++ -O2 -std=c++17 -Iota_sim -I../include -I../utl ota_bench.cpp ota_sim.o utl_crc16.o utl_lz.o utl_delta.o
+ *       utl_varint.o utl_sha256.o -lbenchmark -lpthread -o ota_bench
+ *   ./ota_bench blackpill_v1.2.3.bin
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <zephyr/app_version.h>
+#include "ota_sim.h"
+#include "cmd.h"
+#include "utl_sha256.h"
+#include "crc16_host.hpp"
+#include "delta_host.hpp"
+#include "lz_host.hpp"
+
+static const uint32_t PAGINA = 16 * 1024;
+static const uint32_t SETOR = OTA_SIM_SLOT; // slot1 do F411: um setor só
+static const uint32_t VERSAO = deltah::version(APP_VERSION_MAJOR, APP_VERSION_MINOR, APP_PATCHLEVEL);
+
+static bool falha(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    printf("[FALHA] ");
+    vprintf(fmt, ap);
+    printf("\n");
+    va_end(ap);
+    return false;
+}
+
+// O que vai no slot1 e o que os chunks levam
+struct Imagem {
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> stream;
+    std::vector<uint8_t> base; // --delta: o que está no slot0
+    uint8_t flags = 0;
+    uint8_t sha[UTL_SHA256_SIZE];
+    uint16_t crc = 0; // CRC-16 do stream (END e OTA_STATUS)
+
+    uint32_t image_size() const { return flags ? (uint32_t)bytes.size() : 0; }
+};
+
+static Imagem prepara(const std::vector<uint8_t> &img, uint8_t flags, const std::vector<uint8_t> &base = {})
+{
+    Imagem im;
+    im.bytes = img;
+    im.flags = flags;
+    im.base = base;
+    im.stream = img;
+    if (flags & CMD_OTA_FLAG_DELTA) im.stream = deltah::diff(base, img, VERSAO);
+    if (flags & CMD_OTA_FLAG_LZ) im.stream = lzh::compress(im.stream.data(), im.stream.size());
+    utl_sha256_data(img.data(), img.size(), im.sha);
+    im.crc = crc16h::data(im.stream.data(), im.stream.size());
+    return im;
+}
+
+static void instala_base(const Imagem &im)
+{
+    memset(ota_sim.slot0, 0xFF, sizeof(ota_sim.slot0));
+    std::copy(im.base.begin(), im.base.end(), ota_sim.slot0);
+}
+
+// Nova versão a partir de uma base: bytes trocados e trechos inseridos / removidos
+static std::vector<uint8_t> nova_versao(const std::vector<uint8_t> &base, std::mt19937 &rng, size_t max)
+{
+    std::vector<uint8_t> v;
+    for (size_t i = 0; i < base.size() && v.size() < max; i++) {
+        uint32_t r = rng() % 4000;
+        if (r == 0) v.insert(v.end(), 1 + rng() % 48, (uint8_t)rng());
+        else if (r == 1) i += rng() % 64;
+        else v.push_back((rng() % 700 == 0) ? (uint8_t)rng() : base[i]);
+    }
+    if (v.empty()) v.push_back(0);
+    v.resize(std::min(v.size(), max));
+    return v;
+}
+
+// --- MESTRE ---
+// START como o Hub atende: a resposta só sai quando o escritor acaba de apagar o slot, e
+// enquanto isso o OTA_STATUS diz ocupado e outro START é recusado
+static int start(const Imagem &im, uint16_t chunk)
+{
+    int ret = ota_start(im.stream.size(), chunk, im.image_size(), im.flags);
+    if (ret != OTA_PENDING) return ret;
+
+    ota_status_t st;
+    int outro;
+    int wakes = ota_sim.wakes;
+    if (ota_get_status(&st) != -EBUSY || ota_start(im.stream.size(), chunk, im.image_size(), im.flags) != -EBUSY ||
+        ota_take_result(&outro) || ota_result_ready()) {
+        falha("START pendente: OTA_STATUS / START repetido / resultado antes do escritor");
+        return -EPROTO;
+    }
+    ota_sim_writer_run(-1);
+    if (ota_sim.wakes != wakes + 1 || !ota_take_result(&ret) || ota_take_result(&outro)) {
+        falha("START: o escritor não publicou o resultado uma vez só");
+        return -EPROTO;
+    }
+    return ret;
+}
+
+// END como o Hub atende: pendente até o escritor fechar a imagem; END repetido, START e
+// OTA_STATUS nesse meio tempo não mexem em nada. O Hub só volta ao OTA quando o escritor o
+// acorda (lugar na fila para o resto da janela, ou o resultado); o escritor anda um job por vez.
+static int end(const Imagem &im, const uint8_t *sha, uint16_t crc)
+{
+    int ret = ota_finish(sha, crc);
+    if (ret != OTA_PENDING) return ret;
+
+    ota_status_t st;
+    int outro;
+    if (ota_finish(sha, crc) != -EINPROGRESS || ota_get_status(&st) != -EBUSY ||
+        ota_start(im.stream.size(), 0, im.image_size(), im.flags) != -EBUSY || ota_take_result(&outro)) {
+        falha("END pendente: END repetido / OTA_STATUS / START no meio");
+        return -EPROTO;
+    }
+    for (;;) {
+        int wakes = ota_sim.wakes;
+        int jobs = ota_sim_writer_run(1);
+        if (ota_sim.wakes != wakes && !ota_result_ready()) {
+            falha("END: o escritor acordou o Hub sem nada para ele");
+            return -EPROTO;
+        }
+        if (ota_result_ready()) {
+            if (ota_take_result(&ret)) break;
+        } else if (jobs == 0) {
+            falha("END parado: fila vazia e o Hub sem aviso");
+            return -EPROTO;
+        }
+    }
+    if (ota_take_result(&outro) || ota_result_ready()) {
+        falha("END: resultado publicado mais de uma vez");
+        return -EPROTO;
+    }
+    return ret;
+}
+
+static int chunk(const Imagem &im, uint32_t off, uint16_t size)
+{
+    return ota_write_chunk(off, &im.stream[off], std::min<size_t>(size, im.stream.size() - off));
+}
+
+// Retoma pelo OTA_STATUS se o escravo tem esta imagem pela metade (como o ota_master),
+// senão START. Devolve o chunk da sessão, 0 se o START falhou.
+static uint16_t retoma_ou_comeca(const Imagem &im, uint16_t chunk_size, bool *retomou)
+{
+    ota_status_t st;
+    *retomou = ota_get_status(&st) == 0 && st.total_size == im.stream.size() &&
+               st.image_crc == crc16h::data(im.stream.data(), st.next_offset);
+    if (*retomou) return st.chunk_size;
+    return (start(im, chunk_size) == 0) ? (chunk_size ? chunk_size : CMD_OTA_CHUNK_SIZE_DEFAULT) : 0;
+}
+
+struct Janela {
+    int perda = 5;     // 1 em N chunks do mapa se perde
+    int repete = 6;    // 1 em N vai duas vezes
+    int reset = 0;     // 1 em N rodadas o escravo reseta (0 = nunca)
+    int resets_max = 1000;
+    int escritor = 3;  // O escritor pega até N - 1 jobs entre chunks
+    int resets = 0, retomadas = 0, rodadas = 0;
+};
+
+// Modo janela: manda o que o mapa pede, fora de ordem, até next_offset chegar no fim
+static bool janela(const Imagem &im, uint16_t chunk_size, Janela &j, std::mt19937 &rng)
+{
+    const uint32_t total = im.stream.size();
+    ota_status_t st;
+    if (ota_get_status(&st) != 0) return falha("OTA_STATUS logo depois do START");
+    chunk_size = st.chunk_size;
+
+    while (st.next_offset < total) {
+        uint32_t first = st.next_offset / chunk_size;
+        std::vector<uint32_t> faltam;
+        for (uint32_t i = 0; i < CMD_OTA_WINDOW_CHUNKS; i++)
+            if (st.missing & (1u << i)) faltam.push_back((first + i) * chunk_size);
+        std::shuffle(faltam.begin(), faltam.end(), rng);
+
+        for (uint32_t off : faltam) {
+            if (rng() % j.perda == 0) continue;
+            int vezes = (rng() % j.repete == 0) ? 2 : 1;
+            for (int v = 0; v < vezes; v++)
+                if (chunk(im, off, chunk_size) != 0) return falha("chunk %u recusado", off);
+            // Retransmissão de algo já entregue: aceita e ignorada
+            if (st.next_offset >= chunk_size && rng() % 8 == 0) {
+                uint32_t velho = (rng() % (st.next_offset / chunk_size)) * chunk_size;
+                if (chunk(im, velho, chunk_size) != 0) return falha("chunk repetido %u recusado", velho);
+            }
+            ota_sim_writer_run(rng() % j.escritor);
+        }
+
+        if (j.reset && j.resets < j.resets_max && rng() % j.reset == 0) {
+            ota_sim_reset();
+            j.resets++;
+            bool retomou;
+            chunk_size = retoma_ou_comeca(im, chunk_size, &retomou);
+            if (chunk_size == 0) return falha("START depois do reset");
+            j.retomadas += retomou;
+        }
+        ota_sim_writer_run(rng() % (j.escritor + 1));
+
+        if (ota_get_status(&st) != 0) return falha("OTA_STATUS em %u", st.next_offset);
+        if (st.total_size != total || st.chunk_size != chunk_size) return falha("OTA_STATUS: sessão trocada");
+        if (st.image_crc != crc16h::data(im.stream.data(), st.next_offset))
+            return falha("OTA_STATUS: CRC em %u", st.next_offset);
+        if (++j.rodadas > 200000) return falha("janela parada em %u de %u", st.next_offset, total);
+    }
+    return true;
+}
+
+// Slot1 igual à imagem, nada gravado duas vezes, trailer apagado e cursor descartado
+static bool slot_confere(const Imagem &im, int upgrades)
+{
+    size_t n = im.bytes.size();
+    if (ota_sim.upgrades != upgrades + 1) return falha("swap não agendado");
+    if (memcmp(ota_sim.slot1, im.bytes.data(), n) != 0) return falha("slot1 diferente da imagem");
+    if (ota_sim.overwrites || ota_sim.bad_access)
+        return falha("%d bytes gravados sem apagar, %d acessos fora", ota_sim.overwrites, ota_sim.bad_access);
+    for (size_t i = std::max<size_t>(n, OTA_SIM_SLOT - ota_sim.page); i < OTA_SIM_SLOT; i++)
+        if (ota_sim_programmed(i) || ota_sim.slot1[i] != 0xFF) return falha("página do trailer não apagada (%zu)", i);
+    if (ota_sim_cursor_valid()) return falha("cursor ficou depois do END");
+    return true;
+}
+
+// --- CONFERÊNCIA ---
+static bool confere_janela(const std::vector<uint8_t> &fonte, std::mt19937 &rng)
+{
+    static const char *nome[] = {"crua", "--lz", "--delta"};
+    static const uint8_t flags[] = {0, CMD_OTA_FLAG_LZ, CMD_OTA_FLAG_LZ | CMD_OTA_FLAG_DELTA};
+
+    for (int t = 0; t < 30; t++) {
+        int modo = t % 3;
+        size_t n = 1 + rng() % std::min<size_t>(fonte.size(), OTA_SIM_SLOT - PAGINA);
+        size_t ini = rng() % (fonte.size() - n + 1);
+        std::vector<uint8_t> img(fonte.begin() + ini, fonte.begin() + ini + n);
+        Imagem im = (modo == 2) ? prepara(nova_versao(img, rng, OTA_SIM_SLOT - PAGINA), flags[modo], img)
+                                : prepara(img, flags[modo]);
+        uint16_t chunk_size = (t % 5 == 0) ? 0 : 1 + rng() % CMD_OTA_CHUNK_DATA_MAX;
+
+        ota_sim_power_on((t % 2) ? SETOR : PAGINA);
+        instala_base(im);
+        Janela j;
+        j.reset = modo ? 20 : 8;
+        j.resets_max = modo ? 2 : 1000; // --lz e --delta recomeçam do zero
+        if (start(im, chunk_size) != 0) return falha("janela %d: START", t);
+        if (!janela(im, chunk_size, j, rng)) return falha("janela %d (%s, %zu bytes)", t, nome[modo], im.bytes.size());
+        if (end(im, im.sha, im.crc) != 0) return falha("janela %d: END", t);
+        if (!slot_confere(im, 0)) return falha("janela %d (%s)", t, nome[modo]);
+        if (t < 6)
+            printf("janela %s: %zu bytes, stream %zu, chunk %u, página %u KiB: %d rodadas, %d resets (%d retomados)\n",
+                   nome[modo], im.bytes.size(), im.stream.size(), chunk_size ? chunk_size : CMD_OTA_CHUNK_SIZE_DEFAULT,
+                   ota_sim.page / 1024, j.rodadas, j.resets, j.retomadas);
+    }
+    return true;
+}
+
+// Escritor parado: a fila enche (OTA_WRITE_QUEUE_LEN chunks) e o resto espera na janela.
+// Passo a passo (ACK = recebido) o END vem logo depois do último chunk: fica pendente e o
+// resto vai conforme o escritor abre lugar, com o Hub livre nesse meio tempo.
+static bool confere_fila_cheia(const std::vector<uint8_t> &fonte)
+{
+    const uint16_t C = CMD_OTA_CHUNK_SIZE_DEFAULT;
+    const uint32_t chunks = CMD_OTA_WINDOW_CHUNKS + 8;
+    Imagem im = prepara(std::vector<uint8_t>(fonte.begin(), fonte.begin() + chunks * C - 5), 0);
+
+    for (int falta_um = 0; falta_um < 2; falta_um++) {
+        ota_sim_power_on(SETOR);
+        if (start(im, C) != 0) return falha("fila cheia: START");
+        for (uint32_t k = 0; k < chunks; k++) {
+            if (falta_um && k == chunks / 2) continue;
+            if (chunk(im, k * C, C) != 0) return falha("fila cheia: chunk %u recusado", k);
+        }
+        ota_status_t st;
+        if (ota_sim_queue_used() != 8 || ota_get_status(&st) != 0 || st.next_offset != 8 * C)
+            return falha("fila cheia: fila %u, next_offset %u", ota_sim_queue_used(), st.next_offset);
+
+        int ret = end(im, im.sha, im.crc);
+        if (falta_um) {
+            // O END recusa na hora, sem esperar o escritor; o chunk que faltava completa e o END passa
+            if (ret != -EAGAIN || ota_get_status(&st) != 0 || st.next_offset != 8 * C)
+                return falha("fila cheia com buraco: END %d, next_offset %u", ret, st.next_offset);
+            if (chunk(im, chunks / 2 * C, C) != 0) return falha("fila cheia: chunk do buraco");
+            ret = end(im, im.sha, im.crc);
+        }
+        if (ret != 0 || !slot_confere(im, 0)) return falha("fila cheia: END %d", ret);
+    }
+    printf("fila cheia: END pendente com %u chunks na fila e %u na janela grava tudo.\n", 8, chunks - 8);
+    return true;
+}
+
+// O cursor anda por bloco de OTA_SIM_BLOCK: com chunk de 100 a retomada cai no meio de um
+static bool confere_retomada(const std::vector<uint8_t> &fonte, std::mt19937 &rng)
+{
+    const uint16_t C = 100;
+    Imagem im = prepara(std::vector<uint8_t>(fonte.begin(), fonte.begin() + 10000), 0);
+
+    ota_sim_power_on(PAGINA);
+    if (start(im, C) != 0) return falha("retomada: START");
+    for (uint32_t off = 0; off < 3000; off += C) {
+        if (chunk(im, off, C) != 0) return falha("retomada: chunk %u", off);
+        ota_sim_writer_run(-1);
+    }
+
+    ota_sim_reset();
+    ota_status_t st;
+    uint32_t gravado = 3000 / OTA_SIM_BLOCK * OTA_SIM_BLOCK;
+    if (ota_get_status(&st) != 0 || st.next_offset != gravado || st.chunk_size != C ||
+        st.image_crc != crc16h::data(im.stream.data(), gravado))
+        return falha("retomada: OTA_STATUS em %u (esperado %u)", st.next_offset, gravado);
+    if (st.next_offset % C == 0) return falha("retomada: next_offset devia cair no meio de um chunk");
+    if (st.missing & 1) {
+        // O chunk que contém next_offset vai inteiro; só o que passa dele é gravado
+        if (chunk(im, st.next_offset / C * C, C) != 0) return falha("retomada: chunk do meio");
+    }
+
+    Janela j;
+    if (!janela(im, C, j, rng) || end(im, im.sha, im.crc) != 0 || !slot_confere(im, 0))
+        return falha("retomada no meio do chunk");
+    printf("retomada: reset com %u bytes no flash (chunk %u), chunk do meio reenviado inteiro, imagem confere.\n",
+           gravado, C);
+    return true;
+}
+
+// Flash falha no meio: a sessão fica com o erro até o próximo START, que não o herda
+static bool confere_erro_escritor(const std::vector<uint8_t> &fonte, std::mt19937 &rng)
+{
+    const uint16_t C = 200;
+    Imagem im = prepara(std::vector<uint8_t>(fonte.begin(), fonte.begin() + 20000), 0);
+    ota_status_t st;
+
+    ota_sim_power_on(PAGINA);
+    ota_sim.fail_at = 7000;
+    if (start(im, C) != 0) return falha("erro: START");
+    uint32_t off = 0;
+    int ret = 0;
+    for (; off < im.stream.size() && ret == 0; off += C) {
+        ret = chunk(im, off, C);
+        ota_sim_writer_run(-1);
+    }
+    if (ret != -EIO || ota_get_status(&st) != -EIO || chunk(im, 0, C) != -EIO || end(im, im.sha, im.crc) != -EIO)
+        return falha("erro: chunk %d, OTA_STATUS / chunk / END sem o -EIO", ret);
+
+    // START novo: até o escritor pegá-lo, o -EIO é da sessão anterior
+    if (ota_start(im.stream.size(), C, 0, 0) != OTA_PENDING || chunk(im, 0, C) != 0 || ota_get_status(&st) != -EBUSY)
+        return falha("erro: START seguinte herdou o erro");
+    ota_sim_writer_run(-1);
+    if (!ota_take_result(&ret) || ret != 0) return falha("erro: START seguinte %d", ret);
+    Janela j;
+    if (!janela(im, C, j, rng) || end(im, im.sha, im.crc) != 0 || !slot_confere(im, 0))
+        return falha("erro: sessão depois do erro");
+
+    // Erro no último bloco, que só é gravado pelo FINISH: vem no resultado adiado do END
+    ota_sim_power_on(PAGINA);
+    ota_sim.fail_at = im.stream.size() - 1;
+    j = Janela();
+    if (start(im, C) != 0 || !janela(im, C, j, rng)) return falha("erro no FINISH: envio");
+    if ((ret = end(im, im.sha, im.crc)) != -EIO || ota_sim.upgrades != 0) return falha("erro no FINISH: END %d", ret);
+
+    printf("erro do escritor: -EIO no OTA_STATUS, nos chunks e no END; o START seguinte começa limpo.\n");
+    return true;
+}
+
+static bool confere_digest(const std::vector<uint8_t> &fonte, std::mt19937 &rng)
+{
+    const uint16_t C = 240;
+    Imagem im = prepara(std::vector<uint8_t>(fonte.begin(), fonte.begin() + 20000), 0);
+    uint8_t ruim[UTL_SHA256_SIZE];
+    memcpy(ruim, im.sha, sizeof(ruim));
+    ruim[31] ^= 1;
+
+    for (int k = 0; k < 4; k++) {
+        ota_sim_power_on(PAGINA);
+        if (k == 3) ota_sim.flip_at = 12345; // Byte que o flash não gravou certo
+        Janela j;
+        if (start(im, C) != 0 || !janela(im, C, j, rng)) return falha("digest %d: envio", k);
+        int ret = (k == 0) ? end(im, ruim, im.crc)
+                : (k == 1) ? end(im, im.sha, im.crc ^ 1)
+                : (k == 2) ? end(im, nullptr, 0)
+                           : end(im, im.sha, im.crc);
+        int esperado = (k == 2) ? 0 : -EILSEQ;
+        if (ret != esperado || ota_sim.upgrades != (k == 2))
+            return falha("digest %d: END %d, swaps %d", k, ret, ota_sim.upgrades);
+        // Depois do resultado a sessão acabou: END de novo só pelo cache de replay do Hub
+        if (k != 1 && end(im, im.sha, im.crc) != -EPERM) return falha("digest %d: END depois do resultado", k);
+    }
+
+    // Patch para outra base: o escritor recusa antes de gravar qualquer byte
+    std::vector<uint8_t> base(fonte.begin(), fonte.begin() + 50000);
+    Imagem delta = prepara(nova_versao(base, rng, 60000), CMD_OTA_FLAG_LZ | CMD_OTA_FLAG_DELTA, base);
+    ota_sim_power_on(PAGINA);
+    instala_base(delta);
+    ota_sim.slot0[base.size() - 1] ^= 0x80;
+    if (start(delta, C) != 0) return falha("base errada: START");
+    for (uint32_t off = 0; off < delta.stream.size(); off += C) {
+        chunk(delta, off, C);
+        ota_sim_writer_run(-1);
+    }
+    ota_status_t st;
+    for (uint32_t i = 0; i < delta.bytes.size(); i++)
+        if (ota_sim_programmed(i)) return falha("base errada: gravou o byte %u", i);
+    if (ota_get_status(&st) != -ENOEXEC || end(delta, delta.sha, delta.crc) != -ENOEXEC)
+        return falha("base errada: sem -ENOEXEC");
+
+    printf("digest: SHA-256 / CRC errados e byte mal gravado sem swap; patch para outra base não grava nada.\n");
+    return true;
+}
+
+static bool confere(const std::vector<uint8_t> &fonte)
+{
+    std::mt19937 rng(22);
+    return confere_janela(fonte, rng) && confere_fila_cheia(fonte) && confere_retomada(fonte, rng) &&
+           confere_erro_escritor(fonte, rng) && confere_digest(fonte, rng);
+}
+
+// --- BENCHMARKS ---
+// Uma imagem inteira em ordem, o escritor andando a cada chunk: CPU do Hub + escritor
+static void bm_ota(benchmark::State &state, const Imagem *im, uint16_t chunk_size)
+{
+    for (auto _ : state) {
+        ota_sim_power_on(SETOR);
+        start(*im, chunk_size);
+        for (uint32_t off = 0; off < im->stream.size(); off += chunk_size) {
+            chunk(*im, off, chunk_size);
+            ota_sim_writer_run(-1);
+        }
+        benchmark::DoNotOptimize(end(*im, im->sha, im->crc));
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * im->bytes.size()));
+}
+
+int main(int argc, char **argv)
+{
+    std::string nome = "/proc/self/exe";
+    for (int i = 1; i < argc; i++)
+        if (argv[i][0] != '-') nome = argv[i]; // O resto é da Google Benchmark
+
+    std::ifstream f(nome, std::ios::binary);
+    std::vector<uint8_t> fonte((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if (fonte.size() < 60000) {
+        printf("[FALHA] %s: precisa de pelo menos 60000 bytes\n", nome.c_str());
+        return 1;
+    }
+
+    if (!confere(fonte)) return 1;
+    printf("ota_handler confere (janela %u chunks, flash simulado).\n", CMD_OTA_WINDOW_CHUNKS);
+
+    size_t n = std::min<size_t>(fonte.size(), OTA_SIM_SLOT - PAGINA);
+    static std::vector<uint8_t> img(fonte.begin(), fonte.begin() + n);
+    static Imagem crua = prepara(img, 0), lz = prepara(img, CMD_OTA_FLAG_LZ);
+    for (uint16_t c : {CMD_OTA_CHUNK_SIZE_DEFAULT, CMD_OTA_CHUNK_DATA_MAX}) {
+        benchmark::RegisterBenchmark(("ota/crua/" + std::to_string(c)).c_str(), bm_ota, &crua, c);
+        benchmark::RegisterBenchmark(("ota/lz/" + std::to_string(c)).c_str(), bm_ota, &lz, c);
+    }
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
@@ -1,7 +1,32 @@
-/* ota_update.cpp - VERSÃO DEBUG HARDCORE */
+/* ota_update.cpp - VERSÃO DEBUG HARDCORE
+ *
+ * Uso: ota_master <imagem.bin> [--passo] [--chunk N] [--lz] [--delta <base.bin | diretório>]
+ * Padrão = modo janela: chunks sem tag, em rajada, até a janela do escravo à frente do
+ * que ele já gravou; a cada rajada um OTA_STATUS traz o ACK cumulativo e o mapa do
+ * que falta, e só isso é reenviado (junto com o que a janela abriu). O tamanho do chunk
+ * vai no START: N bytes (padrão CMD_OTA_CHUNK_DATA_MAX, o frame de chunk enche o payload).
+ * Antes do START um OTA_STATUS pergunta se o escravo tem esta imagem pela metade (mesmo
+ * tamanho, CRC do que já gravou igual ao da imagem local até ali, cursor retido num
+ * reset): se tiver, segue de onde ele parou, com o chunk dele, sem START.
+ * --lz = manda a imagem comprimida (lz_host.hpp, formato do utl_lz): os chunks levam o
+ * stream e o escravo descomprime direto para o flash. Sem retomada; se a imagem não
+ * encolhe, vai crua.
+ * --delta = manda só o patch (delta_host.hpp, formato do utl_delta) da imagem que está
+ * rodando para a nova, comprimido como no --lz; o escravo aplica sobre o slot0. A versão
+ * instalada vem do VERSION_RES: num diretório, a base é o blackpill_v<versão>.bin dele.
+ * O escravo confere versão e CRC da base antes de gravar; se o patch não sai menor, vai
+ * como --lz. Sem retomada.
+ * --passo = chunks de CMD_OTA_CHUNK_SIZE_DEFAULT, um por vez, esperando o ACK de cada um
+ * (START antigo, serve para firmware sem OTA_STATUS). O ACK do chunk quer dizer "recebido"
+ * (na janela ou na fila do escritor), não "gravado": só o ACK do END confirma a gravação.
+ * O END leva o CRC-16 do stream e o SHA-256 da imagem: o escravo só agenda o swap se o
+ * que ele gravou bate (senão responde CMD_ERR_CHECKSUM). No --passo o END vai vazio.
+ * Linkar com utl_sha256.c. READY e ATTN são as linhas 25 e 24 do /dev/gpiochip0 (hub_link.hpp).
+ */
 #include <fcntl.h>
 #include <unistd.h>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <cstdint>
 #include <sys/ioctl.h>
@@ -11,122 +36,261 @@
 #include <thread>
 #include <chrono>
 #include <vector>
+#include <string>
+#include <iterator>
 #include <fstream>
-#include "hal_gpio.hpp" 
-
-extern "C" {
-    #include "cmd.h"
-}
+#include <algorithm>
+#include "hub_link.hpp"
+#include "crc16_host.hpp"
+#include "lz_host.hpp"
+#include "delta_host.hpp"
+#include "utl_sha256.h"
 
 static const char *DEVICE = "/dev/spidev0.0";
 static const int GPIO_READY_PIN = 25; 
+static const int GPIO_ATTN_PIN = 24;
 static const uint8_t SPI_MODE = SPI_MODE_0;
 static const uint8_t BITS = 8;
 static const uint32_t SPEED = 100000; 
-static const int CHUNK_DATA_SIZE = 48; 
+// Modo janela: pausa quando não há o que reenviar, e quanto tempo sem avançar é desistir
+static const auto OTA_ESPERA_ESCRITOR = std::chrono::milliseconds(20);
+static const auto OTA_PARADO_MAX = std::chrono::seconds(10);
+// START e END só são respondidos quando o escritor acaba: apagar o slot (um setor de
+// 128 KiB do F411 leva até ~2 s, com a CPU parada) ou fechar e conferir a imagem
+static const long OTA_RES_LENTO_NS = 5000000000L;
 
 int fd_spi;
-HalGpio *slave_ready_ptr;
+HubLink *link_ptr;
 uint8_t tx_buf[300]; 
 uint8_t rx_buf[300];
 
-int spi_transaction() {
-    struct spi_ioc_transfer tr;
-    memset(&tr, 0, sizeof(tr));
-    tr.tx_buf = (unsigned long)tx_buf;
-    tr.rx_buf = (unsigned long)rx_buf;
-    tr.len = 64; 
-    tr.speed_hz = SPEED;
-    tr.bits_per_word = 8;
-
-    int retries = 500; 
-    while (!slave_ready_ptr->get()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        retries--;
-        if (retries <= 0) {
-            printf("\n[FATAL] Timeout Hardware: STM32 não levantou pino Ready!\n");
-            return -1;
+// Envia um pedido e lê enquanto o slave sinalizar ATTN, até o OTA_RES com a MESMA
+// sequência. Respostas de outras sequências (atrasadas ou de retries anteriores) são
+// descartadas em vez de confundidas com o ACK. Retries reusam a sequência: se o slave já
+// executou o pedido (só o ACK se perdeu), ele responde do cache de replay sem regravar.
+bool enviar_pedido(cmd_ids_t id, cmd_cmds_t *cmd) {
+    uint8_t seq = frame_batch_next_seq();
+
+    for (int retry = 0; retry < 3; retry++) {
+        memset(tx_buf, 0, 64);
+        size_t len = 0;
+        if (!frame_batch_encode(tx_buf, 64, &len, ADDR_MASTER, ADDR_SLAVE, seq, id, cmd)) return false;
+
+        printf("\n   [DEBUG] Aguardando ACK para CMD %02X (seq %d)...", id, seq);
+
+        bool ack = false;
+        bool nack = false;
+        bool lento = (id == CMD_OTA_START_REQ_ID || id == CMD_OTA_END_REQ_ID);
+        int ret = link_ptr->round_trip(tx_buf, len, rx_buf, [&](const uint8_t *rx, size_t rx_len) {
+            frame_batch_for_each(rx, rx_len, [&](uint8_t, uint8_t, uint8_t res_seq, cmd_ids_t res_id, const cmd_cmds_t &res) {
+                if (res_id != CMD_OTA_RES_ID) {
+                    printf("-> ID Inesperado (%02X)", res_id);
+                    return;
+                }
+                if (res_seq != seq || res.action_res.cmd_req_id != id) {
+                    printf("-> Resposta antiga descartada (seq %d, req %02X)", res_seq, res.action_res.cmd_req_id);
+                    return;
+                }
+                if (res.action_res.status == CMD_OK) {
+                    ack = true;
+                } else {
+                    printf("-> Erro Lógico (Req: %02X Status: %d)", res.action_res.cmd_req_id, res.action_res.status);
+                    nack = true;
+                }
+            });
+            return ack || nack;
+        }, lento ? OTA_RES_LENTO_NS : HubLink::TIMEOUT_NS);
+
+        if (ret == -1) {
+            printf("\n[FATAL] Erro de link (READY não subiu ou ioctl falhou)!\n");
+            return false;
+        }
+        if (ack) {
+            printf("-> ACK OK!\n");
+            return true;
         }
+        if (nack) return false;
+
+        // ATTN não subiu: o pedido se perdeu antes de chegar no slave
+        printf("\n   [TIMEOUT] Último Buffer RX: ");
+        for(int i=0; i<10; i++) printf("%02X ", rx_buf[i]);
+        printf("\n[RETRY] CMD %02X seq %d.\n", id, seq);
     }
+    return false;
+}
 
-    // --- MUDANÇA CRÍTICA 1: Delay aumentado para 2ms ---
-    // Isso garante que o DMA do STM32 assumiu o bus MISO
-    std::this_thread::sleep_for(std::chrono::milliseconds(2)); 
-    
-    if (ioctl(fd_spi, SPI_IOC_MESSAGE(1), &tr) < 1) return -1;
-    return 0;
+bool enviar_chunk_seguro(uint32_t offset, std::vector<uint8_t> &dados) {
+    cmd_cmds_t cmd;
+    cmd.ota_chunk_req.offset = offset;
+    cmd.ota_chunk_req.len = dados.size();
+    memcpy(cmd.ota_chunk_req.data, dados.data(), dados.size());
+
+    return enviar_pedido(CMD_OTA_CHUNK_REQ_ID, &cmd);
 }
 
-bool esperar_ack(uint8_t cmd_esperado) {
-    int tentativas = 50; 
+// Pergunta o progresso do modo janela. Mesmo esquema de retry do enviar_pedido.
+// Retorna o status da resposta (CMD_ERR_INVALID_STATE = nenhum OTA em curso), ou -1.
+int consultar_status(cmd_ota_status_res_t *st) {
+    uint8_t seq = frame_batch_next_seq();
 
-    printf("\n   [DEBUG] Aguardando ACK para CMD %02X...", cmd_esperado);
+    for (int retry = 0; retry < 3; retry++) {
+        size_t len = 0;
+        cmd_cmds_t req;
+        if (!frame_batch_encode(tx_buf, sizeof(tx_buf), &len, ADDR_MASTER, ADDR_SLAVE, seq, CMD_OTA_STATUS_REQ_ID, &req))
+            return -1;
 
-    while (tentativas--) {
-        memset(tx_buf, 0, 64);
-        
-        if (spi_transaction() < 0) return false;
-
-        uint8_t id_recebido = rx_buf[2];
-
-        // --- MUDANÇA CRÍTICA 2: Dump do que foi recebido se não for zero ---
-        if (id_recebido != 0x00 && id_recebido != 0xFF) {
-            printf("\n   [RX DUMP] ");
-            for(int i=0; i<10; i++) printf("%02X ", rx_buf[i]);
-            
-            if (id_recebido == CMD_OTA_RES_ID) { // 0x5F
-                uint8_t req_originaria = rx_buf[5]; 
-                uint8_t status = rx_buf[6];
-
-                if (req_originaria == cmd_esperado && status == 0) {
-                    printf("-> ACK OK!\n");
-                    return true;
-                } else {
-                    printf("-> Erro Lógico (Req: %02X Status: %d)", req_originaria, status);
-                    // Não retorna false aqui, tenta de novo caso seja lixo
-                }
-            } else {
-                printf("-> ID Inesperado (%02X)", id_recebido);
-            }
+        int status = -1;
+        int ret = link_ptr->round_trip(tx_buf, len, rx_buf, [&](const uint8_t *rx, size_t rx_len) {
+            frame_batch_for_each(rx, rx_len, [&](uint8_t, uint8_t, uint8_t res_seq, cmd_ids_t res_id, const cmd_cmds_t &res) {
+                if (res_id != CMD_OTA_STATUS_RES_ID || res_seq != seq) return;
+                status = res.ota_status_res.status;
+                *st = res.ota_status_res;
+            });
+            return status >= 0;
+        });
+
+        if (ret == -1) {
+            printf("\n[FATAL] Erro de link (READY não subiu ou ioctl falhou)!\n");
+            return -1;
         }
-        
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (status >= 0) return status;
+        printf("\n[RETRY] OTA_STATUS seq %d.\n", seq);
+    }
+    return -1;
+}
+
+// Versão que está rodando no escravo (a base do --delta). Mesmo esquema de retry.
+bool consultar_versao(cmd_version_res_t *ver) {
+    uint8_t seq = frame_batch_next_seq();
+
+    for (int retry = 0; retry < 3; retry++) {
+        size_t len = 0;
+        cmd_cmds_t req;
+        if (!frame_batch_encode(tx_buf, sizeof(tx_buf), &len, ADDR_MASTER, ADDR_SLAVE, seq, CMD_VERSION_REQ_ID, &req))
+            return false;
+
+        bool ok = false;
+        int ret = link_ptr->round_trip(tx_buf, len, rx_buf, [&](const uint8_t *rx, size_t rx_len) {
+            frame_batch_for_each(rx, rx_len, [&](uint8_t, uint8_t, uint8_t res_seq, cmd_ids_t res_id, const cmd_cmds_t &res) {
+                if (res_id != CMD_VERSION_RES_ID || res_seq != seq) return;
+                *ver = res.version_res;
+                ok = true;
+            });
+            return ok;
+        });
+
+        if (ret == -1) {
+            printf("\n[FATAL] Erro de link (READY não subiu ou ioctl falhou)!\n");
+            return false;
+        }
+        if (ok) return true;
+        printf("\n[RETRY] VERSION seq %d.\n", seq);
     }
-    
-    // Imprime o último buffer lido mesmo se for zero, para sabermos
-    printf("\n   [TIMEOUT] Falha. Último Buffer RX: ");
-    for(int i=0; i<10; i++) printf("%02X ", rx_buf[i]);
-    printf("\n");
     return false;
 }
 
-bool enviar_chunk_seguro(uint32_t offset, std::vector<uint8_t> &dados) {
-    memset(tx_buf, 0, 64);
-    
-    cmd_ota_chunk_t chunk_pkt;
-    chunk_pkt.offset = offset;
-    chunk_pkt.len = dados.size();
-    memcpy(chunk_pkt.data, dados.data(), dados.size());
-
-    tx_buf[0] = ADDR_MASTER;
-    tx_buf[1] = ADDR_SLAVE;
-    tx_buf[2] = CMD_OTA_CHUNK_REQ_ID;
-    
-    uint16_t payload_len = 4 + 1 + dados.size();
-    tx_buf[3] = payload_len & 0xFF;
-    tx_buf[4] = (payload_len >> 8) & 0xFF;
-
-    memcpy(&tx_buf[5], &chunk_pkt, payload_len);
-
-    uint16_t crc = crc16_ccitt(tx_buf, 5 + payload_len);
-    tx_buf[5 + payload_len] = crc & 0xFF;       
-    tx_buf[5 + payload_len + 1] = crc >> 8;     
-
-    if (spi_transaction() < 0) return false;
-
-    if (!esperar_ack(CMD_OTA_CHUNK_REQ_ID)) {
+// Patch comprimido da imagem instalada para 'img'; vazio se a base não existe
+std::vector<uint8_t> montar_delta(const std::string &base_arg, const std::vector<uint8_t> &img) {
+    cmd_version_res_t ver;
+    if (!consultar_versao(&ver)) return {};
+
+    std::string caminho = base_arg;
+    struct stat sb;
+    if (stat(base_arg.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode)) {
+        char nome[64];
+        snprintf(nome, sizeof(nome), "/blackpill_v%u.%u.%u.bin", ver.major, ver.minor, ver.patch);
+        caminho += nome;
+    }
+    std::ifstream f(caminho, std::ios::binary);
+    std::vector<uint8_t> base((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    if (base.empty()) {
+        printf(">> Escravo em v%u.%u.%u, base %s não encontrada.\n", ver.major, ver.minor, ver.patch, caminho.c_str());
+        return {};
+    }
+
+    auto patch = deltah::diff(base, img, deltah::version(ver.major, ver.minor, ver.patch));
+    auto z = lzh::compress(patch.data(), patch.size());
+    printf(">> Delta sobre v%u.%u.%u (%s): patch de %zu bytes, comprimido %zu (%.1f%% da imagem)\n", ver.major,
+           ver.minor, ver.patch, caminho.c_str(), patch.size(), z.size(), 100.0 * z.size() / img.size());
+    return z;
+}
+
+// Retomada: o escravo ainda tem (mesmo depois de um reset) um OTA desta mesma imagem?
+// Confere tamanho e CRC do que ele já gravou contra a imagem local.
+bool pode_retomar(const std::vector<uint8_t> &img, uint32_t *chunk) {
+    cmd_ota_status_res_t st;
+    if (consultar_status(&st) != CMD_OK) return false;
+    if (st.total_size != img.size() || st.next_offset > img.size()) return false;
+    if (crc16h::data(img.data(), st.next_offset) != st.image_crc) {
+        printf(">> OTA no escravo é de outra imagem (CRC não bate).\n");
         return false;
     }
+    printf(">> Retomando em %u / %u bytes (chunks de %u).\n", st.next_offset, st.total_size, st.chunk_size);
+    *chunk = st.chunk_size;
+    return true;
+}
+
+// Modo janela: os frames dos chunks marcados em 'missing' (relativos a next_offset) vão
+// colados, cortados no tamanho da transação (o scanner do escravo remonta frame cortado
+// entre transações, então um chunk grande atravessa vários slots FIXED), e depois um
+// OTA_STATUS pergunta o progresso. O primeiro OTA_STATUS, antes de mandar qualquer coisa,
+// traz o mapa da janela inteira. Com a janela toda recebida e nada a reenviar, o escravo
+// ainda está gravando: espera um pouco antes de perguntar de novo. Para quando tudo foi entregue; desiste depois de
+// OTA_PARADO_MAX sem o escravo avançar.
+bool enviar_janela(const std::vector<uint8_t> &img, uint32_t chunk) {
+    const size_t cap = link_ptr->variable() ? CMD_LINK_MAX_BODY : CMD_LINK_FIXED_SIZE;
+    const uint32_t total = img.size();
+    std::vector<uint8_t> stream;
+    cmd_ota_status_res_t st;
+    auto avancou = std::chrono::steady_clock::now();
+    size_t enviados = 0;
+
+    if (consultar_status(&st) != CMD_OK) return false;
+
+    while (st.next_offset < total) {
+        // next_offset só cai no meio de um chunk depois de uma retomada: o chunk vai inteiro
+        uint32_t first = st.next_offset / chunk;
+        stream.clear();
+        for (uint32_t i = 0; i < CMD_OTA_WINDOW_CHUNKS; i++) {
+            uint32_t off = (first + i) * chunk;
+            if (off >= total) break;
+            if (!(st.missing & (1u << i))) continue;
+
+            cmd_cmds_t cmd;
+            cmd.ota_chunk_req.offset = off;
+            cmd.ota_chunk_req.len = std::min<uint32_t>(chunk, total - off);
+            memcpy(cmd.ota_chunk_req.data, &img[off], cmd.ota_chunk_req.len);
+
+            uint8_t frame[FRAME_MAX_CMD_SIZE];
+            size_t len = 0;
+            if (!frame_batch_encode(frame, sizeof(frame), &len, ADDR_MASTER, ADDR_SLAVE, CMD_SEQ_NONE, CMD_OTA_CHUNK_REQ_ID, &cmd))
+                return false;
+            stream.insert(stream.end(), frame, frame + len);
+            enviados++;
+        }
+
+        for (size_t pos = 0; pos < stream.size(); pos += cap) {
+            size_t rx_len = 0;
+            if (link_ptr->transaction(&stream[pos], std::min(cap, stream.size() - pos), rx_buf, &rx_len) < 0) return false;
+        }
+        if (stream.empty()) std::this_thread::sleep_for(OTA_ESPERA_ESCRITOR);
+
+        uint32_t prev = st.next_offset;
+        int status = consultar_status(&st);
+        if (status != CMD_OK) {
+            printf("\n[ERRO] OTA_STATUS: status %d\n", status);
+            return false;
+        }
+
+        auto agora = std::chrono::steady_clock::now();
+        if (st.next_offset != prev) avancou = agora;
+        if (agora - avancou > OTA_PARADO_MAX) {
+            printf("\n[ERRO FATAL] Escravo parado em %u.\n", st.next_offset);
+            return false;
+        }
+        printf("\rProgresso: %u / %u bytes (%zu chunks enviados)", st.next_offset, total, enviados);
+        fflush(stdout);
+    }
     return true;
 }
 
@@ -139,8 +303,24 @@ int main(int argc, char *argv[]) {
     ioctl(fd_spi, SPI_IOC_WR_BITS_PER_WORD, &bits);
     ioctl(fd_spi, SPI_IOC_WR_MAX_SPEED_HZ, &speed);
 
-    HalGpio slave_ready(GPIO_READY_PIN, HalGpio::Direction::Input, HalGpio::Edge::Rising);
-    slave_ready_ptr = &slave_ready;
+    HubLink link(fd_spi, SPEED, GPIO_READY_PIN, GPIO_ATTN_PIN);
+    link_ptr = &link;
+
+    bool passo = false;
+    bool lz = false;
+    const char *delta_base = nullptr;
+    uint32_t chunk = CMD_OTA_CHUNK_DATA_MAX;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--passo") == 0) passo = true;
+        else if (strcmp(argv[i], "--lz") == 0) lz = true;
+        else if (strcmp(argv[i], "--delta") == 0 && i + 1 < argc) delta_base = argv[++i];
+        else if (strcmp(argv[i], "--chunk") == 0 && i + 1 < argc) chunk = atoi(argv[++i]);
+    }
+    if (passo) chunk = CMD_OTA_CHUNK_SIZE_DEFAULT;
+    if (chunk == 0 || chunk > CMD_OTA_CHUNK_DATA_MAX) {
+        printf("[FALHA] Chunk de %u bytes (1..%d).\n", chunk, CMD_OTA_CHUNK_DATA_MAX);
+        return 1;
+    }
 
     std::ifstream file(argv[1], std::ios::binary | std::ios::ate);
     uint32_t file_size = file.tellg();
@@ -148,66 +328,95 @@ int main(int argc, char *argv[]) {
 
     printf("--- Iniciando OTA Seguro (DEBUG) ---\n");
 
-    // 1. START
-    printf(">> Enviando START...\n");
-    memset(tx_buf, 0, 64);
-    tx_buf[2] = CMD_OTA_START_REQ_ID; 
-    tx_buf[3] = 4; tx_buf[4] = 0;     
-    memcpy(&tx_buf[5], &file_size, 4); 
-    uint16_t crc = crc16_ccitt(tx_buf, 9);
-    tx_buf[9] = crc & 0xFF; tx_buf[10] = crc >> 8;
-    
-    spi_transaction();
-
-    printf(">> Aguardando ACK do START...\n");
-    std::this_thread::sleep_for(std::chrono::milliseconds(500)); 
-    
-    if (!esperar_ack(CMD_OTA_START_REQ_ID)) {
-        printf("[FALHA] Abortando.\n");
-        close(fd_spi);
-        return 1;
+    std::vector<uint8_t> img;
+    std::vector<uint8_t> stream; // O que os chunks levam: a imagem, ela comprimida, ou o patch
+    uint8_t flags = 0;
+    if (!passo) {
+        img.resize(file_size);
+        file.read((char*)img.data(), file_size);
+        stream = img;
+    }
+    if ((lz || delta_base) && !passo) {
+        auto z = lzh::compress(img.data(), img.size());
+        printf(">> Comprimida: %u -> %zu bytes (%.1f%%)\n", file_size, z.size(), 100.0 * z.size() / file_size);
+        if (z.size() < img.size()) {
+            stream = std::move(z);
+            flags = CMD_OTA_FLAG_LZ;
+        }
+    }
+    if (delta_base && !passo) {
+        auto d = montar_delta(delta_base, img);
+        if (!d.empty() && d.size() < stream.size()) {
+            stream = std::move(d);
+            flags = CMD_OTA_FLAG_DELTA | CMD_OTA_FLAG_LZ;
+        } else {
+            printf(">> Sem delta: vai %s.\n", flags ? "comprimida" : "crua");
+        }
+    }
+
+    // 1. START (pulado se o escravo ainda tem esta imagem pela metade)
+    if (passo || flags || !pode_retomar(stream, &chunk)) {
+        printf(">> Enviando START (chunks de %u bytes)...\n", chunk);
+        cmd_cmds_t start_cmd;
+        start_cmd.ota_start_req.total_size = passo ? file_size : stream.size();
+        start_cmd.ota_start_req.chunk_size = passo ? 0 : chunk;
+        start_cmd.ota_start_req.image_size = flags ? file_size : 0;
+        start_cmd.ota_start_req.flags = flags;
+
+        if (!enviar_pedido(CMD_OTA_START_REQ_ID, &start_cmd)) {
+            printf("[FALHA] Abortando.\n");
+            close(fd_spi);
+            return 1;
+        }
     }
 
     // 2. CHUNKS
-    printf(">> Enviando Chunks...\n");
-    std::vector<uint8_t> buffer(CHUNK_DATA_SIZE);
     uint32_t offset = 0;
+    uint16_t image_crc = utl_crc16_init(); // CRC da imagem inteira, acumulado chunk a chunk
 
-    while (file.read((char*)buffer.data(), CHUNK_DATA_SIZE) || file.gcount() > 0) {
+    if (!passo) {
+        printf(">> Enviando Chunks (janela de %d)...\n", CMD_OTA_WINDOW_CHUNKS);
+        if (!enviar_janela(stream, chunk)) {
+            close(fd_spi);
+            return 1;
+        }
+        image_crc = crc16h::update(image_crc, img.data(), img.size());
+        offset = file_size;
+    } else {
+        printf(">> Enviando Chunks...\n");
+    }
+    std::vector<uint8_t> buffer(chunk);
+
+    while (passo && (file.read((char*)buffer.data(), chunk) || file.gcount() > 0)) {
         size_t bytes_read = file.gcount();
         buffer.resize(bytes_read);
         
-        bool chunk_gravado = false;
-        for (int retry = 0; retry < 3; retry++) {
-            if (enviar_chunk_seguro(offset, buffer)) {
-                chunk_gravado = true;
-                break;
-            }
-            printf("\n[RETRY] Falha no offset %d.\n", offset);
-            std::this_thread::sleep_for(std::chrono::milliseconds(100)); 
-        }
-
-        if (!chunk_gravado) {
+        if (!enviar_chunk_seguro(offset, buffer)) {
             printf("\n[ERRO FATAL] Impossível gravar offset %d.\n", offset);
             close(fd_spi);
             return 1;
         }
 
+        image_crc = crc16h::update(image_crc, buffer.data(), bytes_read);
         offset += bytes_read;
         printf("\rProgresso: %d / %d bytes [OK]", offset, file_size);
         fflush(stdout);
-        buffer.resize(CHUNK_DATA_SIZE); 
+        buffer.resize(chunk); 
     }
 
     // 3. END
-    printf("\n>> Enviando END...\n");
-    memset(tx_buf, 0, 64);
-    tx_buf[0] = ADDR_MASTER; tx_buf[1] = ADDR_SLAVE; tx_buf[2] = CMD_OTA_END_REQ_ID; 
-    uint16_t crc_end = crc16_ccitt(tx_buf, 5);
-    tx_buf[5] = crc_end & 0xFF; tx_buf[6] = crc_end >> 8;
-    
-    spi_transaction();
-    esperar_ack(CMD_OTA_END_REQ_ID);
+    printf("\n>> Imagem: %u bytes, CRC16 0x%04X (%s)\n", offset, utl_crc16_final(image_crc), crc16h::engine().name);
+    printf(">> Enviando END...\n");
+    cmd_cmds_t end_cmd{};
+    if (!passo) {
+        end_cmd.ota_end_req.image_crc = crc16h::data(stream.data(), stream.size());
+        utl_sha256_data(img.data(), img.size(), end_cmd.ota_end_req.sha256);
+    }
+    if (!enviar_pedido(CMD_OTA_END_REQ_ID, &end_cmd)) {
+        printf("[FALHA] END recusado: swap não agendado (status %d = imagem gravada não confere).\n", CMD_ERR_CHECKSUM);
+        close(fd_spi);
+        return 1;
+    }
 
     close(fd_spi);
     return 0;
@@ -0,0 +1,308 @@
+/* ota_sim.c - ota_handler.c no host (ver ota_sim.h)
+ *
+ * O escritor roda na thread de quem chama ota_sim_writer_run. Ele só bloqueia no
+ * k_msgq_get do começo do laço: sem job (ou sem crédito), o stub sai dali com longjmp de
+ * volta para ota_sim_writer_run. Naquele ponto todo o estado do escritor está em
+ * variáveis estáticas e nenhum job está pela metade, então a próxima chamada continua
+ * de onde ele parou.
+ *
+ * Flash: o flash_img grava em blocos de OTA_SIM_BLOCK bytes e relê cada bloco gravado para
+ * o callback, como o stream_flash. Gravar byte não apagado conta em ota_sim.overwrites.
+ */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#define CONFIG_RETENTION 1
+#include "ota_handler.c"
+#include "ota_sim.h"
+
+ota_sim_t ota_sim;
+
+static uint8_t programmed[OTA_SIM_SLOT]; // 1 = gravado desde o último erase
+static const struct flash_area slot_fa[2] = {
+    {.fa_id = 0, .fa_off = 0, .fa_size = OTA_SIM_SLOT},
+    {.fa_id = 1, .fa_off = 0, .fa_size = OTA_SIM_SLOT},
+};
+
+// RAM retida: prefixo + checksum do subsistema de retenção viram só 'retained_valid'
+static uint8_t retained[sizeof(ota_cursor_t)];
+static bool retained_valid;
+
+void ota_sim_log(const char* fmt, ...)
+{
+    if(!ota_sim.verbose)
+        return;
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    putchar('\n');
+}
+
+// --- KERNEL ---
+static jmp_buf writer_jb;
+static int writer_budget; // Jobs que o escritor ainda pode pegar (< 0 = sem limite)
+static int writer_jobs;
+
+int k_msgq_get(struct k_msgq* q, void* data, k_timeout_t timeout)
+{
+    // Só o escritor lê a fila, sempre com K_FOREVER: aqui ele "bloqueia"
+    if(q->used == 0 || writer_budget == 0)
+        longjmp(writer_jb, 1);
+
+    writer_budget--;
+    writer_jobs++;
+    memcpy(data, q->buf + q->head * q->msg_size, q->msg_size);
+    q->head = (q->head + 1) % q->max_msgs;
+    q->used--;
+    return 0;
+}
+
+int k_msgq_put(struct k_msgq* q, const void* data, k_timeout_t timeout)
+{
+    if(q->used == q->max_msgs)
+        return -ENOMSG;
+    memcpy(q->buf + ((q->head + q->used) % q->max_msgs) * q->msg_size, data, q->msg_size);
+    q->used++;
+    return 0;
+}
+
+void k_msgq_purge(struct k_msgq* q)
+{
+    q->head = 0;
+    q->used = 0;
+}
+
+int k_sem_init(struct k_sem* sem, unsigned int initial, unsigned int limit)
+{
+    sem->count = initial;
+    sem->limit = limit;
+    return 0;
+}
+
+// Só o Hub pega, sempre com K_NO_WAIT
+int k_sem_take(struct k_sem* sem, k_timeout_t timeout)
+{
+    if(sem->count == 0)
+        return -EAGAIN;
+    sem->count--;
+    return 0;
+}
+
+void k_sem_give(struct k_sem* sem)
+{
+    if(sem->count < sem->limit)
+        sem->count++;
+}
+
+int32_t k_msleep(int32_t ms)
+{
+    return 0;
+}
+
+bool device_is_ready(const struct device* dev)
+{
+    return true;
+}
+
+void hub_wake(void)
+{
+    ota_sim.wakes++;
+}
+
+int boot_request_upgrade(int permanent)
+{
+    ota_sim.upgrades++;
+    return 0;
+}
+
+void sys_reboot(int type)
+{
+}
+
+// --- FLASH ---
+int flash_area_open(uint8_t id, const struct flash_area** fa)
+{
+    *fa = &slot_fa[id];
+    return 0;
+}
+
+void flash_area_close(const struct flash_area* fa)
+{
+}
+
+int flash_area_read(const struct flash_area* fa, off_t off, void* dst, size_t len)
+{
+    if(off < 0 || (size_t) off + len > OTA_SIM_SLOT)
+    {
+        ota_sim.bad_access++;
+        return -EINVAL;
+    }
+    memcpy(dst, (fa->fa_id == 0 ? ota_sim.slot0 : ota_sim.slot1) + off, len);
+    return 0;
+}
+
+int flash_area_erase(const struct flash_area* fa, off_t off, size_t len)
+{
+    if(fa->fa_id != 1 || off % ota_sim.page != 0 || len != ota_sim.page || (size_t) off + len > OTA_SIM_SLOT)
+    {
+        ota_sim.bad_access++;
+        return -EINVAL;
+    }
+    memset(ota_sim.slot1 + off, 0xFF, len);
+    memset(programmed + off, 0, len);
+    ota_sim.erases++;
+    return 0;
+}
+
+int flash_get_page_info_by_offs(const struct device* dev, off_t offset, struct flash_pages_info* info)
+{
+    info->start_offset = offset / ota_sim.page * ota_sim.page;
+    info->size = ota_sim.page;
+    info->index = offset / ota_sim.page;
+    return 0;
+}
+
+int flash_img_init(struct flash_img_context* c)
+{
+    memset(c, 0, sizeof(*c));
+    c->flash_area = &slot_fa[1];
+    c->stream.buf = c->buf;
+    c->stream.buf_len = sizeof(c->buf);
+    return 0;
+}
+
+// Grava o buffer no flash e relê para o callback
+static int flash_img_flush(struct flash_img_context* c)
+{
+    size_t at = c->stream.bytes_written;
+    size_t n = c->stream.buf_bytes;
+
+    if(at + n > OTA_SIM_SLOT)
+        return -EFBIG;
+    if(ota_sim.fail_at >= (long) at && ota_sim.fail_at < (long) (at + n))
+    {
+        ota_sim.fail_at = -1;
+        return -EIO;
+    }
+    for(size_t i = 0; i < n; i++)
+    {
+        if(programmed[at + i])
+            ota_sim.overwrites++;
+        programmed[at + i] = 1;
+        ota_sim.slot1[at + i] = c->buf[i] ^ ((long) (at + i) == ota_sim.flip_at);
+    }
+
+    // O stream_flash relê o bloco por cima do próprio buffer
+    memset(c->buf, 0, n);
+    memcpy(c->buf, ota_sim.slot1 + at, n);
+    int ret = c->stream.callback ? c->stream.callback(c->buf, n, at) : 0;
+    c->stream.bytes_written += n;
+    c->stream.buf_bytes = 0;
+    return ret;
+}
+
+int flash_img_buffered_write(struct flash_img_context* c, const uint8_t* data, size_t len, bool flush)
+{
+    while(len > 0)
+    {
+        size_t n = MIN(sizeof(c->buf) - c->stream.buf_bytes, len);
+        memcpy(c->buf + c->stream.buf_bytes, data, n);
+        c->stream.buf_bytes += n;
+        data += n;
+        len -= n;
+        if(c->stream.buf_bytes == sizeof(c->buf))
+        {
+            int ret = flash_img_flush(c);
+            if(ret < 0)
+                return ret;
+        }
+    }
+    return (flush && c->stream.buf_bytes > 0) ? flash_img_flush(c) : 0;
+}
+
+// --- RAM RETIDA ---
+int retention_is_valid(const struct device* dev)
+{
+    return retained_valid ? 1 : 0;
+}
+
+int retention_read(const struct device* dev, off_t offset, uint8_t* buffer, size_t size)
+{
+    memcpy(buffer, retained + offset, size);
+    return 0;
+}
+
+int retention_write(const struct device* dev, off_t offset, const uint8_t* buffer, size_t size)
+{
+    memcpy(retained + offset, buffer, size);
+    retained_valid = true;
+    return 0;
+}
+
+int retention_clear(const struct device* dev)
+{
+    retained_valid = false;
+    return 0;
+}
+
+// --- SIMULADOR ---
+int ota_sim_writer_run(int jobs)
+{
+    writer_budget = jobs;
+    writer_jobs = 0;
+    if(!setjmp(writer_jb))
+        ota_writer_entry(NULL, NULL, NULL);
+    return writer_jobs;
+}
+
+void ota_sim_power_on(uint32_t page)
+{
+    memset(&ota_sim, 0, sizeof(ota_sim));
+    ota_sim.page = page;
+    ota_sim.fail_at = -1;
+    ota_sim.flip_at = -1;
+
+    // Imagem anterior ainda no slot1
+    for(size_t i = 0; i < OTA_SIM_SLOT; i++)
+        ota_sim.slot1[i] = (uint8_t) (i * 7 + 3);
+    memset(programmed, 1, sizeof(programmed));
+    retained_valid = false;
+    ota_sim_reset();
+}
+
+void ota_sim_reset(void)
+{
+    // RAM comum do ota_handler.c (o resto é refeito a cada sessão)
+    reboot_pending = false;
+    win_present = 0;
+    ota_active = false;
+    ota_busy = false;
+    atomic_clear(&ota_done);
+    atomic_clear(&ota_error);
+    atomic_clear(&ota_end_state);
+    k_msgq_purge(&ota_write_q);
+    k_sem_init(&ota_data_slots, OTA_WRITE_QUEUE_LEN, OTA_WRITE_QUEUE_LEN);
+    memset(&ctx, 0, sizeof(ctx));
+    memset(&lz, 0, sizeof(lz));
+    memset(&delta, 0, sizeof(delta));
+    ota_flags = 0;
+
+    ota_init();
+}
+
+unsigned ota_sim_queue_used(void)
+{
+    return ota_write_q.used;
+}
+
+bool ota_sim_cursor_valid(void)
+{
+    return retained_valid;
+}
+
+bool ota_sim_programmed(uint32_t off)
+{
+    return programmed[off] != 0;
+}
@@ -0,0 +1,58 @@
+/* ota_sim.h - ota_handler.c no host: flash do F411, RAM retida e escritor simulados
+ *
+ * O ota_handler.c do firmware compila inteiro (ota_sim.c) contra os stubs de
+ * ota_sim/zephyr/. Hub e escritor viram uma thread só: o teste chama a API do Hub
+ * (ota_start, ota_write_chunk, ota_get_status, ota_finish, ota_take_result) e decide
+ * quando o escritor anda (ota_sim_writer_run). Quando o Hub esperaria o escritor (espaço
+ * na fila no END), o escritor roda até liberar.
+ */
+#ifndef OTA_SIM_H
+#define OTA_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ota_handler.h"
+
+#define OTA_SIM_SLOT  (128 * 1024)
+#define OTA_SIM_BLOCK 512 // Bloco do flash_img: unidade do cursor persistido
+
+typedef struct
+{
+    uint8_t slot0[OTA_SIM_SLOT]; // Imagem rodando (base do delta)
+    uint8_t slot1[OTA_SIM_SLOT];
+    uint32_t page;   // Página de erase: o F411 tem um setor só de 128 KiB no slot1
+    long fail_at;    // O bloco que cobre este offset do slot1 falha ao gravar (uma vez); -1 = nunca
+    long flip_at;    // Byte do slot1 gravado com um bit trocado; -1 = nunca
+    int overwrites;  // Bytes gravados sem apagar antes
+    int bad_access;  // Erase fora de página, leitura fora do slot
+    int erases;
+    int upgrades;    // boot_request_upgrade
+    int wakes;       // hub_wake
+    bool verbose;    // Imprime o log do ota_handler
+} ota_sim_t;
+
+extern ota_sim_t ota_sim;
+
+/* Liga a placa: slot1 com lixo programado, RAM retida inválida, contadores zerados */
+void ota_sim_power_on(uint32_t page);
+
+/* Reset: a RAM comum (janela, fila, escritor) se perde, flash e RAM retida ficam. Roda o
+ * ota_init do boot. */
+void ota_sim_reset(void);
+
+/* Escritor pega até 'jobs' jobs da fila (< 0 = até ela esvaziar). Devolve quantos pegou. */
+int ota_sim_writer_run(int jobs);
+
+unsigned ota_sim_queue_used(void);
+bool ota_sim_cursor_valid(void);
+bool ota_sim_programmed(uint32_t off); // Byte gravado desde o último erase
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,6 @@
+/* Versão "rodando" no slot0 do simulador (a base dos patches do ota_bench) */
+#define APP_VERSION_MAJOR  1
+#define APP_VERSION_MINOR  2
+#define APP_PATCHLEVEL     3
+#define APP_VERSION_NUMBER 0x010203
+#define APP_VERSION_STRING "1.2.3"
@@ -0,0 +1,40 @@
+#ifndef OTA_SIM_ZEPHYR_FLASH_IMG_H
+#define OTA_SIM_ZEPHYR_FLASH_IMG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <zephyr/device.h>
+
+struct flash_area
+{
+    uint8_t fa_id;
+    uint32_t fa_off;
+    size_t fa_size;
+};
+
+typedef int (*stream_flash_callback_t)(uint8_t* buf, size_t len, size_t offset);
+
+struct stream_flash_ctx
+{
+    uint8_t* buf;
+    size_t buf_len;
+    size_t buf_bytes;
+    const struct device* fdev;
+    size_t bytes_written;
+    size_t offset;
+    stream_flash_callback_t callback;
+};
+
+/* Blocos de 512 bytes, como CONFIG_IMG_BLOCK_BUF_SIZE */
+struct flash_img_context
+{
+    uint8_t buf[512];
+    const struct flash_area* flash_area;
+    struct stream_flash_ctx stream;
+};
+
+int flash_img_init(struct flash_img_context* ctx);
+int flash_img_buffered_write(struct flash_img_context* ctx, const uint8_t* data, size_t len, bool flush);
+
+#endif
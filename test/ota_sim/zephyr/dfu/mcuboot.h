@@ -0,0 +1,2 @@
+#define BOOT_UPGRADE_TEST 0
+int boot_request_upgrade(int permanent);
@@ -0,0 +1 @@
+/* ota_handler.c inclui, não usa */
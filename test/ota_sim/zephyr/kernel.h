@@ -0,0 +1,82 @@
+/* Stubs do host para ota_sim.c: só o que ota_handler.c (e os headers dele) usa do Zephyr.
+ * Uma thread só: as filas e semáforos são implementados em ota_sim.c. */
+#ifndef OTA_SIM_ZEPHYR_KERNEL_H
+#define OTA_SIM_ZEPHYR_KERNEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/device.h>
+
+typedef struct
+{
+    int32_t ms; // -1 = K_FOREVER
+} k_timeout_t;
+#define K_FOREVER ((k_timeout_t){-1})
+#define K_NO_WAIT ((k_timeout_t){0})
+#define K_MSEC(x) ((k_timeout_t){(x)})
+
+struct k_msgq
+{
+    char* buf;
+    size_t msg_size;
+    uint32_t max_msgs;
+    uint32_t head;
+    uint32_t used;
+};
+#define K_MSGQ_DEFINE(name, size, max, align)                                                                          \
+    static char _msgq_buf_##name[(size) * (max)];                                                                      \
+    struct k_msgq name = {_msgq_buf_##name, (size), (max), 0, 0}
+
+struct k_sem
+{
+    unsigned int count;
+    unsigned int limit;
+};
+#define K_SEM_DEFINE(name, initial, max) struct k_sem name = {(initial), (max)}
+
+typedef void* k_tid_t;
+#define K_THREAD_DEFINE(name, stack, entry, p1, p2, p3, prio, options, delay) const k_tid_t name = NULL
+
+int k_msgq_put(struct k_msgq* q, const void* data, k_timeout_t timeout);
+int k_msgq_get(struct k_msgq* q, void* data, k_timeout_t timeout);
+void k_msgq_purge(struct k_msgq* q);
+int k_sem_init(struct k_sem* sem, unsigned int initial, unsigned int limit);
+int k_sem_take(struct k_sem* sem, k_timeout_t timeout);
+void k_sem_give(struct k_sem* sem);
+int32_t k_msleep(int32_t ms);
+
+typedef long atomic_t;
+typedef long atomic_val_t;
+#define ATOMIC_INIT(x) (x)
+static inline atomic_val_t atomic_get(const atomic_t* a)
+{
+    return *a;
+}
+static inline atomic_val_t atomic_set(atomic_t* a, atomic_val_t v)
+{
+    atomic_val_t old = *a;
+    *a = v;
+    return old;
+}
+static inline bool atomic_cas(atomic_t* a, atomic_val_t old, atomic_val_t v)
+{
+    if(*a != old)
+        return false;
+    *a = v;
+    return true;
+}
+static inline atomic_val_t atomic_clear(atomic_t* a)
+{
+    return atomic_set(a, 0);
+}
+
+#define MIN(a, b)          (((a) < (b)) ? (a) : (b))
+#define BIT(n)             (1UL << (n))
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define BUILD_ASSERT(cond, msg) _Static_assert(cond, msg)
+#define IS_ENABLED(config) 0
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef OTA_SIM_ZEPHYR_LOG_H
+#define OTA_SIM_ZEPHYR_LOG_H
+
+/* ota_sim_log imprime só com ota_sim.verbose */
+void ota_sim_log(const char* fmt, ...);
+#define LOG_MODULE_REGISTER(name, level)
+#define LOG_INF(...) ota_sim_log(__VA_ARGS__)
+#define LOG_WRN(...) ota_sim_log(__VA_ARGS__)
+#define LOG_ERR(...) ota_sim_log(__VA_ARGS__)
+#define LOG_DBG(...) ota_sim_log(__VA_ARGS__)
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef OTA_SIM_ZEPHYR_RETENTION_H
+#define OTA_SIM_ZEPHYR_RETENTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <zephyr/device.h>
+
+int retention_is_valid(const struct device* dev);
+int retention_read(const struct device* dev, off_t offset, uint8_t* buffer, size_t size);
+int retention_write(const struct device* dev, off_t offset, const uint8_t* buffer, size_t size);
+int retention_clear(const struct device* dev);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef OTA_SIM_ZEPHYR_FLASH_MAP_H
+#define OTA_SIM_ZEPHYR_FLASH_MAP_H
+
+#include <sys/types.h>
+#include <zephyr/dfu/flash_img.h>
+
+/* slot0 e slot1 de 128 KiB, como no app.overlay */
+enum
+{
+    OTA_SIM_slot0_partition,
+    OTA_SIM_slot1_partition,
+};
+#define FIXED_PARTITION_ID(label)   OTA_SIM_##label
+#define FIXED_PARTITION_SIZE(label) (128 * 1024)
+
+int flash_area_open(uint8_t id, const struct flash_area** fa);
+void flash_area_close(const struct flash_area* fa);
+int flash_area_read(const struct flash_area* fa, off_t off, void* dst, size_t len);
+int flash_area_erase(const struct flash_area* fa, off_t off, size_t len);
+
+#endif
@@ -0,0 +1,130 @@
+/* sha256_bench.cpp - utl_sha256 (conferência da imagem no OTA) contra os vetores do FIPS 180-4
+ *
+ * Confere os vetores de teste do NIST ("", "abc", a mensagem de 448 bits e um milhão de 'a'),
+ * os tamanhos em volta do padding (0 a 200 bytes: 55, 56 e 64 mudam o número de blocos) e que
+ * o hash é o mesmo com a entrada partida em pedaços aleatórios, como ela chega no OTA. Depois
+ * mede a vazão por tamanho de update: 245 (um chunk) e 512 (o bloco que o stream_flash grava
+ * e relê antes de passar ao hash).
+ *
+ * Build (a partir de test/, precisa da Google Benchmark):
+ *   gcc -O2 -c -I../utl ../utl/utl_sha256.c
+ *   g++ -O2 -std=c++17 -I../utl sha256_bench.cpp utl_sha256.o -lbenchmark -lpthread -o sha256_bench
+ */
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+extern "C" {
+    #include "utl_sha256.h"
+}
+
+static std::string hex(const uint8_t *d)
+{
+    std::string s;
+    char b[3];
+    for (int i = 0; i < UTL_SHA256_SIZE; i++) {
+        snprintf(b, sizeof(b), "%02x", d[i]);
+        s += b;
+    }
+    return s;
+}
+
+static std::string sha(const void *data, size_t len)
+{
+    uint8_t d[UTL_SHA256_SIZE];
+    utl_sha256_data(data, len, d);
+    return hex(d);
+}
+
+// Mesmo hash com a entrada em pedaços de 0..max_pedaco bytes
+static std::string sha_partido(const std::vector<uint8_t> &v, std::mt19937 &rng, size_t max_pedaco)
+{
+    utl_sha256_t ctx;
+    uint8_t d[UTL_SHA256_SIZE];
+    utl_sha256_init(&ctx);
+    for (size_t pos = 0; pos < v.size();) {
+        size_t n = std::min<size_t>(rng() % (max_pedaco + 1), v.size() - pos);
+        utl_sha256_update(&ctx, v.data() + pos, n);
+        pos += n;
+    }
+    utl_sha256_final(&ctx, d);
+    return hex(d);
+}
+
+// --- CONFERÊNCIA ---
+static bool confere()
+{
+    struct Vetor {
+        std::string msg;
+        const char *digest;
+    };
+    const Vetor vetores[] = {
+        {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+        {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrs"
+         "mnopqrstnopqrstu",
+         "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+        {std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+    };
+    for (auto &v : vetores) {
+        if (sha(v.msg.data(), v.msg.size()) != v.digest) {
+            printf("[FALHA] vetor de %zu bytes\n", v.msg.size());
+            return false;
+        }
+    }
+
+    std::mt19937 rng(25);
+    for (size_t n = 0; n <= 200; n++) {
+        std::vector<uint8_t> v(n);
+        for (auto &b : v) b = (uint8_t)rng();
+        std::string um = sha(v.data(), v.size());
+        if (sha_partido(v, rng, 1) != um || sha_partido(v, rng, 70) != um) {
+            printf("[FALHA] partido: %zu bytes\n", n);
+            return false;
+        }
+    }
+
+    std::vector<uint8_t> img(300 * 1024);
+    for (auto &b : img) b = (uint8_t)rng();
+    std::string um = sha(img.data(), img.size());
+    if (sha_partido(img, rng, 245) != um || sha_partido(img, rng, 4096) != um) {
+        printf("[FALHA] partido: imagem\n");
+        return false;
+    }
+    return true;
+}
+
+// --- BENCHMARKS ---
+static void bm_update(benchmark::State &state)
+{
+    const size_t pedaco = (size_t)state.range(0);
+    std::vector<uint8_t> img(128 * 1024, 0x5A);
+    utl_sha256_t ctx;
+    uint8_t d[UTL_SHA256_SIZE];
+    for (auto _ : state) {
+        utl_sha256_init(&ctx);
+        for (size_t pos = 0; pos < img.size(); pos += pedaco)
+            utl_sha256_update(&ctx, &img[pos], std::min(pedaco, img.size() - pos));
+        utl_sha256_final(&ctx, d);
+        benchmark::DoNotOptimize(d);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * img.size()));
+}
+BENCHMARK(bm_update)->Arg(64)->Arg(245)->Arg(512)->Arg(4096);
+
+int main(int argc, char **argv)
+{
+    if (!confere()) return 1;
+    printf("utl_sha256 confere com os vetores do FIPS 180-4.\n");
+
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
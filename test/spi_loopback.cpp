@@ -9,10 +9,11 @@
 #include <thread>
 #include <chrono>
 #include <vector>
-#include "hal_gpio.hpp" 
+#include "hub_link.hpp"
+#include "tlm_decoder.hpp"
 
 extern "C" {
-    #include "cmd.h"
+    #include "protocol_defs.h"
 }
 
 // CONFIGURAÇÕES
@@ -22,69 +23,123 @@ static const uint8_t BITS = 8;
 static const uint8_t SPI_MODE = SPI_MODE_3; 
 static const int SPI_PACKET_SIZE = 64; 
 
-// PINO READY (PB0 do STM32 -> GPIO 25 da RPi)
+// PINO READY (PB0 do STM32 -> GPIO 25 da RPi) e ATTN (PB1 do STM32 -> GPIO 24 da RPi)
+// A resposta atravessa o pipeline de slots do slave (HUB_SLOTS em hub.h): o HubLink
+// continua lendo enquanto ATTN estiver alto, sem esperas fixas.
 static const int GPIO_READY_PIN = 25; 
+static const int GPIO_ATTN_PIN = 24;
 
-// --- TRANSAÇÃO SPI ---
-int spi_transaction(int fd_spi, HalGpio &slave_ready, uint8_t *tx_buf, uint8_t *rx_buf) 
+static void print_response(cmd_ids_t res_id, const cmd_cmds_t &res_decoded)
 {
-    const int TIMEOUT_NS = 1000000000; 
+    printf("[RX] Resposta OK! ID: 0x%02X -> ", res_id);
 
-    // 1.1 Espera Slave Ready
-    if (slave_ready.get() == false) {
-        if (slave_ready.wait_for_edge(TIMEOUT_NS) != HalGpio::Edge::Rising) {
-            std::cerr << "[ERRO] Timeout esperando Slave Ready para escrita!" << std::endl;
-            return -1;
-        }
+    switch(res_id) {
+        case CMD_GET_STATUS_RES_ID:
+            printf("[STATUS] Estado: %d | Vol: %d | FlowSet: %d\n", 
+            res_decoded.status_res.status_data.current_state,
+            res_decoded.status_res.status_data.volume,
+            res_decoded.status_res.status_data.flow_rate_set);
+            break;
+        case CMD_VERSION_RES_ID:
+            printf("[VERSÃO] Firmware v%d.%d.%d\n", 
+                res_decoded.version_res.major,
+                res_decoded.version_res.minor,
+                res_decoded.version_res.patch);
+            break;
+        case CMD_ACTION_RES_ID:
+            printf("[ACTION ACK] Cmd: 0x%02X | Status: %d\n", 
+                res_decoded.action_res.cmd_req_id,
+                res_decoded.action_res.status);
+            break;
+        case CMD_SET_CONFIG_RES_ID:
+            printf("[CONFIG ACK] Status: %d\n", res_decoded.config_res.status);
+            break;
+        case CMD_LATENCY_RES_ID:
+            printf("[LATÊNCIA] Cmd %d | n=%u | min/avg/max: %u/%u/%u us | decode %u, fila %u, FSM %u us\n",
+                res_decoded.latency_res.cmd,
+                res_decoded.latency_res.count,
+                res_decoded.latency_res.min_us,
+                res_decoded.latency_res.avg_us,
+                res_decoded.latency_res.max_us,
+                res_decoded.latency_res.decode_avg_us,
+                res_decoded.latency_res.queue_avg_us,
+                res_decoded.latency_res.fsm_avg_us);
+            break;
+        default:
+            printf("Desconhecido.\n");
+            break;
     }
+}
 
-    std::this_thread::sleep_for(std::chrono::microseconds(500)); 
+// --- MODO TELEMETRIA (--tlm) ---
+// Assina todos os canais e depois só lê quando o escravo levanta ATTN: ele preenche o
+// espaço livre com registros. Buracos em first_sample são amostras perdidas.
+static int telemetry_loop(HubLink &link, uint8_t format)
+{
+    uint8_t tx[CMD_LINK_MAX_BODY];
+    uint8_t rx[CMD_LINK_MAX_BODY];
+    size_t tx_len = 0;
 
-    struct spi_ioc_transfer tr_write;
-    memset(&tr_write, 0, sizeof(tr_write));
-    tr_write.tx_buf = (unsigned long)tx_buf;
-    tr_write.rx_buf = 0; 
-    tr_write.len = SPI_PACKET_SIZE; 
-    tr_write.speed_hz = SPEED;
-    tr_write.bits_per_word = BITS;
+    cmd_cmds_t sub;
+    memset(&sub, 0, sizeof(sub));
+    sub.tlm_sub_req.channels = CMD_TLM_CH_ALL;
+    sub.tlm_sub_req.decimation = 1;
+    sub.tlm_sub_req.format = format;
+    memset(tx, 0, sizeof(tx));
+    frame_batch_encode(tx, sizeof(tx), &tx_len, ADDR_MASTER, ADDR_SLAVE, frame_batch_next_seq(), CMD_TLM_SUB_REQ_ID,
+                       &sub);
 
-    // 1.2 Envia
-    if (ioctl(fd_spi, SPI_IOC_MESSAGE(1), &tr_write) < 1) {
-        perror("Erro SPI Write");
-        return -1;
-    }
+    TlmDecoder decoder;
+    std::vector<cmd_tlm_record_t> records;
+    unsigned bytes_tlm = 0;
 
-    // [CRÍTICO] Aumentado para 5ms para processamento de filas no Slave
-    std::this_thread::sleep_for(std::chrono::microseconds(5000)); 
+    while (true) {
+        size_t rx_len = 0;
+        memset(rx, 0, sizeof(rx));
 
-    // 2.1 Espera Resposta Pronta
-    if (slave_ready.get() == false) {
-        if (slave_ready.wait_for_edge(TIMEOUT_NS) != HalGpio::Edge::Rising) {
-            std::cerr << "[ERRO] Timeout esperando Slave Ready para leitura!" << std::endl;
-            return -1;
-        }
-    }
+        // A assinatura vai na primeira transação; depois, só leituras puxadas pelo ATTN
+        int ret = (tx_len > 0) ? link.transaction(tx, tx_len, rx, &rx_len) : link.poll(rx, &rx_len);
+        if (ret < 0) return 1;
+        tx_len = 0;
 
-    std::this_thread::sleep_for(std::chrono::microseconds(500)); 
+        frame_batch_for_each(rx, rx_len, [&](uint8_t, uint8_t, uint8_t seq, cmd_ids_t id, const cmd_cmds_t &cmd) {
+            if (id == CMD_TLM_SUB_RES_ID) {
+                printf("[TLM] Assinatura: status %d, canais 0x%02X, formato %s, keyframe %d bytes\n",
+                       cmd.tlm_sub_res.status, cmd.tlm_sub_res.channels,
+                       cmd.tlm_sub_res.format == CMD_TLM_FMT_DELTA ? "DELTA" : "RAW", cmd.tlm_sub_res.record_size);
+                return;
+            }
+            if (id != CMD_TLM_DATA_ID) {
+                printf("(seq %3d) ", seq);
+                print_response(id, cmd);
+                return;
+            }
 
-    struct spi_ioc_transfer tr_read;
-    memset(&tr_read, 0, sizeof(tr_read));
-    tr_read.tx_buf = 0; 
-    tr_read.rx_buf = (unsigned long)rx_buf;
-    tr_read.len = SPI_PACKET_SIZE; 
-    tr_read.speed_hz = SPEED;
-    tr_read.bits_per_word = BITS;
+            const cmd_tlm_data_t &d = cmd.tlm_data;
+            records.clear();
+            if (!decoder.decode(d, records)) {
+                printf("[TLM] Frame malformado (%d registros, %d bytes)\n", d.count, d.records_len);
+                return;
+            }
+            bytes_tlm += CMD_HDR_SIZE + CMD_TLM_DATA_HDR_SIZE + d.records_len + CMD_TRAILER_SIZE;
 
-    // 2.2 Lê
-    if (ioctl(fd_spi, SPI_IOC_MESSAGE(1), &tr_read) < 1) {
-        perror("Erro SPI Read");
-        return -1;
-    }
+            for (size_t i = 0; i < records.size(); i++) {
+                const cmd_tlm_record_t &rec = records[i];
+                printf("[TLM %5u] t=%u ms | bolha %u mV | oclusão %u mV | pot %u mV | estado %u | vol %u | %u mmHg\n",
+                       (unsigned)(uint16_t)(d.first_sample + i), rec.timestamp, rec.bubble_mv, rec.occlusion_mv,
+                       rec.volume_pot_mv, rec.state, rec.infused, rec.pressure);
+            }
+        });
 
+        unsigned n = decoder.received();
+        if (n && n % 500 < 5)
+            printf("[TLM] Recebidas: %u | Perdidas: %u | Descartadas no escravo: %u | %.1f B/amostra\n", n,
+                   decoder.lost(), decoder.dropped(), (double)bytes_tlm / n);
+    }
     return 0;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     printf("--- Teste Sequencial de Todos os Comandos ---\n");
 
     int fd_spi = open(DEVICE, O_RDWR);
@@ -98,24 +153,67 @@ int main() {
     if (ioctl(fd_spi, SPI_IOC_WR_BITS_PER_WORD, &bits) == -1) return 1;
     if (ioctl(fd_spi, SPI_IOC_WR_MAX_SPEED_HZ, &speed) == -1) return 1;
 
-    printf("Inicializando GPIO %d...\n", GPIO_READY_PIN);
-    HalGpio slave_ready(GPIO_READY_PIN, HalGpio::Direction::Input, HalGpio::Edge::Rising);
+    printf("Inicializando GPIOs %d (READY) e %d (ATTN)...\n", GPIO_READY_PIN, GPIO_ATTN_PIN);
+    HubLink link(fd_spi, SPEED, GPIO_READY_PIN, GPIO_ATTN_PIN);
 
-    uint8_t tx_buf[SPI_PACKET_SIZE];
-    uint8_t rx_buf[SPI_PACKET_SIZE];
+    uint8_t tx_buf[CMD_LINK_MAX_BODY];
+    uint8_t rx_buf[CMD_LINK_MAX_BODY];
     
     uint8_t master_addr = ADDR_MASTER;
     uint8_t slave_addr  = ADDR_SLAVE;
+
+    // --var: negocia o modo com tamanho (header de 4 bytes + corpo do tamanho exato)
+    // --tlm: assina a telemetria (DELTA) e só recebe; --raw pede registros sem compressão
+    bool var_mode = false;
+    bool tlm_mode = false;
+    uint8_t tlm_format = CMD_TLM_FMT_DELTA;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--var") == 0) var_mode = true;
+        if (strcmp(argv[i], "--tlm") == 0) tlm_mode = true;
+        if (strcmp(argv[i], "--raw") == 0) tlm_format = CMD_TLM_FMT_RAW;
+    }
+    if (var_mode) {
+        size_t cfg_size = 0;
+        cmd_ids_t cfg_id = CMD_LINK_CONFIG_REQ_ID;
+        cmd_cmds_t cfg_cmd;
+        memset(&cfg_cmd, 0, sizeof(cfg_cmd));
+        memset(tx_buf, 0, SPI_PACKET_SIZE);
+        cfg_cmd.link_config_req.mode = CMD_LINK_MODE_VARIABLE;
+        uint8_t cfg_seq = frame_batch_next_seq();
+        cmd_encode(tx_buf, &cfg_size, &master_addr, &slave_addr, &cfg_seq, &cfg_id, &cfg_cmd);
+
+        cmd_link_config_res_t res_cfg;
+        bool aceito = false;
+        int ret = link.round_trip(tx_buf, cfg_size, rx_buf, [&](const uint8_t *rx, size_t len) {
+            bool achou = false;
+            frame_batch_for_each(rx, len, [&](uint8_t, uint8_t, uint8_t seq, cmd_ids_t id, const cmd_cmds_t &cmd) {
+                if (id != CMD_LINK_CONFIG_RES_ID || seq != cfg_seq) return;
+                res_cfg = cmd.link_config_res;
+                aceito = (res_cfg.status == CMD_OK);
+                achou = true;
+            });
+            return achou;
+        });
+        if (ret < 0 || !aceito) {
+            printf("[ERRO] Slave recusou o modo VARIABLE.\n");
+            return 1;
+        }
+        link.set_variable(true);
+        printf("Modo VARIABLE ativo (corpo máx: %d bytes)\n", res_cfg.max_body);
+    }
     
-    int step = 0;
-    const int MAX_STEPS = 9; 
+    if (tlm_mode) {
+        int ret = telemetry_loop(link, tlm_format);
+        close(fd_spi);
+        return ret;
+    }
 
-    const int HEADER_SIZE = 5;
-    const int TRAILER_SIZE = 2;
+    int step = 0;
+    const int MAX_STEPS = 10; 
 
     while (true) {
-        memset(tx_buf, 0, SPI_PACKET_SIZE);
-        memset(rx_buf, 0, SPI_PACKET_SIZE);
+        memset(tx_buf, 0, sizeof(tx_buf));
+        memset(rx_buf, 0, sizeof(rx_buf));
         
         size_t encoded_size = 0;
         cmd_ids_t req_id;
@@ -163,59 +261,51 @@ int main() {
                 printf("\n--- Passo 8: Comando ABORT ---\n");
                 req_id = CMD_ACTION_ABORT_REQ_ID;
                 break;
+            case 9:
+                printf("\n--- Passo 9: VERSÃO + STATUS na mesma transação ---\n");
+                req_id = CMD_VERSION_REQ_ID;
+                break;
+            default:
+                printf("\n--- Passo 10: Latência do PAUSE (SPI -> motor) ---\n");
+                req_id = CMD_LATENCY_REQ_ID;
+                req_cmd.latency_req.cmd = CMD_PAUSE;
+                req_cmd.latency_req.reset = 0;
+                break;
+        }
+
+        // Todo passo usa o empacotador; o passo 9 coloca dois pedidos no mesmo transfer
+        uint8_t seq_ult = frame_batch_next_seq();
+        frame_batch_encode(tx_buf, sizeof(tx_buf), &encoded_size, master_addr, slave_addr, seq_ult, req_id, &req_cmd);
+        if (step == 9) {
+            seq_ult = frame_batch_next_seq();
+            frame_batch_encode(tx_buf, sizeof(tx_buf), &encoded_size, master_addr, slave_addr, seq_ult,
+                               CMD_GET_STATUS_REQ_ID, &req_cmd);
         }
 
         step++;
         if (step > MAX_STEPS) step = 0;
 
-        cmd_encode(tx_buf, &encoded_size, &master_addr, &slave_addr, &req_id, &req_cmd);
-
-        if (spi_transaction(fd_spi, slave_ready, tx_buf, rx_buf) < 0) break;
+        // Lê até a resposta do último pedido do passo (as respostas saem em ordem).
+        // Uma transação pode trazer várias respostas em sequência.
+        auto t0 = std::chrono::steady_clock::now();
+        int count = 0;
+        int ret = link.round_trip(tx_buf, encoded_size, rx_buf, [&](const uint8_t *rx, size_t len) {
+            bool fim = false;
+            count += frame_batch_for_each(rx, len, [&](uint8_t, uint8_t, uint8_t seq, cmd_ids_t id, const cmd_cmds_t &cmd) {
+                printf("(seq %3d) ", seq);
+                print_response(id, cmd);
+                if (seq == seq_ult) fim = true;
+            });
+            return fim;
+        });
+        auto t1 = std::chrono::steady_clock::now();
 
-        // Decodificação Little Endian
-        uint16_t received_payload_len = (rx_buf[4] << 8) | rx_buf[3];
-        
-        if (received_payload_len > (SPI_PACKET_SIZE - HEADER_SIZE - TRAILER_SIZE)) {
-            printf("[ERRO] Tamanho Payload Inválido: %d\n", received_payload_len);
-            received_payload_len = 0;
+        if (ret == -1) break;
+        if (ret == -2 || count == 0) {
+            printf("[RX] Nenhuma resposta (ATTN não subiu). RAW: %02X %02X...\n", rx_buf[0], rx_buf[1]);
         }
-
-        size_t total_valid_len = HEADER_SIZE + received_payload_len + TRAILER_SIZE;
-        uint8_t src, dst;
-        cmd_ids_t res_id;
-        cmd_cmds_t res_decoded;
-        
-        if (cmd_decode(rx_buf, total_valid_len, &src, &dst, &res_id, &res_decoded)) {
-             printf("[RX] Resposta OK! ID: 0x%02X -> ", res_id);
-             
-             switch(res_id) {
-                case CMD_GET_STATUS_RES_ID:
-                    printf("[STATUS] Estado: %d | Vol: %d | FlowSet: %d\n", 
-                    res_decoded.status_res.status_data.current_state,
-                    res_decoded.status_res.status_data.volume,
-                    res_decoded.status_res.status_data.flow_rate_set);
-                    break;
-                case CMD_VERSION_RES_ID:
-                    printf("[VERSÃO] Firmware v%d.%d.%d\n", 
-                        res_decoded.version_res.major,
-                        res_decoded.version_res.minor,
-                        res_decoded.version_res.patch);
-                    break;
-                case CMD_ACTION_RES_ID:
-                    printf("[ACTION ACK] Cmd: 0x%02X | Status: %d\n", 
-                        res_decoded.action_res.cmd_req_id,
-                        res_decoded.action_res.status);
-                    break;
-                case CMD_SET_CONFIG_RES_ID:
-                    printf("[CONFIG ACK] Status: %d\n", res_decoded.config_res.status);
-                    break;
-                default:
-                    printf("Desconhecido.\n");
-                    break;
-             }
-        }   
         else {
-            printf("[RX] Erro CRC/Decode. (ValidLen: %d) RAW: %02X %02X...\n", (int)total_valid_len, rx_buf[0], rx_buf[1]);
+            printf("[RTT] %.0f us\n", std::chrono::duration<double, std::micro>(t1 - t0).count());
         }
         
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
@@ -0,0 +1,170 @@
+/* tlm_codec_bench.cpp - Telemetria RAW x DELTA x struct cru (sensor_packet_t), sem SPI
+ *
+ * Gera uma série sintética de amostras do ADC a 10 ms, empacota com o mesmo código do
+ * firmware (cmd_tlm_pack + cmd_encode_tlm_data), decodifica com o TlmDecoder e compara
+ * bytes por amostra e amostras por transação nos dois modos de link.
+ *
+ * Build (a partir de test/):
+ *   gcc -O2 -c -I../include -I../utl ../src/cmd.c ../utl/utl_io.c ../utl/utl_crc16.c ../utl/utl_varint.c
+ *   g++ -O2 -std=c++17 -I../include -I../utl tlm_codec_bench.cpp cmd.o utl_io.o utl_crc16.o utl_varint.o -o tlm_codec_bench
+ */
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "tlm_decoder.hpp"
+
+extern "C" {
+    #include "protocol_defs.h"
+}
+
+static const int AMOSTRAS = 100000;        // 1000 s de ADC a 10 ms
+static const int TAXA_HZ = 100;
+static const size_t SENSOR_PACKET_SIZE = 16; // sensor_packet_t: 4 x int32_t
+static const size_t OVERHEAD = CMD_HDR_SIZE + CMD_TLM_DATA_HDR_SIZE + CMD_TRAILER_SIZE;
+
+// Série parecida com a real: bolha estável com ruído, oclusão filtrada subindo devagar,
+// potenciômetro em rampa, volume crescendo e estado mudando raramente.
+static std::vector<cmd_tlm_record_t> gera_serie()
+{
+    std::vector<cmd_tlm_record_t> v(AMOSTRAS);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> ruido(-4, 4);
+    double oclusao = 120.0;
+
+    for (int i = 0; i < AMOSTRAS; i++) {
+        cmd_tlm_record_t &r = v[i];
+        r.timestamp = 5000 + i * 10 + (rng() % 3 == 0); // Jitter de 1 ms do k_sleep
+        r.bubble_mv = (uint16_t)(3000 + ruido(rng));
+        oclusao += 0.02 + 0.1 * ruido(rng) / 4.0;
+        r.occlusion_mv = (uint16_t)oclusao;
+        r.volume_pot_mv = (uint16_t)(1650 + 1600 * std::sin(i / 3000.0));
+        r.state = (uint8_t)((i / 20000) % 2 ? STATE_RUNNING : STATE_PAUSED);
+        r.infused = (uint32_t)(i / 50);
+        r.pressure = (uint16_t)(r.occlusion_mv / 10);
+    }
+    return v;
+}
+
+static bool mesmo_registro(uint8_t ch, const cmd_tlm_record_t &a, const cmd_tlm_record_t &b)
+{
+    if (a.timestamp != b.timestamp) return false;
+    if ((ch & CMD_TLM_CH_BUBBLE) && a.bubble_mv != b.bubble_mv) return false;
+    if ((ch & CMD_TLM_CH_OCCLUSION) && a.occlusion_mv != b.occlusion_mv) return false;
+    if ((ch & CMD_TLM_CH_VOLUME_POT) && a.volume_pot_mv != b.volume_pot_mv) return false;
+    if ((ch & CMD_TLM_CH_STATE) && a.state != b.state) return false;
+    if ((ch & CMD_TLM_CH_INFUSED) && a.infused != b.infused) return false;
+    if ((ch & CMD_TLM_CH_PRESSURE) && a.pressure != b.pressure) return false;
+    return true;
+}
+
+struct Resultado {
+    size_t frames = 0;
+    size_t bytes = 0;   // Frames completos (header + registros + CRC)
+    double enc_us = 0;
+    double dec_us = 0;
+    bool ok = true;
+};
+
+// Empacota a série em frames que cabem em 'capacidade' bytes (1 frame por transação)
+static Resultado roda(const std::vector<cmd_tlm_record_t> &serie, uint8_t canais, uint8_t formato, size_t capacidade)
+{
+    Resultado r;
+    std::vector<std::vector<uint8_t>> frames;
+    static cmd_tlm_data_t tlm;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < serie.size();) {
+        tlm.channels = canais;
+        tlm.format = formato;
+        size_t n = cmd_tlm_pack(&tlm, &serie[i], serie.size() - i, capacidade - OVERHEAD);
+        if (n == 0) { r.ok = false; return r; }
+        tlm.first_sample = (uint16_t)i;
+        tlm.dropped = 0;
+
+        std::vector<uint8_t> f(FRAME_MAX_CMD_SIZE);
+        size_t len = 0;
+        cmd_encode_tlm_data(ADDR_MASTER, ADDR_SLAVE, CMD_SEQ_NONE, &tlm, f.data(), &len);
+        f.resize(len);
+        frames.push_back(std::move(f));
+        i += n;
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    TlmDecoder dec;
+    std::vector<cmd_tlm_record_t> saida;
+    saida.reserve(serie.size());
+    for (auto &f : frames) {
+        uint8_t src, dst, seq;
+        cmd_ids_t id;
+        cmd_cmds_t cmd;
+        if (!cmd_decode(f.data(), f.size(), &src, &dst, &seq, &id, &cmd) || !dec.decode(cmd.tlm_data, saida)) {
+            r.ok = false;
+            return r;
+        }
+        r.bytes += f.size();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    r.frames = frames.size();
+    r.enc_us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    r.dec_us = std::chrono::duration<double, std::micro>(t2 - t1).count();
+
+    if (saida.size() != serie.size() || dec.lost() != 0) r.ok = false;
+    for (size_t i = 0; r.ok && i < serie.size(); i++)
+        r.ok = mesmo_registro(canais, serie[i], saida[i]);
+    return r;
+}
+
+static void linha(const char *nome, size_t bytes_por_registro, const Resultado &r)
+{
+    double bps = (double)r.bytes / AMOSTRAS;
+    double por_transacao = (double)AMOSTRAS / r.frames;
+    printf("  %-30s %6zu %9.2f %10.1f %12.1f %10.1f %10.1f  %s\n", nome, bytes_por_registro, bps, por_transacao,
+           TAXA_HZ / por_transacao, AMOSTRAS / r.enc_us, AMOSTRAS / r.dec_us, r.ok ? "OK" : "FALHOU");
+}
+
+int main()
+{
+    std::vector<cmd_tlm_record_t> serie = gera_serie();
+    const uint8_t sensores = CMD_TLM_CH_BUBBLE | CMD_TLM_CH_OCCLUSION | CMD_TLM_CH_VOLUME_POT;
+    bool ok = true;
+
+    struct { const char *nome; size_t capacidade; } links[] = {
+        {"FIXED (64 B por transação)", CMD_LINK_FIXED_SIZE},
+        {"VARIABLE (até 260 B por transação)", CMD_LINK_MAX_BODY},
+    };
+
+    for (auto &l : links) {
+        printf("\n%s, %d amostras a %d Hz\n", l.nome, AMOSTRAS, TAXA_HZ);
+        printf("  %-30s %6s %9s %10s %12s %10s %10s\n", "Formato", "B/reg", "B/amostra", "amostra/tx", "tx/s @100Hz",
+               "enc am/us", "dec am/us");
+
+        // Referência: sensor_packet_t cru, quantos couberem no mesmo frame
+        size_t cabe = (l.capacidade - OVERHEAD) / SENSOR_PACKET_SIZE;
+        size_t frames = (AMOSTRAS + cabe - 1) / cabe;
+        printf("  %-30s %6zu %9.2f %10.1f %12.1f %10s %10s\n", "sensor_packet_t cru", SENSOR_PACKET_SIZE,
+               (double)(frames * OVERHEAD + AMOSTRAS * SENSOR_PACKET_SIZE) / AMOSTRAS, (double)cabe,
+               (double)TAXA_HZ / cabe, "-", "-");
+
+        Resultado r;
+        r = roda(serie, sensores, CMD_TLM_FMT_RAW, l.capacidade);
+        linha("RAW bolha+oclusão+pot", cmd_tlm_record_size(sensores), r);
+        ok &= r.ok;
+        r = roda(serie, sensores, CMD_TLM_FMT_DELTA, l.capacidade);
+        linha("DELTA bolha+oclusão+pot", cmd_tlm_record_size(sensores), r);
+        ok &= r.ok;
+        r = roda(serie, CMD_TLM_CH_ALL, CMD_TLM_FMT_RAW, l.capacidade);
+        linha("RAW todos os canais", cmd_tlm_record_size(CMD_TLM_CH_ALL), r);
+        ok &= r.ok;
+        r = roda(serie, CMD_TLM_CH_ALL, CMD_TLM_FMT_DELTA, l.capacidade);
+        linha("DELTA todos os canais", cmd_tlm_record_size(CMD_TLM_CH_ALL), r);
+        ok &= r.ok;
+    }
+
+    printf("\n(B/amostra inclui header, CRC e cabeçalho de telemetria de cada frame)\n");
+    return ok ? 0 : 1;
+}
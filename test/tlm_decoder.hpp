@@ -0,0 +1,85 @@
+/* tlm_decoder.hpp - Decodifica frames CMD_TLM_DATA (RAW e DELTA) no lado Host */
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+extern "C" {
+    #include "cmd.h"
+    #include "utl_varint.h"
+}
+
+// Acompanha a numeração das amostras entre frames para contar perdas.
+class TlmDecoder {
+public:
+    // Acrescenta em 'out' os registros do frame. Retorna false se o frame está malformado
+    // (nesse caso nada é acrescentado).
+    bool decode(const cmd_tlm_data_t &d, std::vector<cmd_tlm_record_t> &out)
+    {
+        size_t base = out.size();
+        if (!unpack(d, out)) {
+            out.resize(base);
+            return false;
+        }
+
+        if (expected_ >= 0 && d.first_sample != (uint16_t)expected_)
+            lost_ += (uint16_t)(d.first_sample - expected_);
+        expected_ = (uint16_t)(d.first_sample + d.count);
+        received_ += d.count;
+        dropped_ += d.dropped;
+        return true;
+    }
+
+    void reset() { expected_ = -1; received_ = lost_ = dropped_ = 0; }
+
+    uint32_t received() const { return received_; }
+    uint32_t lost() const { return lost_; }       // Buracos na numeração (frames perdidos no link)
+    uint32_t dropped() const { return dropped_; } // Descartados pelo escravo (fila cheia)
+
+private:
+    static bool unpack(const cmd_tlm_data_t &d, std::vector<cmd_tlm_record_t> &out)
+    {
+        const uint8_t *p = d.records;
+        const uint8_t *end = d.records + d.records_len;
+        size_t key_size = cmd_tlm_record_size(d.channels);
+
+        for (int i = 0; i < d.count; i++) {
+            cmd_tlm_record_t rec;
+
+            if (d.format == CMD_TLM_FMT_RAW || i == 0) {
+                if ((size_t)(end - p) < key_size) return false;
+                p += cmd_tlm_get_record(d.channels, &rec, const_cast<uint8_t *>(p));
+            }
+            else {
+                rec = out.back();
+                if (!delta(p, end, rec.timestamp)) return false;
+                if ((d.channels & CMD_TLM_CH_BUBBLE) && !delta(p, end, rec.bubble_mv)) return false;
+                if ((d.channels & CMD_TLM_CH_OCCLUSION) && !delta(p, end, rec.occlusion_mv)) return false;
+                if ((d.channels & CMD_TLM_CH_VOLUME_POT) && !delta(p, end, rec.volume_pot_mv)) return false;
+                if ((d.channels & CMD_TLM_CH_STATE) && !delta(p, end, rec.state)) return false;
+                if ((d.channels & CMD_TLM_CH_INFUSED) && !delta(p, end, rec.infused)) return false;
+                if ((d.channels & CMD_TLM_CH_PRESSURE) && !delta(p, end, rec.pressure)) return false;
+            }
+            out.push_back(rec);
+        }
+        return p == end;
+    }
+
+    // Lê um varint zigzag e soma ao campo (aritmética módulo o tamanho do campo, como no encoder)
+    template <typename T>
+    static bool delta(const uint8_t *&p, const uint8_t *end, T &field)
+    {
+        uint32_t raw;
+        size_t n = utl_varint_get(p, (size_t)(end - p), &raw);
+        if (n == 0) return false;
+        p += n;
+        field = (T)(field + (T)utl_varint_unzigzag(raw));
+        return true;
+    }
+
+    int expected_ = -1;
+    uint32_t received_ = 0;
+    uint32_t lost_ = 0;
+    uint32_t dropped_ = 0;
+};
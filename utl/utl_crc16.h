@@ -1,5 +1,57 @@
 #pragma once
 
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, MSB primeiro, sem XOR final.
+ *
+ * Motor escolhido em tempo de compilação por UTL_CRC16_SLICES (bytes por iteração):
+ *   1 - byte a byte, só a tabela de 512 bytes (builds com flash apertada)
+ *   4 - slicing-by-4, 2 KB de tabelas
+ *   8 - slicing-by-8, 4 KB de tabelas (padrão)
+ * No firmware vem do Kconfig (CONFIG_UTL_CRC16_SLICES); no host, -DUTL_CRC16_SLICES=N.
+ * O resultado é o mesmo nos três: só muda a vazão e o tamanho das tabelas. */
+#ifndef UTL_CRC16_SLICES
+#ifdef CONFIG_UTL_CRC16_SLICES
+#define UTL_CRC16_SLICES CONFIG_UTL_CRC16_SLICES
+#else
+#define UTL_CRC16_SLICES 8
+#endif
+#endif
+
+/* Tabela do CRC-16/CCITT (poly 0x1021), um byte por consulta */
+extern const uint16_t utl_crc16_ccitt_table[256];
+
+/* API incremental: crc = init(); crc = update(crc, ...) quantas vezes precisar; final(crc).
+ * Pedaços de qualquer tamanho e alinhamento dão o mesmo CRC que o buffer inteiro. */
+static inline uint16_t utl_crc16_init(void)
+{
+    return 0xFFFF;
+}
+
+uint16_t utl_crc16_update(uint16_t crc, const uint8_t* data, size_t len);
+
+static inline uint16_t utl_crc16_final(uint16_t crc)
+{
+    return crc; // CCITT-FALSE não tem XOR final
+}
+
+/* Forma antiga (acumulador por último), mesmo motor */
 uint16_t utl_crc16_data(const uint8_t* data, size_t len, uint16_t acc);
 
-#define utl_crc16(a, b) utl_crc16_data(a, b, 0xFFFF);
+/* Um byte no CRC corrente: para quem calcula o CRC enquanto escreve o frame */
+static inline uint16_t utl_crc16_byte(uint16_t crc, uint8_t value)
+{
+    return (uint16_t) ((crc << 8) ^ utl_crc16_ccitt_table[((crc >> 8) ^ value) & 0x00FF]);
+}
+
+#define utl_crc16(a, b) utl_crc16_data(a, b, 0xFFFF)
+
+#ifdef __cplusplus
+}
+#endif
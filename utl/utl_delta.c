@@ -0,0 +1,234 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+
+#include "utl_delta.h"
+#include "utl_crc16.h"
+#include "utl_io.h"
+#include "utl_varint.h"
+
+typedef enum
+{
+    DELTA_HDR,
+    DELTA_CTRL,
+    DELTA_DIFF,
+    DELTA_EXTRA,
+    DELTA_DONE,
+    DELTA_ERROR,
+} delta_state_t;
+
+// Campos de controle de um registro, na ordem do fio
+enum
+{
+    CTRL_DIFF,
+    CTRL_EXTRA,
+    CTRL_SEEK,
+};
+
+void utl_delta_dec_init(utl_delta_dec_t* d, uint32_t out_size, uint32_t base_version, uint32_t base_limit,
+                        utl_delta_read_t read, utl_delta_sink_t sink, void* arg)
+{
+    d->read = read;
+    d->sink = sink;
+    d->arg = arg;
+    d->base_version = base_version;
+    d->hdr_version = 0;
+    d->base_limit = base_limit;
+    d->base_size = 0;
+    d->base_pos = 0;
+    d->base_next = 0;
+    d->out_left = out_size;
+    d->out_done = 0;
+    d->diff = 0;
+    d->extra = 0;
+    d->value = 0;
+    d->shift = 0;
+    d->field = 0;
+    d->state = DELTA_HDR;
+}
+
+// CRC da base inteira, lida pelo buffer do decodificador
+static int delta_base_crc(utl_delta_dec_t* d, uint16_t* crc)
+{
+    *crc = utl_crc16_init();
+    for(uint32_t off = 0; off < d->base_size; off += UTL_DELTA_BUF_SIZE)
+    {
+        size_t n = d->base_size - off;
+        if(n > UTL_DELTA_BUF_SIZE)
+            n = UTL_DELTA_BUF_SIZE;
+        int ret = d->read(d->arg, off, d->buf, n);
+        if(ret < 0)
+            return ret;
+        *crc = utl_crc16_update(*crc, d->buf, n);
+    }
+    *crc = utl_crc16_final(*crc);
+    return 0;
+}
+
+// Cabeçalho completo em buf: confere formato e base
+static int delta_header(utl_delta_dec_t* d)
+{
+    uint8_t* p = d->buf;
+    uint32_t magic = utl_io_get32_fl_apr(&p);
+    d->hdr_version = utl_io_get32_fl_apr(&p);
+    d->base_size = utl_io_get32_fl_apr(&p);
+    uint32_t out_size = utl_io_get32_fl_apr(&p);
+    uint16_t base_crc = utl_io_get16_fl_apr(&p);
+    uint16_t crc;
+
+    if(magic != UTL_DELTA_MAGIC || out_size != d->out_left)
+        return -EBADMSG;
+    if(d->hdr_version != d->base_version || d->base_size > d->base_limit)
+        return -ENOEXEC;
+
+    int ret = delta_base_crc(d, &crc);
+    if(ret < 0)
+        return ret;
+    if(crc != base_crc)
+        return -ENOEXEC;
+
+    d->state = DELTA_CTRL;
+    return 0;
+}
+
+// Campo de controle completo em value: o seek fecha o registro e o valida inteiro
+static int delta_ctrl(utl_delta_dec_t* d)
+{
+    switch(d->field++)
+    {
+    case CTRL_DIFF:
+        d->diff = d->value;
+        return 0;
+    case CTRL_EXTRA:
+        d->extra = d->value;
+        break;
+    default:
+        break;
+    }
+
+    // O último registro acaba antes do seek, que só valeria para o próximo
+    if(d->field == CTRL_SEEK && (uint64_t) d->diff + d->extra < d->out_left)
+        return 0;
+
+    int64_t seek = (d->field > CTRL_SEEK) ? utl_varint_unzigzag(d->value) : 0;
+    int64_t next = (int64_t) d->base_pos + d->diff + seek;
+    if((uint64_t) d->diff + d->extra > d->out_left || (uint64_t) d->base_pos + d->diff > d->base_size || next < 0 ||
+       next > (int64_t) d->base_size)
+        return -EBADMSG;
+
+    d->field = 0;
+    d->base_next = (uint32_t) next;
+    if(d->diff != 0)
+        d->state = DELTA_DIFF;
+    else
+    {
+        d->base_pos = d->base_next;
+        d->state = (d->extra != 0) ? DELTA_EXTRA : DELTA_CTRL;
+    }
+    return 0;
+}
+
+// Saída produzida: acabou a imagem, ou passa para a próxima parte do registro
+static void delta_advance(utl_delta_dec_t* d, uint32_t n)
+{
+    d->out_left -= n;
+    d->out_done += n;
+    if(d->out_left == 0)
+        d->state = DELTA_DONE;
+    else if(d->state == DELTA_DIFF && d->diff == 0)
+    {
+        d->base_pos = d->base_next;
+        d->state = (d->extra != 0) ? DELTA_EXTRA : DELTA_CTRL;
+    }
+    else if(d->state == DELTA_EXTRA && d->extra == 0)
+        d->state = DELTA_CTRL;
+}
+
+// Até UTL_DELTA_BUF_SIZE bytes de diff: lê a base no buffer, soma e entrega
+static int delta_diff(utl_delta_dec_t* d, const uint8_t* in, size_t n)
+{
+    if(n > UTL_DELTA_BUF_SIZE)
+        n = UTL_DELTA_BUF_SIZE;
+    if(n > d->diff)
+        n = d->diff;
+
+    int ret = d->read(d->arg, d->base_pos, d->buf, n);
+    if(ret < 0)
+        return ret;
+    for(size_t i = 0; i < n; i++)
+        d->buf[i] += in[i];
+
+    ret = d->sink(d->arg, d->buf, n);
+    d->base_pos += (uint32_t) n;
+    d->diff -= (uint32_t) n;
+    delta_advance(d, (uint32_t) n);
+    return (ret < 0) ? ret : (int) n;
+}
+
+int utl_delta_dec_feed(utl_delta_dec_t* d, const uint8_t* in, size_t len)
+{
+    const uint8_t* end = in + len;
+    int ret = 0;
+
+    while(ret >= 0 && in < end)
+    {
+        switch(d->state)
+        {
+        case DELTA_HDR:
+            d->buf[d->field++] = *in++;
+            if(d->field == UTL_DELTA_HDR_SIZE)
+            {
+                d->field = 0;
+                ret = delta_header(d);
+            }
+            break;
+
+        case DELTA_CTRL:
+        {
+            uint8_t b = *in++;
+            if(d->shift >= 32 || (d->shift == 28 && (b & 0xF0) != 0))
+            {
+                ret = -EBADMSG;
+                break;
+            }
+            d->value |= (uint32_t) (b & 0x7F) << d->shift;
+            d->shift += 7;
+            if(b & 0x80)
+                break;
+            ret = delta_ctrl(d);
+            d->value = 0;
+            d->shift = 0;
+            break;
+        }
+
+        case DELTA_DIFF:
+            ret = delta_diff(d, in, (size_t) (end - in));
+            if(ret > 0)
+                in += ret;
+            break;
+
+        case DELTA_EXTRA:
+        {
+            size_t n = (size_t) (end - in);
+            if(n > d->extra)
+                n = d->extra;
+            ret = d->sink(d->arg, in, n);
+            in += n;
+            d->extra -= (uint32_t) n;
+            delta_advance(d, (uint32_t) n);
+            break;
+        }
+
+        default: // Bytes depois do fim, ou patch que já deu erro
+            ret = -EBADMSG;
+            break;
+        }
+    }
+
+    if(ret < 0)
+    {
+        d->state = DELTA_ERROR;
+        return ret;
+    }
+    return 0;
+}
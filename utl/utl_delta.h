@@ -0,0 +1,125 @@
+/**
+@file
+
+@defgroup DELTA DELTA
+@brief Aplicação incremental de um patch binário (estilo bsdiff) sobre uma imagem base.
+
+O patch começa com um cabeçalho de @ref UTL_DELTA_HDR_SIZE bytes, little endian:
+
+    magic (4) | versão da base (4) | tamanho da base (4) | tamanho da saída (4) | CRC-16 da base (2)
+
+- magic: @ref UTL_DELTA_MAGIC ("DLT1").
+- versão da base: (major << 16) | (minor << 8) | patch, como o APP_VERSION_NUMBER do Zephyr.
+- CRC-16/CCITT (utl_crc16) dos primeiros 'tamanho da base' bytes da base.
+
+Depois vêm registros, cada um com três varints (utl_varint) e os dados:
+
+    diff | extra | seek (zigzag) | diff bytes | extra bytes
+
+- diff bytes: saída = base[pos + i] + patch[i] (mod 256); pos avança diff.
+- extra bytes: vão para a saída como estão.
+- seek: pos += seek, com sinal, depois dos dados (pos fica entre 0 e o tamanho da base).
+
+Onde a imagem nova só mudou endereços, os bytes de diff são quase todos zero: o patch
+comprime bem (utl_lz). O patch termina quando a saída completa o tamanho do cabeçalho,
+no fim do diff ou do extra de um registro; o seek do último registro não vai.
+
+A base é lida por um callback, de onde estiver (o slot0, para o OTA): antes do primeiro
+byte de saída ela é conferida inteira contra versão, tamanho e CRC do cabeçalho. A saída
+sai pelo sink, em ordem, em pedaços de até @ref UTL_DELTA_BUF_SIZE bytes (diff) ou do
+tamanho que veio no feed (extra). A entrada pode ser partida em qualquer ponto.
+@{
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** "DLT1" em little endian */
+#define UTL_DELTA_MAGIC 0x31544C44u
+
+/** Tamanho do cabeçalho do patch */
+#define UTL_DELTA_HDR_SIZE 18
+
+#ifndef UTL_DELTA_BUF_SIZE
+/** Bytes da base lidos por vez (buffer dentro do decodificador) */
+#define UTL_DELTA_BUF_SIZE 64
+#endif
+
+#if UTL_DELTA_BUF_SIZE < UTL_DELTA_HDR_SIZE
+#error "UTL_DELTA_BUF_SIZE: o cabeçalho é montado no mesmo buffer"
+#endif
+
+/** Lê len bytes da base a partir de offset. Retorno < 0 interrompe o patch. */
+typedef int (*utl_delta_read_t)(void* arg, uint32_t offset, uint8_t* buf, size_t len);
+
+/** Recebe a saída. Retorno < 0 interrompe o patch e volta do utl_delta_dec_feed. */
+typedef int (*utl_delta_sink_t)(void* arg, const uint8_t* data, size_t len);
+
+/** Estado do decodificador (não mexer nos campos) */
+typedef struct
+{
+    utl_delta_read_t read;
+    utl_delta_sink_t sink;
+    void* arg;
+    uint32_t base_version; ///< Versão que a base precisa ter
+    uint32_t hdr_version;  ///< Versão que o patch pede (0 até ler o cabeçalho)
+    uint32_t base_limit;   ///< Maior base que dá para ler
+    uint32_t base_size;    ///< Do cabeçalho
+    uint32_t base_pos;     ///< Próximo byte da base para o diff
+    uint32_t base_next;    ///< base_pos depois do diff e do seek do registro corrente
+    uint32_t out_left;     ///< Bytes de saída que ainda faltam
+    uint32_t out_done;     ///< Bytes de saída já produzidos
+    uint32_t diff;         ///< Registro corrente: bytes de diff que faltam
+    uint32_t extra;        ///< Registro corrente: bytes de extra que faltam
+    uint32_t value;        ///< Varint em montagem
+    uint8_t shift;
+    uint8_t field;         ///< Varint do registro sendo lido (0..2), ou bytes do cabeçalho
+    uint8_t state;
+    uint8_t buf[UTL_DELTA_BUF_SIZE]; ///< Cabeçalho, depois bytes da base
+} utl_delta_dec_t;
+
+/**
+  Prepara o decodificador para um patch.
+  @param[out] d decodificador
+  @param[in] out_size tamanho da saída (> 0), que o cabeçalho precisa repetir
+  @param[in] base_version versão que o cabeçalho precisa ter
+  @param[in] base_limit maior tamanho de base aceito (o que o read alcança)
+  @param[in] read leitura da base
+  @param[in] sink destino da saída
+  @param[in] arg repassado a read e sink
+*/
+void utl_delta_dec_init(utl_delta_dec_t* d, uint32_t out_size, uint32_t base_version, uint32_t base_limit,
+                        utl_delta_read_t read, utl_delta_sink_t sink, void* arg);
+
+/**
+  Consome mais um pedaço do patch.
+  @param[in,out] d decodificador
+  @param[in] in bytes do patch
+  @param[in] len bytes em in
+  @return 0; -ENOEXEC se o patch é para outra base (versão, tamanho ou CRC); -EBADMSG se
+          ele é inválido (magic, tamanho da saída, registro fora da base ou além do fim);
+          ou o erro de read ou sink. Depois de um erro o decodificador só volta com
+          utl_delta_dec_init.
+*/
+int utl_delta_dec_feed(utl_delta_dec_t* d, const uint8_t* in, size_t len);
+
+/** A saída inteira foi produzida (e entregue ao sink) */
+static inline bool utl_delta_dec_done(const utl_delta_dec_t* d)
+{
+    return d->out_left == 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
@@ -19,12 +19,22 @@ Exemplos:
 - utl_io_get16fb()
 - utl_io_putf_tl()
 - utl_io_get32fl_ap()
+
+Todas são static inline: no little endian, cada get/put de 16/32/64 bits vira uma única
+leitura/escrita desalinhada (memcpy de tamanho fixo, que o compilador troca pela
+instrução); no big endian, a mesma leitura seguida de um bswap. Os payloads packed
+(struct na ordem do fio) têm ainda @ref utl_io_get_packed_fl / @ref utl_io_put_packed_tl,
+que movem a struct inteira de uma vez. Em C++ há versões constexpr em utl_io::.
 @{
 
 */
 
 #pragma once
 
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -36,6 +46,13 @@ extern "C"
 /** Número de elementos em um array */
 #define HAL_IO_ARRAY_SIZE(a) (sizeof(a) / sizeof(a[0]))
 
+/** 1 quando a CPU é little endian (a ordem do fio do protocolo) */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define UTL_IO_LITTLE_ENDIAN 0
+#else
+#define UTL_IO_LITTLE_ENDIAN 1
+#endif
+
 /**
   @name Funções de inversão da ordem de bytes dentro de um tipo de dado (swap).
   @{
@@ -46,14 +63,20 @@ extern "C"
   @param[in] usShort inteiro de 16 bits sem sinal a ser invertido
   @return inteiro de 16 bits sem sinal invertido
  */
-uint16_t utl_io_swap16(uint16_t usShort);
+static inline uint16_t utl_io_swap16(uint16_t usShort)
+{
+    return __builtin_bswap16(usShort);
+}
 
 /**
   Inverte um inteiro de 32 bits sem sinal.
   @param[in] ulLong inteiro de 32 bits sem sinal a ser invertido
   @return inteiro de 32 bits sem sinal invertido
  */
-uint32_t utl_io_swap32(uint32_t ulLong);
+static inline uint32_t utl_io_swap32(uint32_t ulLong)
+{
+    return __builtin_bswap32(ulLong);
+}
 
 /**
   Inverte um inteiro de 16 bits sem sinal dentro de um buffer.
@@ -74,49 +97,167 @@ void utl_io_swap32p(uint8_t* pucPtr);
 uint8_t utl_io_swap8b(uint8_t ucChar);
 /** @} */
 
+/* Acesso cru na ordem da CPU: memcpy de tamanho constante = um LDR/STR desalinhado */
+static inline uint16_t utl_io_ld16(const uint8_t* buf)
+{
+    uint16_t v;
+    memcpy(&v, buf, sizeof(v));
+    return v;
+}
+
+static inline uint32_t utl_io_ld32(const uint8_t* buf)
+{
+    uint32_t v;
+    memcpy(&v, buf, sizeof(v));
+    return v;
+}
+
+static inline uint64_t utl_io_ld64(const uint8_t* buf)
+{
+    uint64_t v;
+    memcpy(&v, buf, sizeof(v));
+    return v;
+}
+
+static inline void utl_io_st16(uint16_t v, uint8_t* buf)
+{
+    memcpy(buf, &v, sizeof(v));
+}
+
+static inline void utl_io_st32(uint32_t v, uint8_t* buf)
+{
+    memcpy(buf, &v, sizeof(v));
+}
+
+static inline void utl_io_st64(uint64_t v, uint8_t* buf)
+{
+    memcpy(buf, &v, sizeof(v));
+}
+
+/* Converte entre a ordem da CPU e little (le) / big (be) endian; o inverso é a mesma operação */
+#if UTL_IO_LITTLE_ENDIAN
+#define utl_io_le16(v) (v)
+#define utl_io_le32(v) (v)
+#define utl_io_le64(v) (v)
+#define utl_io_be16(v) __builtin_bswap16(v)
+#define utl_io_be32(v) __builtin_bswap32(v)
+#define utl_io_be64(v) __builtin_bswap64(v)
+#else
+#define utl_io_le16(v) __builtin_bswap16(v)
+#define utl_io_le32(v) __builtin_bswap32(v)
+#define utl_io_le64(v) __builtin_bswap64(v)
+#define utl_io_be16(v) (v)
+#define utl_io_be32(v) (v)
+#define utl_io_be64(v) (v)
+#endif
+
+/* Variante _apr: lê/escreve e avança o ponteiro do chamador */
+#define UTL_IO_GET_APR(name, type, n)                                                                              \
+    static inline type name##_apr(uint8_t** buf)                                                                   \
+    {                                                                                                              \
+        type value = name(*buf);                                                                                   \
+        *buf += (n);                                                                                               \
+        return value;                                                                                              \
+    }
+
+#define UTL_IO_PUT_APR(name, type, n)                                                                              \
+    static inline void name##_apr(type value, uint8_t** buf)                                                       \
+    {                                                                                                              \
+        name(value, *buf);                                                                                         \
+        *buf += (n);                                                                                               \
+    }
+
 /**
   @name Funções dependentes de alinhamento (GET)
   @{
 */
-uint8_t utl_io_get8_fl(uint8_t* buf);               /**< Pega um uint8_t usando little endian */
-uint8_t utl_io_get8_fb(uint8_t* buf);               /**< Pega um uint8_t usando big endian */
-uint8_t utl_io_get8_fl_apr(uint8_t** buf);          /**< Pega um uint8_t usando little endian e adiciona o ponteiro */
-uint8_t utl_io_get8_fb_apr(uint8_t** buf);          /**< Pega um uint8_t usando big endian e adiciona o ponteiro */
+static inline uint8_t utl_io_get8_fl(const uint8_t* buf) /**< Pega um uint8_t usando little endian */
+{
+    return buf[0];
+}
+static inline uint8_t utl_io_get8_fb(const uint8_t* buf) /**< Pega um uint8_t usando big endian */
+{
+    return buf[0];
+}
+UTL_IO_GET_APR(utl_io_get8_fl, uint8_t, 1)          /**< Pega um uint8_t usando little endian e adiciona o ponteiro */
+UTL_IO_GET_APR(utl_io_get8_fb, uint8_t, 1)          /**< Pega um uint8_t usando big endian e adiciona o ponteiro */
 #define utl_io_get8_fl_ap(x) utl_io_get8_fl_apr(&x) /**< Macro para facilitar @ref utl_io_get8_fl_apr */
 #define utl_io_get8_fb_ap(x) utl_io_get8_fb_apr(&x) /**< Macro para facilitar @ref utl_io_get8_fb_apr */
 
-uint16_t utl_io_get16_fl(uint8_t* buf);      /**< Pega um uint16_t usando little endian */
-uint16_t utl_io_get16_fb(uint8_t* buf);      /**< Pega um uint16_t usando big endian */
-uint16_t utl_io_get16_fl_apr(uint8_t** buf); /**< Pega um uint16_t usando little endian e adiciona o ponteiro */
-uint16_t utl_io_get16_fb_apr(uint8_t** buf); /**< Pega um uint16_t usando big endian e adiciona o ponteiro */
+static inline uint16_t utl_io_get16_fl(const uint8_t* buf) /**< Pega um uint16_t usando little endian */
+{
+    return utl_io_le16(utl_io_ld16(buf));
+}
+static inline uint16_t utl_io_get16_fb(const uint8_t* buf) /**< Pega um uint16_t usando big endian */
+{
+    return utl_io_be16(utl_io_ld16(buf));
+}
+UTL_IO_GET_APR(utl_io_get16_fl, uint16_t, 2)          /**< Pega um uint16_t usando little endian e adiciona o ponteiro */
+UTL_IO_GET_APR(utl_io_get16_fb, uint16_t, 2)          /**< Pega um uint16_t usando big endian e adiciona o ponteiro */
 #define utl_io_get16_fl_ap(x) utl_io_get16_fl_apr(&x) /**< Macro para facilitar @ref utl_io_get16_fl_apr */
 #define utl_io_get16_fb_ap(x) utl_io_get16_fb_apr(&x) /**< Macro para facilitar @ref utl_io_get16_fb_apr */
 
-uint32_t utl_io_get32_fl(uint8_t* buf);      /**< Pega um uint32_t usando little endian */
-uint32_t utl_io_get32_fb(uint8_t* buf);      /**< Pega um uint32_t usando big endian */
-uint32_t utl_io_get32_fl_apr(uint8_t** buf); /**< Pega um uint32_t usando little endian e adiciona o ponteiro */
-uint32_t utl_io_get32_fb_apr(uint8_t** buf); /**< Pega um uint32_t usando big endian e adiciona o ponteiro */
+static inline uint32_t utl_io_get32_fl(const uint8_t* buf) /**< Pega um uint32_t usando little endian */
+{
+    return utl_io_le32(utl_io_ld32(buf));
+}
+static inline uint32_t utl_io_get32_fb(const uint8_t* buf) /**< Pega um uint32_t usando big endian */
+{
+    return utl_io_be32(utl_io_ld32(buf));
+}
+UTL_IO_GET_APR(utl_io_get32_fl, uint32_t, 4)          /**< Pega um uint32_t usando little endian e adiciona o ponteiro */
+UTL_IO_GET_APR(utl_io_get32_fb, uint32_t, 4)          /**< Pega um uint32_t usando big endian e adiciona o ponteiro */
 #define utl_io_get32_fl_ap(x) utl_io_get32_fl_apr(&x) /**< Macro para facilitar @ref utl_io_get32_fl_apr */
 #define utl_io_get32_fb_ap(x) utl_io_get32_fb_apr(&x) /**< Macro para facilitar @ref utl_io_get32_fb_apr */
 
-uint64_t utl_io_get64_fl(uint8_t* buf);      /**< Pega um uint64_t usando little endian */
-uint64_t utl_io_get64_fb(uint8_t* buf);      /**< Pega um uint64_t usando big endian */
-uint64_t utl_io_get64_fl_apr(uint8_t** buf); /**< Pega um uint64_t usando little endian e adiciona o ponteiro */
-uint64_t utl_io_get64_fb_apr(uint8_t** buf); /**< Pega um uint64_t usando big endian e adiciona o ponteiro */
+static inline uint64_t utl_io_get64_fl(const uint8_t* buf) /**< Pega um uint64_t usando little endian */
+{
+    return utl_io_le64(utl_io_ld64(buf));
+}
+static inline uint64_t utl_io_get64_fb(const uint8_t* buf) /**< Pega um uint64_t usando big endian */
+{
+    return utl_io_be64(utl_io_ld64(buf));
+}
+UTL_IO_GET_APR(utl_io_get64_fl, uint64_t, 8)          /**< Pega um uint64_t usando little endian e adiciona o ponteiro */
+UTL_IO_GET_APR(utl_io_get64_fb, uint64_t, 8)          /**< Pega um uint64_t usando big endian e adiciona o ponteiro */
 #define utl_io_get64_fl_ap(x) utl_io_get64_fl_apr(&x) /**< Macro para facilitar @ref utl_io_get64_fl_apr */
 #define utl_io_get64_fb_ap(x) utl_io_get64_fb_apr(&x) /**< Macro para facilitar @ref utl_io_get64_fb_apr */
 
-float utl_io_getf_fl(uint8_t* src_ptr);             /**< Pega um float usando little endian */
-float utl_io_getf_fb(uint8_t* src_ptr);             /**< Pega um float usando big endian */
-float utl_io_getf_fl_apr(uint8_t** src_ptr);        /**< Pega um float usando little endian e adiciona o ponteiro */
-float utl_io_getf_fb_apr(uint8_t** src_ptr);        /**< Pega um float usando big endian e adiciona o ponteiro */
+static inline float utl_io_getf_fl(const uint8_t* src_ptr) /**< Pega um float usando little endian */
+{
+    uint32_t bits = utl_io_get32_fl(src_ptr);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+static inline float utl_io_getf_fb(const uint8_t* src_ptr) /**< Pega um float usando big endian */
+{
+    uint32_t bits = utl_io_get32_fb(src_ptr);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+UTL_IO_GET_APR(utl_io_getf_fl, float, 4)            /**< Pega um float usando little endian e adiciona o ponteiro */
+UTL_IO_GET_APR(utl_io_getf_fb, float, 4)            /**< Pega um float usando big endian e adiciona o ponteiro */
 #define utl_io_getf_fl_ap(x) utl_io_getf_fl_apr(&x) /**< Macro para facilitar @ref utl_io_getf_fl_apr */
 #define utl_io_getf_fb_ap(x) utl_io_getf_fb_apr(&x) /**< Macro para facilitar @ref utl_io_getf_fb_apr */
 
-double utl_io_getd_fl(uint8_t* src_ptr);            /**< Pega um double usando little endian */
-double utl_io_getd_fb(uint8_t* src_ptr);            /**< Pega um double usando big endian */
-double utl_io_getd_fl_apr(uint8_t** src_ptr);       /**< Pega um double usando little endian e adiciona o ponteiro */
-double utl_io_getd_fb_apr(uint8_t** src_ptr);       /**< Pega um double usando big endian e adiciona o ponteiro */
+static inline double utl_io_getd_fl(const uint8_t* src_ptr) /**< Pega um double usando little endian */
+{
+    uint64_t bits = utl_io_get64_fl(src_ptr);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+static inline double utl_io_getd_fb(const uint8_t* src_ptr) /**< Pega um double usando big endian */
+{
+    uint64_t bits = utl_io_get64_fb(src_ptr);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+UTL_IO_GET_APR(utl_io_getd_fl, double, 8)           /**< Pega um double usando little endian e adiciona o ponteiro */
+UTL_IO_GET_APR(utl_io_getd_fb, double, 8)           /**< Pega um double usando big endian e adiciona o ponteiro */
 #define utl_io_getd_fl_ap(x) utl_io_getd_fl_apr(&x) /**< Macro para facilitar @ref utl_io_getd_fl_apr */
 #define utl_io_getd_fb_ap(x) utl_io_getd_fb_apr(&x) /**< Macro para facilitar @ref utl_io_getd_fb_apr */
 /** @} */
@@ -125,53 +266,89 @@ double utl_io_getd_fb_apr(uint8_t** src_ptr);       /**< Pega um double usando b
   @name Funções dependentes de alinhamento (PUT)
   @{
 */
-void utl_io_put8_tl(uint8_t value, uint8_t* buf); /**< Coloca um uint8_t usando little endian */
-void utl_io_put8_tb(uint8_t value, uint8_t* buf); /**< Coloca um uint8_t usando big endian */
-void utl_io_put8_tl_apr(uint8_t value,
-                        uint8_t** buf); /**< Coloca um uint8_t usando little endian e adiciona o ponteiro */
-void utl_io_put8_tb_apr(uint8_t value, uint8_t** buf); /**< Coloca um uint8_t usando big endian e adiciona o ponteiro */
+static inline void utl_io_put8_tl(uint8_t value, uint8_t* buf) /**< Coloca um uint8_t usando little endian */
+{
+    buf[0] = value;
+}
+static inline void utl_io_put8_tb(uint8_t value, uint8_t* buf) /**< Coloca um uint8_t usando big endian */
+{
+    buf[0] = value;
+}
+UTL_IO_PUT_APR(utl_io_put8_tl, uint8_t, 1) /**< Coloca um uint8_t usando little endian e adiciona o ponteiro */
+UTL_IO_PUT_APR(utl_io_put8_tb, uint8_t, 1) /**< Coloca um uint8_t usando big endian e adiciona o ponteiro */
 #define utl_io_put8_tl_ap(v, x) utl_io_put8_tl_apr(v, &x) /**< Macro para facilitar @ref utl_io_put8_tl_apr */
 #define utl_io_put8_tb_ap(v, x) utl_io_put8_tb_apr(v, &x) /**< Macro para facilitar @ref utl_io_put8_tb_apr */
 
-void utl_io_put16_tl(uint16_t value, uint8_t* buf); /**< Coloca um uint16_t usando little endian */
-void utl_io_put16_tb(uint16_t value, uint8_t* buf); /**< Coloca um uint16_t usando big endian */
-void utl_io_put16_tl_apr(uint16_t value,
-                         uint8_t** buf); /**< Coloca um uint16_t usando little endian e adiciona o ponteiro */
-void utl_io_put16_tb_apr(uint16_t value,
-                         uint8_t** buf); /**< Coloca um uint16_t usando big endian e adiciona o ponteiro */
+static inline void utl_io_put16_tl(uint16_t value, uint8_t* buf) /**< Coloca um uint16_t usando little endian */
+{
+    utl_io_st16(utl_io_le16(value), buf);
+}
+static inline void utl_io_put16_tb(uint16_t value, uint8_t* buf) /**< Coloca um uint16_t usando big endian */
+{
+    utl_io_st16(utl_io_be16(value), buf);
+}
+UTL_IO_PUT_APR(utl_io_put16_tl, uint16_t, 2) /**< Coloca um uint16_t usando little endian e adiciona o ponteiro */
+UTL_IO_PUT_APR(utl_io_put16_tb, uint16_t, 2) /**< Coloca um uint16_t usando big endian e adiciona o ponteiro */
 #define utl_io_put16_tl_ap(v, x) utl_io_put16_tl_apr(v, &x) /**< Macro para facilitar @ref utl_io_put16_tl_apr */
 #define utl_io_put16_tb_ap(v, x) utl_io_put16_tb_apr(v, &x) /**< Macro para facilitar @ref utl_io_put16_tb_apr */
 
-void utl_io_put32_tl(uint32_t value, uint8_t* buf); /**< Coloca um uint32_t usando little endian */
-void utl_io_put32_tb(uint32_t value, uint8_t* buf); /**< Coloca um uint32_t usando big endian */
-void utl_io_put32_tl_apr(uint32_t value,
-                         uint8_t** buf); /**< Coloca um uint32_t usando little endian e adiciona o ponteiro */
-void utl_io_put32_tb_apr(uint32_t value,
-                         uint8_t** buf); /**< Coloca um uint32_t usando big endian e adiciona o ponteiro */
+static inline void utl_io_put32_tl(uint32_t value, uint8_t* buf) /**< Coloca um uint32_t usando little endian */
+{
+    utl_io_st32(utl_io_le32(value), buf);
+}
+static inline void utl_io_put32_tb(uint32_t value, uint8_t* buf) /**< Coloca um uint32_t usando big endian */
+{
+    utl_io_st32(utl_io_be32(value), buf);
+}
+UTL_IO_PUT_APR(utl_io_put32_tl, uint32_t, 4) /**< Coloca um uint32_t usando little endian e adiciona o ponteiro */
+UTL_IO_PUT_APR(utl_io_put32_tb, uint32_t, 4) /**< Coloca um uint32_t usando big endian e adiciona o ponteiro */
 #define utl_io_put32_tl_ap(v, x) utl_io_put32_tl_apr(v, &x) /**< Macro para facilitar @ref utl_io_put32_tl_apr */
 #define utl_io_put32_tb_ap(v, x) utl_io_put32_tb_apr(v, &x) /**< Macro para facilitar @ref utl_io_put32_tb_apr */
 
-void utl_io_put64_tl(uint64_t value, uint8_t* buf); /**< Coloca um uint64_t usando little endian */
-void utl_io_put64_tb(uint64_t value, uint8_t* buf); /**< Coloca um uint64_t usando big endian */
-void utl_io_put64_tl_apr(uint64_t value,
-                         uint8_t** buf); /**< Coloca um uint64_t usando little endian e adiciona o ponteiro */
-void utl_io_put64_tb_apr(uint64_t value,
-                         uint8_t** buf); /**< Coloca um uint64_t usando big endian e adiciona o ponteiro */
+static inline void utl_io_put64_tl(uint64_t value, uint8_t* buf) /**< Coloca um uint64_t usando little endian */
+{
+    utl_io_st64(utl_io_le64(value), buf);
+}
+static inline void utl_io_put64_tb(uint64_t value, uint8_t* buf) /**< Coloca um uint64_t usando big endian */
+{
+    utl_io_st64(utl_io_be64(value), buf);
+}
+UTL_IO_PUT_APR(utl_io_put64_tl, uint64_t, 8) /**< Coloca um uint64_t usando little endian e adiciona o ponteiro */
+UTL_IO_PUT_APR(utl_io_put64_tb, uint64_t, 8) /**< Coloca um uint64_t usando big endian e adiciona o ponteiro */
 #define utl_io_put64_tl_ap(v, x) utl_io_put64_tl_apr(v, &x) /**< Macro para facilitar @ref utl_io_put64_tl_apr */
 #define utl_io_put64_tb_ap(v, x) utl_io_put64_tb_apr(v, &x) /**< Macro para facilitar @ref utl_io_put64_tb_apr */
 
-void utl_io_putf_tl(float value, uint8_t* buf);      /**< Coloca um float usando little endian */
-void utl_io_putf_tb(float value, uint8_t* buf);      /**< Coloca um float usando big endian */
-void utl_io_putf_tl_apr(float value, uint8_t** buf); /**< Coloca um float usando little endian e adiciona o ponteiro */
-void utl_io_putf_tb_apr(float value, uint8_t** buf); /**< Coloca um float usando big endian e adiciona o ponteiro */
+static inline void utl_io_putf_tl(float value, uint8_t* buf) /**< Coloca um float usando little endian */
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    utl_io_put32_tl(bits, buf);
+}
+static inline void utl_io_putf_tb(float value, uint8_t* buf) /**< Coloca um float usando big endian */
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    utl_io_put32_tb(bits, buf);
+}
+UTL_IO_PUT_APR(utl_io_putf_tl, float, 4) /**< Coloca um float usando little endian e adiciona o ponteiro */
+UTL_IO_PUT_APR(utl_io_putf_tb, float, 4) /**< Coloca um float usando big endian e adiciona o ponteiro */
 #define utl_io_putf_tl_ap(v, x) utl_io_putf_tl_apr(v, &x) /**< Macro para facilitar @ref utl_io_putf_tl_apr */
 #define utl_io_putf_tb_ap(v, x) utl_io_putf_tb_apr(v, &x) /**< Macro para facilitar @ref utl_io_putf_tb_apr */
 
-void utl_io_putd_tl(double value, uint8_t* buf); /**< Coloca um double usando little endian */
-void utl_io_putd_tb(double value, uint8_t* buf); /**< Coloca um double usando big endian */
-void utl_io_putd_tl_apr(double value,
-                        uint8_t** buf); /**< Coloca um double usando little endian e adiciona o ponteiro */
-void utl_io_putd_tb_apr(double value, uint8_t** buf); /**< Coloca um double usando big endian e adiciona o ponteiro */
+static inline void utl_io_putd_tl(double value, uint8_t* buf) /**< Coloca um double usando little endian */
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    utl_io_put64_tl(bits, buf);
+}
+static inline void utl_io_putd_tb(double value, uint8_t* buf) /**< Coloca um double usando big endian */
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    utl_io_put64_tb(bits, buf);
+}
+UTL_IO_PUT_APR(utl_io_putd_tl, double, 8) /**< Coloca um double usando little endian e adiciona o ponteiro */
+UTL_IO_PUT_APR(utl_io_putd_tb, double, 8) /**< Coloca um double usando big endian e adiciona o ponteiro */
 #define utl_io_putd_tl_ap(v, x) utl_io_putd_tl_apr(v, &x) /**< Macro para facilitar @ref utl_io_putd_tl_apr */
 #define utl_io_putd_tb_ap(v, x) utl_io_putd_tb_apr(v, &x) /**< Macro para facilitar @ref utl_io_putd_tb_apr */
 
@@ -179,8 +356,83 @@ void utl_io_memcpy_tl(uint8_t* dst, const uint8_t* src, uint16_t size); /**< Cop
 
 /** @} */
 
+/**
+  @name Payloads packed inteiros (struct __attribute__((packed)) na ordem do fio, little endian)
+  Num alvo little endian a struct packed já é a imagem do fio: um memcpy só, em vez de um
+  get/put por campo. Só existem em alvos little endian (no big endian, campo a campo).
+  @{
+*/
+#if UTL_IO_LITTLE_ENDIAN
+/** Copia 'size' bytes do fio para a struct 'dst'. Retorna o ponteiro depois do payload. */
+static inline const uint8_t* utl_io_get_packed_fl(void* dst, const uint8_t* buf, size_t size)
+{
+    memcpy(dst, buf, size);
+    return buf + size;
+}
+
+/** Copia a struct 'src' ('size' bytes) para o fio. Retorna o ponteiro depois do payload. */
+static inline uint8_t* utl_io_put_packed_tl(const void* src, size_t size, uint8_t* buf)
+{
+    memcpy(buf, src, size);
+    return buf + size;
+}
+#endif
+/** @} */
+
+#undef UTL_IO_GET_APR
+#undef UTL_IO_PUT_APR
+
 #ifdef __cplusplus
 }
+
+/* Versões constexpr (C++): mesmas operações, avaliáveis em tempo de compilação.
+ * Fora de contexto constante, o GCC/Clang juntam os bytes numa leitura só.
+ * extern "C++": o header também é incluído de dentro de blocos extern "C". */
+extern "C++" {
+namespace utl_io {
+
+template <typename T>
+constexpr T get_fl(const uint8_t* buf)
+{
+    T value = 0;
+    for(size_t i = 0; i < sizeof(T); i++)
+    {
+        value |= (T) ((T) buf[i] << (8 * i));
+    }
+    return value;
+}
+
+template <typename T>
+constexpr T get_fb(const uint8_t* buf)
+{
+    T value = 0;
+    for(size_t i = 0; i < sizeof(T); i++)
+    {
+        value = (T) ((value << 8) | buf[i]);
+    }
+    return value;
+}
+
+template <typename T>
+constexpr void put_tl(T value, uint8_t* buf)
+{
+    for(size_t i = 0; i < sizeof(T); i++)
+    {
+        buf[i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+template <typename T>
+constexpr void put_tb(T value, uint8_t* buf)
+{
+    for(size_t i = 0; i < sizeof(T); i++)
+    {
+        buf[sizeof(T) - 1 - i] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+} // namespace utl_io
+}
 #endif
 
 /** @} */
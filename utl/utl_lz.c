@@ -0,0 +1,181 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include "utl_lz.h"
+
+#define LZ_MASK (UTL_LZ_WINDOW - 1)
+
+typedef enum
+{
+    LZ_TOKEN,
+    LZ_LIT_EXT,
+    LZ_LIT,
+    LZ_OFF_LO,
+    LZ_OFF_HI,
+    LZ_MATCH_EXT,
+    LZ_DONE,
+    LZ_ERROR,
+} lz_state_t;
+
+void utl_lz_dec_init(utl_lz_dec_t* d, uint32_t out_size, utl_lz_sink_t sink, void* arg)
+{
+    d->sink = sink;
+    d->arg = arg;
+    d->out_left = out_size;
+    d->out_done = 0;
+    d->count = 0;
+    d->offset = 0;
+    d->pos = 0;
+    d->flushed = 0;
+    d->state = LZ_TOKEN;
+    d->token = 0;
+}
+
+// Entrega ao sink o que foi produzido desde a última vez; no fim do anel volta ao começo
+static int lz_flush(utl_lz_dec_t* d)
+{
+    int ret = 0;
+
+    if(d->pos > d->flushed)
+        ret = d->sink(d->arg, &d->window[d->flushed], d->pos - d->flushed);
+    d->flushed = d->pos;
+    if(d->pos == UTL_LZ_WINDOW)
+        d->pos = d->flushed = 0;
+    return ret;
+}
+
+static int lz_literals(utl_lz_dec_t* d, const uint8_t* p, size_t n)
+{
+    d->out_left -= n;
+    d->out_done += n;
+    while(n > 0)
+    {
+        size_t k = UTL_LZ_WINDOW - d->pos;
+        if(k > n)
+            k = n;
+        memcpy(&d->window[d->pos], p, k);
+        d->pos += k;
+        p += k;
+        n -= k;
+        if(d->pos == UTL_LZ_WINDOW)
+        {
+            int ret = lz_flush(d);
+            if(ret < 0)
+                return ret;
+        }
+    }
+    return 0;
+}
+
+// Byte a byte: o match pode se sobrepor ao que ele mesmo está escrevendo
+static int lz_match(utl_lz_dec_t* d)
+{
+    uint32_t n = d->count;
+    uint16_t src = (d->pos - d->offset) & LZ_MASK;
+
+    if(n > d->out_left)
+        return -EBADMSG;
+    d->out_left -= n;
+    d->out_done += n;
+    while(n-- > 0)
+    {
+        d->window[d->pos++] = d->window[src];
+        src = (src + 1) & LZ_MASK;
+        if(d->pos == UTL_LZ_WINDOW)
+        {
+            int ret = lz_flush(d);
+            if(ret < 0)
+                return ret;
+        }
+    }
+    d->state = (d->out_left == 0) ? LZ_DONE : LZ_TOKEN;
+    return 0;
+}
+
+static int lz_offset_ok(const utl_lz_dec_t* d)
+{
+    return d->offset != 0 && d->offset <= d->out_done && d->offset <= UTL_LZ_WINDOW;
+}
+
+int utl_lz_dec_feed(utl_lz_dec_t* d, const uint8_t* in, size_t len)
+{
+    const uint8_t* end = in + len;
+    int ret = 0;
+
+    while(ret == 0 && in < end)
+    {
+        switch(d->state)
+        {
+        case LZ_TOKEN:
+            d->token = *in++;
+            d->count = d->token >> 4;
+            d->state = (d->count == 15) ? LZ_LIT_EXT : LZ_LIT;
+            break;
+
+        case LZ_LIT_EXT:
+            d->count += *in;
+            if(d->count > d->out_left)
+                ret = -EBADMSG;
+            else if(*in++ != 255)
+                d->state = LZ_LIT;
+            break;
+
+        case LZ_LIT:
+        {
+            size_t n = (size_t) (end - in);
+            if(n > d->count)
+                n = d->count;
+            if(d->count > d->out_left)
+            {
+                ret = -EBADMSG;
+                break;
+            }
+            ret = lz_literals(d, in, n);
+            in += n;
+            d->count -= n;
+            if(d->count == 0)
+                d->state = (d->out_left == 0) ? LZ_DONE : LZ_OFF_LO;
+            break;
+        }
+
+        case LZ_OFF_LO:
+            d->offset = *in++;
+            d->state = LZ_OFF_HI;
+            break;
+
+        case LZ_OFF_HI:
+            d->offset |= (uint16_t) (*in++ << 8);
+            if(!lz_offset_ok(d))
+            {
+                ret = -EBADMSG;
+                break;
+            }
+            d->count = (d->token & 0x0F) + UTL_LZ_MIN_MATCH;
+            if((d->token & 0x0F) == 0x0F)
+                d->state = LZ_MATCH_EXT;
+            else
+                ret = lz_match(d);
+            break;
+
+        case LZ_MATCH_EXT:
+            d->count += *in;
+            if(d->count > d->out_left)
+                ret = -EBADMSG;
+            else if(*in++ != 255)
+                ret = lz_match(d);
+            break;
+
+        default: // Bytes depois do fim, ou stream que já deu erro
+            ret = -EBADMSG;
+            break;
+        }
+    }
+
+    if(ret == 0)
+        ret = lz_flush(d);
+    if(ret < 0)
+        d->state = LZ_ERROR;
+    return ret;
+}
@@ -0,0 +1,99 @@
+/**
+@file
+
+@defgroup LZ LZ
+@brief Descompressão incremental de um stream LZ77 no formato de sequências do LZ4.
+
+O stream é uma série de sequências:
+
+    token | [extensão dos literais] | literais | offset (2 bytes, LE) | [extensão do match]
+
+- token: bits 7..4 = quantidade de literais, bits 3..0 = comprimento do match menos
+  @ref UTL_LZ_MIN_MATCH. O valor 15 em qualquer dos dois continua em bytes de extensão
+  somados ao campo; 255 = vem mais um byte (como no LZ4).
+- offset: distância para trás na saída já produzida, de 1 a @ref UTL_LZ_WINDOW. O match
+  pode se sobrepor a ele mesmo (offset 1 = repete o último byte).
+
+O tamanho da saída é conhecido de antemão (vem no OTA_START): o stream termina quando ela
+é completada, depois dos literais ou depois de um match. A última sequência normalmente
+só tem literais, sem offset.
+
+Só os últimos @ref UTL_LZ_WINDOW bytes da saída ficam na RAM, num anel dentro do
+decodificador. A saída sai em pedaços contíguos pelo sink, na ordem, conforme o anel enche
+e ao fim de cada @ref utl_lz_dec_feed. A entrada pode ser partida em qualquer ponto.
+@{
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifndef UTL_LZ_WINDOW
+/** Maior offset de um match e tamanho do anel de saída (potência de 2) */
+#define UTL_LZ_WINDOW 4096
+#endif
+
+/** Menor match que vale um token */
+#define UTL_LZ_MIN_MATCH 4
+
+#if (UTL_LZ_WINDOW & (UTL_LZ_WINDOW - 1)) != 0 || UTL_LZ_WINDOW > 32768
+#error "UTL_LZ_WINDOW: potência de 2 até 32 KiB"
+#endif
+
+/** Recebe a saída. Retorno < 0 interrompe a descompressão e volta do utl_lz_dec_feed. */
+typedef int (*utl_lz_sink_t)(void* arg, const uint8_t* data, size_t len);
+
+/** Estado do decodificador (não mexer nos campos) */
+typedef struct
+{
+    utl_lz_sink_t sink;
+    void* arg;
+    uint32_t out_left; ///< Bytes de saída que ainda faltam
+    uint32_t out_done; ///< Bytes de saída já produzidos
+    uint32_t count;    ///< Literais ou match da sequência corrente
+    uint16_t offset;
+    uint16_t pos;      ///< Próxima posição do anel
+    uint16_t flushed;  ///< Início do que ainda não foi para o sink
+    uint8_t state;
+    uint8_t token;
+    uint8_t window[UTL_LZ_WINDOW];
+} utl_lz_dec_t;
+
+/**
+  Prepara o decodificador para um stream.
+  @param[out] d decodificador
+  @param[in] out_size tamanho da saída (> 0)
+  @param[in] sink destino da saída
+  @param[in] arg repassado ao sink
+*/
+void utl_lz_dec_init(utl_lz_dec_t* d, uint32_t out_size, utl_lz_sink_t sink, void* arg);
+
+/**
+  Consome mais um pedaço do stream.
+  @param[in,out] d decodificador
+  @param[in] in bytes do stream
+  @param[in] len bytes em in
+  @return 0, -EBADMSG se o stream é inválido (offset fora da saída ou além do fim), ou o
+          erro do sink. Depois de um erro o decodificador só volta com utl_lz_dec_init.
+*/
+int utl_lz_dec_feed(utl_lz_dec_t* d, const uint8_t* in, size_t len);
+
+/** A saída inteira foi produzida (e entregue ao sink) */
+static inline bool utl_lz_dec_done(const utl_lz_dec_t* d)
+{
+    return d->out_left == 0 && d->flushed == d->pos;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
@@ -0,0 +1,144 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "utl_sha256.h"
+#include "utl_io.h"
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define EP0(x) (ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define EP1(x) (ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define SIG0(x) (ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define SIG1(x) (ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+
+// Uma rodada com as variáveis já rotacionadas pelos nomes: sem os 8 movimentos por rodada
+#define ROUND(a, b, c, d, e, f, g, h, i)                                                                           \
+    do                                                                                                             \
+    {                                                                                                              \
+        uint32_t t1 = h + EP1(e) + CH(e, f, g) + sha256_k[i] + w[(i) & 15];                                        \
+        d += t1;                                                                                                   \
+        h = t1 + EP0(a) + MAJ(a, b, c);                                                                            \
+    } while(0)
+
+// Janela de 16 palavras da expansão, em anel (64 bytes de pilha em vez de 256)
+#define EXPAND(i) (w[(i) & 15] += SIG1(w[((i) - 2) & 15]) + w[((i) - 7) & 15] + SIG0(w[((i) - 15) & 15]))
+
+static void sha256_block(uint32_t* s, const uint8_t* p)
+{
+    uint32_t w[16];
+    uint32_t a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+
+    for(int i = 0; i < 16; i++)
+        w[i] = utl_io_get32_fb(p + 4 * i);
+
+    for(int i = 0; i < 64; i += 8)
+    {
+        if(i >= 16)
+        {
+            for(int j = i; j < i + 8; j++)
+                EXPAND(j);
+        }
+        ROUND(a, b, c, d, e, f, g, h, i);
+        ROUND(h, a, b, c, d, e, f, g, i + 1);
+        ROUND(g, h, a, b, c, d, e, f, i + 2);
+        ROUND(f, g, h, a, b, c, d, e, i + 3);
+        ROUND(e, f, g, h, a, b, c, d, i + 4);
+        ROUND(d, e, f, g, h, a, b, c, i + 5);
+        ROUND(c, d, e, f, g, h, a, b, i + 6);
+        ROUND(b, c, d, e, f, g, h, a, i + 7);
+    }
+
+    s[0] += a;
+    s[1] += b;
+    s[2] += c;
+    s[3] += d;
+    s[4] += e;
+    s[5] += f;
+    s[6] += g;
+    s[7] += h;
+}
+
+void utl_sha256_init(utl_sha256_t* ctx)
+{
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->len = 0;
+}
+
+void utl_sha256_update(utl_sha256_t* ctx, const void* data, size_t len)
+{
+    const uint8_t* p = data;
+    size_t used = (size_t) (ctx->len % UTL_SHA256_BLOCK_SIZE);
+
+    if(len == 0)
+        return;
+    ctx->len += len;
+
+    // Completa o bloco pendente
+    if(used != 0)
+    {
+        size_t n = UTL_SHA256_BLOCK_SIZE - used;
+        if(n > len)
+        {
+            memcpy(ctx->buf + used, p, len);
+            return;
+        }
+        memcpy(ctx->buf + used, p, n);
+        sha256_block(ctx->state, ctx->buf);
+        p += n;
+        len -= n;
+    }
+
+    // Blocos inteiros direto da entrada, sem cópia
+    for(; len >= UTL_SHA256_BLOCK_SIZE; p += UTL_SHA256_BLOCK_SIZE, len -= UTL_SHA256_BLOCK_SIZE)
+        sha256_block(ctx->state, p);
+
+    memcpy(ctx->buf, p, len);
+}
+
+void utl_sha256_final(utl_sha256_t* ctx, uint8_t digest[UTL_SHA256_SIZE])
+{
+    size_t used = (size_t) (ctx->len % UTL_SHA256_BLOCK_SIZE);
+    uint64_t bits = ctx->len * 8;
+
+    // 0x80, zeros até sobrar espaço para o tamanho em bits (big endian) no fim do bloco
+    ctx->buf[used++] = 0x80;
+    if(used > UTL_SHA256_BLOCK_SIZE - 8)
+    {
+        memset(ctx->buf + used, 0, UTL_SHA256_BLOCK_SIZE - used);
+        sha256_block(ctx->state, ctx->buf);
+        used = 0;
+    }
+    memset(ctx->buf + used, 0, UTL_SHA256_BLOCK_SIZE - 8 - used);
+    utl_io_put32_tb((uint32_t) (bits >> 32), ctx->buf + UTL_SHA256_BLOCK_SIZE - 8);
+    utl_io_put32_tb((uint32_t) bits, ctx->buf + UTL_SHA256_BLOCK_SIZE - 4);
+    sha256_block(ctx->state, ctx->buf);
+
+    for(int i = 0; i < 8; i++)
+        utl_io_put32_tb(ctx->state[i], digest + 4 * i);
+}
+
+void utl_sha256_data(const void* data, size_t len, uint8_t digest[UTL_SHA256_SIZE])
+{
+    utl_sha256_t ctx;
+
+    utl_sha256_init(&ctx);
+    utl_sha256_update(&ctx, data, len);
+    utl_sha256_final(&ctx, digest);
+}
@@ -0,0 +1,71 @@
+/**
+@file
+
+@defgroup SHA256 SHA256
+@brief SHA-256 (FIPS 180-4) incremental.
+
+Mesmo uso do utl_crc16: init, update quantas vezes for preciso, com a entrada partida em
+qualquer ponto, e final. O contexto guarda só o estado e um bloco de 64 bytes: dá para
+conferir uma imagem conforme ela é escrita, sem segunda leitura.
+@{
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Tamanho do digest */
+#define UTL_SHA256_SIZE 32
+
+/** Tamanho do bloco da compressão */
+#define UTL_SHA256_BLOCK_SIZE 64
+
+/** Estado do hash (não mexer nos campos) */
+typedef struct
+{
+    uint32_t state[8];
+    uint64_t len;                       ///< Bytes já recebidos
+    uint8_t buf[UTL_SHA256_BLOCK_SIZE]; ///< Bloco incompleto
+} utl_sha256_t;
+
+/**
+  Começa um hash.
+  @param[out] ctx contexto
+*/
+void utl_sha256_init(utl_sha256_t* ctx);
+
+/**
+  Acrescenta dados ao hash.
+  @param[in,out] ctx contexto
+  @param[in] data dados
+  @param[in] len bytes em data
+*/
+void utl_sha256_update(utl_sha256_t* ctx, const void* data, size_t len);
+
+/**
+  Fecha o hash. Depois disso o contexto só volta com utl_sha256_init.
+  @param[in,out] ctx contexto
+  @param[out] digest @ref UTL_SHA256_SIZE bytes
+*/
+void utl_sha256_final(utl_sha256_t* ctx, uint8_t digest[UTL_SHA256_SIZE]);
+
+/**
+  Hash de um bloco de dados de uma vez.
+  @param[in] data dados
+  @param[in] len bytes em data
+  @param[out] digest @ref UTL_SHA256_SIZE bytes
+*/
+void utl_sha256_data(const void* data, size_t len, uint8_t digest[UTL_SHA256_SIZE]);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
@@ -0,0 +1,38 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "utl_varint.h"
+
+size_t utl_varint_put(uint32_t value, uint8_t* buf)
+{
+    size_t n = 0;
+
+    while(value >= 0x80)
+    {
+        buf[n++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    buf[n++] = (uint8_t) value;
+
+    return n;
+}
+
+size_t utl_varint_get(const uint8_t* buf, size_t len, uint32_t* value)
+{
+    uint32_t result = 0;
+
+    for(size_t n = 0; n < len && n < UTL_VARINT_MAX_SIZE; n++)
+    {
+        result |= (uint32_t) (buf[n] & 0x7F) << (7 * n);
+        if((buf[n] & 0x80) == 0)
+        {
+            // 5º byte só pode carregar os 4 bits que sobram do uint32_t
+            if(n == UTL_VARINT_MAX_SIZE - 1 && buf[n] > 0x0F)
+                return 0;
+            *value = result;
+            return n + 1;
+        }
+    }
+
+    return 0;
+}
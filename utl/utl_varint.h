@@ -0,0 +1,64 @@
+/**
+@file
+
+@defgroup VARINT VARINT
+@brief Inteiros de tamanho variável (LEB128) e mapeamento zigzag.
+
+Varint: 7 bits por byte, bit 7 = "continua". Valores pequenos ocupam 1 byte,
+um uint32_t ocupa no máximo @ref UTL_VARINT_MAX_SIZE bytes.
+
+Zigzag: leva inteiros com sinal para sem sinal intercalando (0, -1, 1, -2, ...),
+de forma que deltas pequenos, positivos ou negativos, viram varints curtos.
+@{
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Maior varint de um uint32_t */
+#define UTL_VARINT_MAX_SIZE 5
+
+/** Mapeia um inteiro com sinal para sem sinal (0 -> 0, -1 -> 1, 1 -> 2, ...) */
+static inline uint32_t utl_varint_zigzag(int32_t value)
+{
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+/** Inverso de @ref utl_varint_zigzag */
+static inline int32_t utl_varint_unzigzag(uint32_t value)
+{
+    return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+/**
+  Escreve um varint.
+  @param[in] value valor a escrever
+  @param[out] buf destino (precisa de até @ref UTL_VARINT_MAX_SIZE bytes)
+  @return bytes escritos
+*/
+size_t utl_varint_put(uint32_t value, uint8_t* buf);
+
+/**
+  Lê um varint.
+  @param[in] buf origem
+  @param[in] len bytes disponíveis em buf
+  @param[out] value valor lido
+  @return bytes consumidos, 0 se o varint está truncado ou é maior que 32 bits
+*/
+size_t utl_varint_get(const uint8_t* buf, size_t len, uint32_t* value);
+
+#define utl_varint_put_ap(v, x) ((x) += utl_varint_put(v, x)) /**< Escreve e avança o ponteiro */
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */